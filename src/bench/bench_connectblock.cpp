@@ -0,0 +1,132 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Replays the blocks of existing blk?????.dat files through ConnectBlock on a fresh (or snapshot)
+// data directory and reports the throughput and where the time went.
+//
+//   bench_connectblock -datadir=<empty dir> -benchblocksdir=<dir with blk?????.dat> [-benchendfile=<n>]
+
+#include <limits>
+
+#include <boost/filesystem.hpp>
+#include "init.h"
+#include "main.h"
+#include "commons/util/util.h"
+
+static void PrintUsage() {
+    std::string strUsage = "Usage:\n  bench_connectblock [options]\n\n";
+    strUsage += "  -benchblocksdir=<dir>  Directory holding the blk?????.dat files to replay\n";
+    strUsage += "  -benchstartfile=<n>    First block file to replay (default: 0)\n";
+    strUsage += "  -benchendfile=<n>      Last block file to replay (default: all)\n";
+    strUsage += "  -importthreads=<n>     Threads checking blocks ahead of ConnectBlock\n";
+    strUsage += "  -benchmark             Also print the time of each ConnectBlock/ConnectTip call\n";
+    strUsage += "\n" + HelpMessage();
+
+    fprintf(stdout, "%s", strUsage.c_str());
+}
+
+static double Seconds(int64_t nMicros) { return nMicros / 1000000.0; }
+
+static void PrintStage(const char *name, int64_t nTime, int64_t nTotal) {
+    fprintf(stdout, "  %-28s %10.3f s %6.2f%%\n", name, Seconds(nTime), nTotal > 0 ? nTime * 100.0 / nTotal : 0.0);
+}
+
+static void PrintReport(int64_t nElapsed) {
+    const CConnectBlockStats &stats = connectBlockStats;
+    double fElapsed = std::max(Seconds(nElapsed), 0.000001);
+
+    fprintf(stdout, "\nbench_connectblock: %llu blocks, %llu txs in %.3f s: %.1f blocks/s, %.1f tx/s\n",
+            (unsigned long long)stats.nBlocks, (unsigned long long)stats.nTxs, fElapsed, stats.nBlocks / fElapsed,
+            stats.nTxs / fElapsed);
+
+    // Stages of ConnectTip on the connecting thread
+    int64_t nBlockOther = stats.nConnectBlockTime - stats.nTxExecuteTime;
+    int64_t nTxExecute  = stats.nTxExecuteTime - stats.nTxSigCheckTime;
+    fprintf(stdout, "\nconnect thread:\n");
+    PrintStage("read block", stats.nReadBlockTime, nElapsed);
+    PrintStage("signature checks", stats.nTxSigCheckTime, nElapsed);
+    PrintStage("tx execution (incl. vm)", nTxExecute, nElapsed);
+    PrintStage("block checks and undo", nBlockOther, nElapsed);
+    PrintStage("cache flush", stats.nCacheFlushTime, nElapsed);
+    PrintStage("chain state write", stats.nChainStateTime, nElapsed);
+    PrintStage("other (import, index)", nElapsed - stats.nReadBlockTime - stats.nConnectBlockTime -
+               stats.nCacheFlushTime - stats.nChainStateTime, nElapsed);
+
+    fprintf(stdout, "\nsignature checks, all threads: %llu in %.3f s\n", (unsigned long long)stats.nSigChecks.load(),
+            Seconds(stats.nSigCheckTime.load()));
+
+    fprintf(stdout, "\n  %-28s %10s %12s %10s\n", "tx type", "count", "time (s)", "avg (us)");
+    for (const auto &item : stats.mapTxTypeTime) {
+        const auto &typeTime = item.second;
+        fprintf(stdout, "  %-28s %10llu %12.3f %10.1f\n", GetTxType((TxType)item.first).c_str(),
+                (unsigned long long)typeTime.first, Seconds(typeTime.second),
+                typeTime.first > 0 ? (double)typeTime.second / typeTime.first : 0.0);
+    }
+}
+
+static bool ReplayBlockFiles() {
+    boost::filesystem::path blocksDir = SysCfg().GetArg("-benchblocksdir", "");
+    if (blocksDir.empty() || !boost::filesystem::is_directory(blocksDir)) {
+        fprintf(stderr, "Error: -benchblocksdir must point to a directory of block files\n");
+        return false;
+    }
+
+    int32_t nStartFile = SysCfg().GetArg("-benchstartfile", 0);
+    int32_t nEndFile   = SysCfg().GetArg("-benchendfile", std::numeric_limits<int32_t>::max());
+
+    connectBlockStats.SetNull();
+    connectBlockStats.fEnabled = true;
+    int64_t nStart             = GetTimeMicros();
+
+    for (int32_t nFile = nStartFile; nFile <= nEndFile && !ShutdownRequested(); nFile++) {
+        boost::filesystem::path path = blocksDir / strprintf("blk%05u.dat", nFile);
+        FILE *file                   = fopen(path.string().c_str(), "rb");
+        if (!file)
+            break;
+
+        fprintf(stdout, "Replaying %s\n", path.string().c_str());
+        LoadExternalBlockFile(file);
+    }
+
+    connectBlockStats.fEnabled = false;
+    PrintReport(GetTimeMicros() - nStart);
+
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    boost::thread_group threadGroup;
+    bool fRet = false;
+
+    SetupEnvironment();
+    try {
+        CBaseParams::LoadParamsFromConfigFile(argc, argv);
+        if (SysCfg().IsArgCount("-?") || SysCfg().IsArgCount("--help")) {
+            PrintUsage();
+            return 0;
+        }
+
+        // Only connect blocks: no peers, no rpc and no block producing
+        SysCfg().SoftSetBoolArg("-listen", false);
+        SysCfg().SoftSetBoolArg("-dnsseed", false);
+        SysCfg().SoftSetArg("-maxconnections", "0");
+        SysCfg().SoftSetBoolArg("-rpcserver", false);
+        SysCfg().SoftSetBoolArg("-genblock", false);
+
+        fRet = InitLogging() && AppInit(threadGroup) && ReplayBlockFiles();
+    } catch (std::exception &e) {
+        PrintExceptionContinue(&e, "bench_connectblock");
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "bench_connectblock");
+    }
+
+    StartShutdown();
+    Interrupt();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    Shutdown();
+    FinalLogging();
+
+    return fRet ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Times the bounded "known" containers of the p2p and pbft code on the pattern they see: a stream of new
+// hashes past the capacity, each one looked up before it is inserted, mixed with lookups of recent ones.
+//
+//   bench_knownsets [-benchcapacity=1000,11000,50000] [-benchops=<n>]
+
+#include <boost/algorithm/string.hpp>
+#include "commons/boundedhash.h"
+#include "commons/limitedmap.h"
+#include "commons/mruset.h"
+#include "commons/util/util.h"
+#include "config/configuration.h"
+
+static void PrintUsage() {
+    std::string strUsage = "Usage:\n  bench_knownsets [options]\n\n";
+    strUsage += "  -benchcapacity=<n,...> Container capacities to run (default: 1000,11000,50000)\n";
+    strUsage += "  -benchops=<n>          Inserts per run, each with two lookups (default: 1000000)\n";
+
+    fprintf(stdout, "%s", strUsage.c_str());
+}
+
+// adapters giving the containers the same count/insert interface
+struct CMrusetBench {
+    mruset<uint256> set;
+    explicit CMrusetBench(size_t nCapacity) : set(nCapacity) {}
+    bool Count(const uint256 &key) { return set.count(key) > 0; }
+    void Insert(const uint256 &key) { set.insert(key); }
+};
+
+struct CLimitedmapBench {
+    limitedmap<uint256, int64_t> map;
+    int64_t nTime = 0;
+    explicit CLimitedmapBench(size_t nCapacity) : map(nCapacity) {}
+    bool Count(const uint256 &key) { return map.count(key) > 0; }
+    void Insert(const uint256 &key) { map.insert(std::make_pair(key, ++nTime)); }
+};
+
+struct CBoundedSetBench {
+    CBoundedHashSet set;
+    CBoundedSetBench(size_t nCapacity, CBoundedHashSet::Eviction eviction) : set(nCapacity, eviction) {}
+    bool Count(const uint256 &key) { return set.count(key) > 0; }
+    void Insert(const uint256 &key) { set.insert(key); }
+};
+
+struct CBoundedMapBench {
+    CBoundedHashMap<int64_t> map;
+    int64_t nTime = 0;
+    explicit CBoundedMapBench(size_t nCapacity) : map(nCapacity) {}
+    bool Count(const uint256 &key) { return map.count(key) > 0; }
+    void Insert(const uint256 &key) { map.insert(key, ++nTime); }
+};
+
+template <typename Bench>
+static void Run(const char *name, Bench &bench, const std::vector<uint256> &keys, size_t nCapacity) {
+    size_t nHits  = 0;
+    int64_t nStart = GetTimeMicros();
+    for (size_t i = 0; i < keys.size(); i++) {
+        // a recent key, like an inv announced by several peers, then the new one
+        if (bench.Count(keys[i - (i * 7919) % std::min(i + 1, std::max<size_t>(nCapacity / 2, 1))]))
+            nHits++;
+        if (!bench.Count(keys[i]))
+            bench.Insert(keys[i]);
+    }
+    int64_t nTime = GetTimeMicros() - nStart;
+
+    fprintf(stdout, "  %-22s %10zu %12.3f %10.1f %8.1f%%\n", name, nCapacity, nTime / 1000.0,
+            nTime * 1000.0 / keys.size(), nHits * 100.0 / keys.size());
+}
+
+int main(int argc, char *argv[]) {
+    SetupEnvironment();
+    try {
+        CBaseParams::LoadParamsFromConfigFile(argc, argv);
+        if (SysCfg().IsArgCount("-?") || SysCfg().IsArgCount("--help")) {
+            PrintUsage();
+            return 0;
+        }
+
+        size_t nOps = std::max<int64_t>(SysCfg().GetArg("-benchops", 1000000), 1);
+        std::vector<uint256> keys(nOps);
+        for (auto &key : keys)
+            key = GetRandHash();
+
+        std::vector<string> vCapacities;
+        boost::split(vCapacities, SysCfg().GetArg("-benchcapacity", "1000,11000,50000"), boost::is_any_of(","));
+
+        fprintf(stdout, "bench_knownsets: %zu inserts, 2 lookups each\n\n", nOps);
+        fprintf(stdout, "  %-22s %10s %12s %10s %9s\n", "container", "capacity", "time (ms)", "ns/insert", "hits");
+        for (const auto &capacity : vCapacities) {
+            size_t nCapacity = atoi(capacity);
+            if (nCapacity == 0)
+                continue;
+
+            CMrusetBench mrusetBench(nCapacity);
+            Run("mruset", mrusetBench, keys, nCapacity);
+            CBoundedSetBench fifoSet(nCapacity, CBoundedHashSet::Eviction::FIFO);
+            Run("CBoundedHashSet fifo", fifoSet, keys, nCapacity);
+            CBoundedSetBench clockSet(nCapacity, CBoundedHashSet::Eviction::CLOCK);
+            Run("CBoundedHashSet clock", clockSet, keys, nCapacity);
+            CLimitedmapBench limitedmapBench(nCapacity);
+            Run("limitedmap", limitedmapBench, keys, nCapacity);
+            CBoundedMapBench boundedMap(nCapacity);
+            Run("CBoundedHashMap fifo", boundedMap, keys, nCapacity);
+            fprintf(stdout, "\n");
+        }
+    } catch (std::exception &e) {
+        PrintExceptionContinue(&e, "bench_knownsets");
+        return 1;
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "bench_knownsets");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Times ComputeVoteStakingInterestAndRevokeVotes over synthetic voter sets of growing size, on in-memory
+// databases, to show how the vote staking interest and revocation scale with the number of voters.
+//
+//   bench_votestaking [-benchvoters=1000,10000,100000] [-benchdelegates=<n>] [-benchvotes=<n>]
+
+#include <cstring>
+
+#include <boost/algorithm/string.hpp>
+#include "init.h"
+#include "main.h"
+#include "persistence/cachewrapper.h"
+#include "commons/util/util.h"
+
+static void PrintUsage() {
+    std::string strUsage = "Usage:\n  bench_votestaking [options]\n\n";
+    strUsage += "  -benchvoters=<n,...>   Voter set sizes to run (default: 1000,10000,100000)\n";
+    strUsage += "  -benchdelegates=<n>    Number of delegates voted for (default: 101)\n";
+    strUsage += "  -benchvotes=<n>        Candidates voted by each voter (default: 3)\n";
+
+    fprintf(stdout, "%s", strUsage.c_str());
+}
+
+static CKeyID MakeKeyId(uint8_t tag, uint32_t n) {
+    uint160 hash;
+    hash.begin()[0] = tag;
+    memcpy(hash.begin() + 1, &n, sizeof(n));
+    return CKeyID(hash);
+}
+
+static CRegID MakeRegId(uint32_t n) { return CRegID(100 + n / 60000, n % 60000); }
+
+// voters and delegates get disjoint regids, delegates first
+static bool SetupVoters(CCacheWrapper &cw, uint32_t nVoters, uint32_t nDelegates, uint32_t nVotes, int32_t height) {
+    vector<CAccount> delegates;
+    for (uint32_t i = 0; i < nDelegates; i++) {
+        delegates.emplace_back(MakeKeyId(1, i));
+        delegates.back().regid = MakeRegId(i);
+    }
+
+    ReceiptList receipts;
+    for (uint32_t i = 0; i < nVoters; i++) {
+        CAccount voter(MakeKeyId(2, i));
+        voter.regid            = MakeRegId(nDelegates + i);
+        voter.last_vote_height = height - 1000;
+
+        vector<CCandidateReceivedVote> candidateVotes;
+        uint64_t totalVotes = 0;
+        for (uint32_t j = 0; j < nVotes; j++) {
+            CAccount &delegate = delegates[(i + j) % nDelegates];
+            uint64_t votes     = (nVotes - j) * 100 * COIN;
+
+            candidateVotes.emplace_back(CCandidateVote(VoteType::ADD_BCOIN, delegate.regid, votes));
+            delegate.received_votes += votes;
+            totalVotes += votes;
+        }
+
+        receipts.clear();
+        if (!voter.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, totalVotes * 2, ReceiptType::TRANSFER_ACTUAL_COINS,
+                                  receipts) ||
+            !voter.OperateBalance(SYMB::WICC, BalanceOpType::VOTE, totalVotes, ReceiptType::DELEGATE_ADD_VOTE, receipts))
+            return false;
+
+        if (!cw.accountCache.SaveAccount(voter) || !cw.delegateCache.SetCandidateVotes(voter.regid, candidateVotes))
+            return false;
+    }
+
+    for (const auto &delegate : delegates) {
+        if (!cw.accountCache.SaveAccount(delegate) ||
+            !cw.delegateCache.SetDelegateVotes(delegate.regid, delegate.received_votes))
+            return false;
+    }
+
+    return true;
+}
+
+static bool RunVoters(uint32_t nVoters, uint32_t nDelegates, uint32_t nVotes) {
+    int32_t height = std::max<int32_t>(SysCfg().GetVer2ForkHeight(), 2000) - 1;
+
+    // fresh in-memory databases for each run
+    pCdMan = new CCacheDBManager(false, true);
+
+    bool fRet = false;
+    {
+        CCacheWrapper setupCw(pCdMan);
+        int64_t nSetupStart = GetTimeMillis();
+        if (!SetupVoters(setupCw, nVoters, nDelegates, nVotes, height)) {
+            fprintf(stderr, "Error: failed to set up %u voters\n", nVoters);
+        } else {
+            setupCw.Flush();
+            pCdMan->Flush();
+            int64_t nSetupTime = GetTimeMillis() - nSetupStart;
+
+            CCacheWrapper cw(pCdMan);
+            CValidationState state;
+            int64_t nStart = GetTimeMicros();
+            fRet           = ComputeVoteStakingInterestAndRevokeVotes(uint256(), height, GetTime(), cw, state);
+            int64_t nTime  = GetTimeMicros() - nStart;
+
+            if (!fRet)
+                fprintf(stderr, "Error: %s\n", state.GetRejectReason().c_str());
+            else
+                fprintf(stdout, "  %10u %10u %12.3f %12.3f %12lld\n", nVoters, nDelegates, nTime / 1000.0,
+                        (double)nTime / nVoters, (long long)nSetupTime);
+        }
+    }
+
+    delete pCdMan;
+    pCdMan = nullptr;
+
+    return fRet;
+}
+
+int main(int argc, char *argv[]) {
+    SetupEnvironment();
+    try {
+        CBaseParams::LoadParamsFromConfigFile(argc, argv);
+        if (SysCfg().IsArgCount("-?") || SysCfg().IsArgCount("--help")) {
+            PrintUsage();
+            return 0;
+        }
+        if (!InitLogging())
+            return 1;
+
+        uint32_t nDelegates = std::max<int64_t>(SysCfg().GetArg("-benchdelegates", 101), 1);
+        uint32_t nVotes     = std::min<int64_t>(std::max<int64_t>(SysCfg().GetArg("-benchvotes", 3), 1), nDelegates);
+
+        vector<string> vSizes;
+        boost::split(vSizes, SysCfg().GetArg("-benchvoters", "1000,10000,100000"), boost::is_any_of(","));
+
+        fprintf(stdout, "bench_votestaking: %u candidate votes per voter\n\n", nVotes);
+        fprintf(stdout, "  %10s %10s %12s %12s %12s\n", "voters", "delegates", "time (ms)", "us/voter", "setup (ms)");
+        for (const auto &size : vSizes) {
+            uint32_t nVoters = atoi(size);
+            if (nVoters > 0 && !RunVoters(nVoters, nDelegates, nVotes))
+                return 1;
+        }
+        FinalLogging();
+    } catch (std::exception &e) {
+        PrintExceptionContinue(&e, "bench_votestaking");
+        return 1;
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "bench_votestaking");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockindexmap.h"
+
+#include <limits>
+
+#include "commons/random.h"
+#include "crypto/siphash.h"
+
+CBlockIndexMap::CBlockIndexMap()
+    : k0(GetRand(std::numeric_limits<uint64_t>::max())),
+      k1(GetRand(std::numeric_limits<uint64_t>::max())),
+      nSize(0),
+      nSlabUsed(ENTRIES_PER_SLAB) {}
+
+CBlockIndexMap::~CBlockIndexMap() { clear(); }
+
+size_t CBlockIndexMap::Bucket(const uint256 &hash) const {
+    return SipHashUint256(k0, k1, hash) & (vSlots.size() - 1);
+}
+
+size_t CBlockIndexMap::FindSlot(const uint256 &hash) const {
+    if (nSize == 0)
+        return vSlots.size();
+
+    size_t mask = vSlots.size() - 1;
+    for (size_t nSlot = Bucket(hash); vSlots[nSlot] != nullptr; nSlot = (nSlot + 1) & mask) {
+        if (*vSlots[nSlot]->pBlockHash == hash)
+            return nSlot;
+    }
+    return vSlots.size();
+}
+
+void CBlockIndexMap::Rehash(size_t nSlotCount) {
+    std::vector<CBlockIndex *> vOld(nSlotCount, nullptr);
+    vOld.swap(vSlots);
+
+    size_t mask = vSlots.size() - 1;
+    for (CBlockIndex *pIndex : vOld) {
+        if (pIndex == nullptr)
+            continue;
+
+        size_t nSlot = Bucket(*pIndex->pBlockHash);
+        while (vSlots[nSlot] != nullptr)
+            nSlot = (nSlot + 1) & mask;
+        vSlots[nSlot] = pIndex;
+    }
+}
+
+void CBlockIndexMap::InsertSlot(CBlockIndex *pIndex) {
+    // keep the load under 3/4 so that probe sequences stay short
+    if ((nSize + 1) * 4 > vSlots.size() * 3)
+        Rehash(vSlots.empty() ? MIN_SLOTS : vSlots.size() * 2);
+
+    size_t mask  = vSlots.size() - 1;
+    size_t nSlot = Bucket(*pIndex->pBlockHash);
+    while (vSlots[nSlot] != nullptr)
+        nSlot = (nSlot + 1) & mask;
+
+    vSlots[nSlot] = pIndex;
+    nSize++;
+}
+
+void *CBlockIndexMap::AllocEntry() {
+    if (nSlabUsed == ENTRIES_PER_SLAB) {
+        vSlabs.push_back(static_cast<CEntry *>(::operator new(sizeof(CEntry) * ENTRIES_PER_SLAB)));
+        nSlabUsed = 0;
+    }
+
+    return vSlabs.back() + nSlabUsed++;
+}
+
+size_t CBlockIndexMap::erase(const uint256 &hash) {
+    size_t nSlot = FindSlot(hash);
+    if (nSlot == vSlots.size())
+        return 0;
+
+    // hash is the first member of the entry and pBlockHash points at it
+    vRetired.push_back(reinterpret_cast<CEntry *>(const_cast<uint256 *>(vSlots[nSlot]->pBlockHash)));
+
+    // backward shift deletion: pull up the following entries of the probe run which would not be
+    // reachable anymore through the emptied slot
+    size_t mask = vSlots.size() - 1;
+    size_t nNext = nSlot;
+    while (true) {
+        nNext = (nNext + 1) & mask;
+        if (vSlots[nNext] == nullptr)
+            break;
+
+        size_t nHome = Bucket(*vSlots[nNext]->pBlockHash);
+        bool fReachable = (nSlot <= nNext) ? (nSlot < nHome && nHome <= nNext) : (nSlot < nHome || nHome <= nNext);
+        if (fReachable)
+            continue;
+
+        vSlots[nSlot] = vSlots[nNext];
+        nSlot         = nNext;
+    }
+    vSlots[nSlot] = nullptr;
+    nSize--;
+
+    return 1;
+}
+
+void CBlockIndexMap::clear() {
+    for (CBlockIndex *pIndex : vSlots) {
+        if (pIndex != nullptr)
+            reinterpret_cast<CEntry *>(const_cast<uint256 *>(pIndex->pBlockHash))->~CEntry();
+    }
+    for (CEntry *pEntry : vRetired)
+        pEntry->~CEntry();
+
+    for (CEntry *pSlab : vSlabs)
+        ::operator delete(pSlab);
+
+    std::vector<CBlockIndex *>().swap(vSlots);
+    std::vector<CEntry *>().swap(vSlabs);
+    std::vector<CEntry *>().swap(vRetired);
+    nSize     = 0;
+    nSlabUsed = ENTRIES_PER_SLAB;
+}
+
+size_t CBlockIndexMap::GetMemoryUsage() const {
+    return sizeof(*this) + vSlots.capacity() * sizeof(CBlockIndex *) +
+           vSlabs.size() * ENTRIES_PER_SLAB * sizeof(CEntry) + vSlabs.capacity() * sizeof(CEntry *) +
+           vRetired.capacity() * sizeof(CEntry *);
+}
+
+size_t CBlockIndexMap::GetMemoryUsagePerMillion() const {
+    static const size_t nEntries = 1000000;
+
+    size_t nSlots = MIN_SLOTS;
+    while (nEntries * 4 > nSlots * 3)
+        nSlots *= 2;
+
+    size_t nSlabs = (nEntries + ENTRIES_PER_SLAB - 1) / ENTRIES_PER_SLAB;
+    return nSlabs * ENTRIES_PER_SLAB * sizeof(CEntry) + nSlots * sizeof(CBlockIndex *);
+}
@@ -0,0 +1,150 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_BLOCKINDEXMAP_H
+#define CHAIN_BLOCKINDEXMAP_H
+
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "persistence/block.h"
+
+/**
+ * Owner of all the CBlockIndex entries, keyed by block hash.
+ *
+ * Entries live in fixed size slabs next to a copy of their hash (pBlockHash points at it), so they
+ * never move and are not allocated one by one. The lookup table is an open addressing table of
+ * CBlockIndex pointers with linear probing; the key of a slot is read back through pBlockHash, so
+ * a slot costs one pointer. Slots are hashed with a salted SipHash, as block hashes are not costly
+ * to choose for a block producer.
+ */
+class CBlockIndexMap {
+private:
+    struct CEntry {
+        uint256 hash;
+        CBlockIndex index;
+
+        template <typename... Args>
+        explicit CEntry(const uint256 &hashIn, Args &&... args) : hash(hashIn), index(std::forward<Args>(args)...) {
+            index.pBlockHash = &hash;
+        }
+    };
+
+    static const size_t ENTRIES_PER_SLAB = 4096;
+    static const size_t MIN_SLOTS        = 1024;
+
+    uint64_t k0, k1;
+    std::vector<CBlockIndex *> vSlots;  // power of two sized, nullptr for an empty slot
+    size_t nSize;
+
+    std::vector<CEntry *> vSlabs;
+    size_t nSlabUsed;                 // entries handed out from the last slab
+    std::vector<CEntry *> vRetired;   // entries removed by erase(), kept alive until clear()
+
+    size_t Bucket(const uint256 &hash) const;
+    size_t FindSlot(const uint256 &hash) const;
+    void Rehash(size_t nSlotCount);
+    void InsertSlot(CBlockIndex *pIndex);
+    void *AllocEntry();
+
+public:
+    struct value_type {
+        const uint256 &first;
+        CBlockIndex *second;
+    };
+
+    class const_iterator {
+    private:
+        friend class CBlockIndexMap;
+        CBlockIndex *const *pSlot;
+        CBlockIndex *const *pEnd;
+
+        const_iterator(CBlockIndex *const *pSlotIn, CBlockIndex *const *pEndIn) : pSlot(pSlotIn), pEnd(pEndIn) {
+            while (pSlot != pEnd && *pSlot == nullptr) ++pSlot;
+        }
+
+    public:
+        struct arrow_proxy {
+            value_type value;
+            const value_type *operator->() const { return &value; }
+        };
+
+        const_iterator() : pSlot(nullptr), pEnd(nullptr) {}
+
+        value_type operator*() const { return value_type{*(*pSlot)->pBlockHash, *pSlot}; }
+        arrow_proxy operator->() const { return arrow_proxy{**this}; }
+
+        const_iterator &operator++() {
+            do { ++pSlot; } while (pSlot != pEnd && *pSlot == nullptr);
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const const_iterator &other) const { return pSlot == other.pSlot; }
+        bool operator!=(const const_iterator &other) const { return pSlot != other.pSlot; }
+    };
+    typedef const_iterator iterator;
+
+    CBlockIndexMap();
+    ~CBlockIndexMap();
+
+    CBlockIndexMap(const CBlockIndexMap &) = delete;
+    CBlockIndexMap &operator=(const CBlockIndexMap &) = delete;
+
+    const_iterator begin() const { return const_iterator(vSlots.data(), vSlots.data() + vSlots.size()); }
+    const_iterator end() const { return const_iterator(vSlots.data() + vSlots.size(), vSlots.data() + vSlots.size()); }
+
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+    size_t count(const uint256 &hash) const { return FindSlot(hash) != vSlots.size() ? 1 : 0; }
+
+    const_iterator find(const uint256 &hash) const {
+        return const_iterator(vSlots.data() + FindSlot(hash), vSlots.data() + vSlots.size());
+    }
+
+    /** Look up an entry, nullptr if there is none. Unlike std::map it never inserts. */
+    CBlockIndex *operator[](const uint256 &hash) const {
+        size_t nSlot = FindSlot(hash);
+        return nSlot != vSlots.size() ? vSlots[nSlot] : nullptr;
+    }
+
+    /**
+     * Construct a CBlockIndex from args in the pool and index it under hash. Returns the existing
+     * entry and false if the hash is already present.
+     */
+    template <typename... Args>
+    std::pair<const_iterator, bool> emplace(const uint256 &hash, Args &&... args) {
+        size_t nSlot = FindSlot(hash);
+        if (nSlot != vSlots.size())
+            return std::make_pair(const_iterator(vSlots.data() + nSlot, vSlots.data() + vSlots.size()), false);
+
+        CEntry *pEntry = new (AllocEntry()) CEntry(hash, std::forward<Args>(args)...);
+        InsertSlot(&pEntry->index);
+        return std::make_pair(find(hash), true);
+    }
+
+    /**
+     * Remove the entry of hash from the lookup table. Its memory is not reused before clear(), so
+     * pointers still held to it (pprev, the tip sets, the fin indexes) keep seeing the erased block
+     * instead of aliasing a newer one.
+     */
+    size_t erase(const uint256 &hash);
+
+    /** Destroy all the entries and release the pool. */
+    void clear();
+
+    /** Bytes held by the slabs and the lookup table. */
+    size_t GetMemoryUsage() const;
+
+    /** Bytes it takes to hold 1M entries, slabs plus a table grown to fit them. */
+    size_t GetMemoryUsagePerMillion() const;
+};
+
+#endif  // CHAIN_BLOCKINDEXMAP_H
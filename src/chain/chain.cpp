@@ -89,10 +89,10 @@ CBlockLocator CChain::GetLocator(const CBlockIndex *pIndex) const {
     return CBlockLocator(vHave);
 }
 
-CBlockIndex* CChain::FindFork(map<uint256, CBlockIndex *> &mapBlockIndex, const CBlockLocator &locator) const {
+CBlockIndex* CChain::FindFork(const CBlockIndexMap &mapBlockIndex, const CBlockLocator &locator) const {
     // Find the first block the caller has in the main chain
     for (const auto &hash : locator.vHave) {
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hash);
+        CBlockIndexMap::const_iterator mi = mapBlockIndex.find(hash);
         if (mi != mapBlockIndex.end()) {
             CBlockIndex *pIndex = (*mi).second;
             if (pIndex && Contains(pIndex))
@@ -8,6 +8,7 @@
 #define CHAIN_CHAIN_H
 
 #include "persistence/block.h"
+#include "chain/blockindexmap.h"
 
 /** An in-memory indexed chain of blocks. */
 class CChain {
@@ -48,7 +49,7 @@ public:
     CBlockLocator GetLocator(const CBlockIndex *pIndex = nullptr) const;
 
     /** Find the last common block between this chain and a locator. */
-    CBlockIndex *FindFork(map<uint256, CBlockIndex *> &mapBlockIndex, const CBlockLocator &locator) const;
+    CBlockIndex *FindFork(const CBlockIndexMap &mapBlockIndex, const CBlockLocator &locator) const;
 
 }; //end of CChain
 
@@ -0,0 +1,330 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "orphanpool.h"
+
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+
+#include "config/const.h"
+#include "main.h"
+#include "tx/txserializer.h"
+
+COrphanBlockPool orphanBlocks;
+COrphanTxPool orphanTxs;
+
+////////////////////////////////////////////////////////////////////////////////
+// class COrphanBlockPool
+
+COrphanBlockPool::COrphanBlockPool()
+    : file(nullptr), nFileSize(0), nMaxMemBytes(DEFAULT_MAX_ORPHAN_MEM * 1024 * 1024), nMaxDiskBytes(0), nMemBytes(0), nDiskBytes(0), nSpilled(0) {}
+
+COrphanBlockPool::~COrphanBlockPool() {
+    Clear();
+}
+
+void COrphanBlockPool::Init(const boost::filesystem::path &pathIn, uint64_t nMaxMemBytesIn, uint64_t nMaxDiskBytesIn) {
+    Clear();
+    path          = pathIn;
+    nMaxMemBytes  = nMaxMemBytesIn;
+    nMaxDiskBytes = nMaxDiskBytesIn;
+
+    boost::system::error_code ec;
+    boost::filesystem::remove(path, ec);
+}
+
+const COrphanBlock *COrphanBlockPool::Get(const uint256 &hash) const {
+    auto it = mapBlocks.find(hash);
+    return it != mapBlocks.end() ? it->second : nullptr;
+}
+
+uint256 COrphanBlockPool::GetRoot(const uint256 &hash) const {
+    auto it = mapBlocks.find(hash);
+    if (it == mapBlocks.end())
+        return hash;
+
+    // go back while the parent is an orphan too
+    do {
+        auto it2 = mapBlocks.find(it->second->prevBlockHash);
+        if (it2 == mapBlocks.end())
+            return it->first;
+
+        it = it2;
+    } while (true);
+}
+
+bool COrphanBlockPool::Add(const CBlock &block, const uint256 &hash) {
+    if (mapBlocks.count(hash))
+        return true;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    std::vector<uint8_t> data(ss.begin(), ss.end());
+    int32_t height = block.GetHeight();
+
+    // make room by dropping the highest orphans, as long as they are higher than this one
+    while (true) {
+        bool fSpill = data.size() >= SPILL_BLOCK_SIZE || nMemBytes + data.size() > nMaxMemBytes;
+        bool fFits  = fSpill ? nDiskBytes + data.size() <= nMaxDiskBytes : true;
+        if (fFits && mapBlocksByPrev.size() < MAX_ORPHAN_BLOCKS)
+            break;
+
+        if (!PruneHighest(height))
+            return false;
+    }
+
+    COrphanBlock *pOrphan   = new COrphanBlock();
+    pOrphan->blockHash      = hash;
+    pOrphan->prevBlockHash  = block.GetPrevBlockHash();
+    pOrphan->height         = height;
+    pOrphan->nSize          = data.size();
+
+    if (data.size() >= SPILL_BLOCK_SIZE || nMemBytes + data.size() > nMaxMemBytes) {
+        if (!Spill(pOrphan, data)) {
+            delete pOrphan;
+            return false;
+        }
+    } else {
+        pOrphan->vchBlock = std::move(data);
+        nMemBytes += pOrphan->nSize;
+    }
+
+    mapBlocks.emplace(hash, pOrphan);
+    mapBlocksByPrev.emplace(pOrphan->prevBlockHash, pOrphan);
+    setBlocksByHeight.insert(pOrphan);
+    return true;
+}
+
+void COrphanBlockPool::TakeChildren(const uint256 &prevHash, std::vector<CBlock> &blocks) {
+    auto range = mapBlocksByPrev.equal_range(prevHash);
+    std::vector<COrphanBlock *> children;
+    for (auto it = range.first; it != range.second; ++it)
+        children.push_back(it->second);
+
+    for (auto pOrphan : children) {
+        std::vector<uint8_t> data;
+        if (ReadData(pOrphan, data)) {
+            blocks.emplace_back();
+            CDataStream ss(data, SER_DISK, CLIENT_VERSION);
+            ss >> blocks.back();
+        }
+        Erase(pOrphan);
+    }
+}
+
+void COrphanBlockPool::Clear() {
+    for (auto &item : mapBlocks)
+        delete item.second;
+
+    mapBlocks.clear();
+    mapBlocksByPrev.clear();
+    setBlocksByHeight.clear();
+    nMemBytes  = 0;
+    nDiskBytes = 0;
+    ResetFile();
+}
+
+bool COrphanBlockPool::PruneHighest(int32_t height) {
+    if (setBlocksByHeight.empty())
+        return false;
+
+    COrphanBlock *pOrphan = *setBlocksByHeight.rbegin();
+    if (pOrphan->height <= height)
+        return false;
+
+    LogPrint(BCLog::DEBUG, "drop orphan block height=%d, hash=%s, size=%u, spilled=%d\n", pOrphan->height,
+             pOrphan->blockHash.GetHex(), pOrphan->nSize, pOrphan->nFilePos >= 0);
+    Erase(pOrphan);
+    return true;
+}
+
+void COrphanBlockPool::Erase(COrphanBlock *pOrphan) {
+    auto range = setBlocksByHeight.equal_range(pOrphan);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (*it == pOrphan) {
+            setBlocksByHeight.erase(it);
+            break;
+        }
+    }
+
+    auto prevRange = mapBlocksByPrev.equal_range(pOrphan->prevBlockHash);
+    for (auto it = prevRange.first; it != prevRange.second; ++it) {
+        if (it->second == pOrphan) {
+            mapBlocksByPrev.erase(it);
+            break;
+        }
+    }
+    mapBlocks.erase(pOrphan->blockHash);
+
+    if (pOrphan->nFilePos >= 0)
+        nDiskBytes -= pOrphan->nSize;
+    else
+        nMemBytes -= pOrphan->nSize;
+    delete pOrphan;
+
+    // nothing left in the spill file, start it over
+    if (nDiskBytes == 0 && nFileSize > 0)
+        ResetFile();
+}
+
+bool COrphanBlockPool::Spill(COrphanBlock *pOrphan, const std::vector<uint8_t> &data) {
+    if (path.empty())
+        return false;
+
+    if (nFileSize + data.size() > nMaxDiskBytes && !Compact())
+        return false;
+
+    if (file == nullptr) {
+        file = fopen(path.string().c_str(), "wb+");
+        if (file == nullptr)
+            return ERRORMSG("unable to open orphan block file %s", path.string());
+    }
+
+    if (fseek(file, nFileSize, SEEK_SET) != 0 || fwrite(data.data(), 1, data.size(), file) != data.size())
+        return ERRORMSG("unable to write orphan block %s to %s", pOrphan->blockHash.GetHex(), path.string());
+
+    pOrphan->nFilePos = nFileSize;
+    nFileSize  += data.size();
+    nDiskBytes += data.size();
+    nSpilled++;
+    return true;
+}
+
+bool COrphanBlockPool::Compact() {
+    // copy the blocks still in the store back to back into a new file, one at a time, dropping the space of
+    // the removed ones. The old file and positions stay valid until the new file replaces it
+    std::vector<std::pair<int64_t, COrphanBlock *>> spilled;
+    for (auto &item : mapBlocks) {
+        if (item.second->nFilePos >= 0)
+            spilled.emplace_back(item.second->nFilePos, item.second);
+    }
+    std::sort(spilled.begin(), spilled.end());
+
+    boost::filesystem::path pathTmp = path;
+    pathTmp += ".new";
+    FILE *fileTmp = fopen(pathTmp.string().c_str(), "wb");
+    if (fileTmp == nullptr)
+        return ERRORMSG("unable to open orphan block file %s", pathTmp.string());
+
+    std::vector<uint8_t> data;
+    uint64_t nTmpSize = 0;
+    for (auto &item : spilled) {
+        if (!ReadData(item.second, data) || fwrite(data.data(), 1, data.size(), fileTmp) != data.size()) {
+            fclose(fileTmp);
+            boost::system::error_code ec;
+            boost::filesystem::remove(pathTmp, ec);
+            return ERRORMSG("unable to rewrite orphan block file %s", pathTmp.string());
+        }
+
+        item.first = nTmpSize;
+        nTmpSize += data.size();
+    }
+
+    fflush(fileTmp);
+    FileCommit(fileTmp);
+    fclose(fileTmp);
+
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+
+    // once the old file is gone its positions are too, so a failure drops all the spilled orphans
+    if (!RenameOver(pathTmp, path) || (file = fopen(path.string().c_str(), "rb+")) == nullptr) {
+        for (auto &item : spilled)
+            Erase(item.second);
+        ResetFile();
+        boost::system::error_code ec;
+        boost::filesystem::remove(pathTmp, ec);
+        return ERRORMSG("unable to replace orphan block file %s", path.string());
+    }
+
+    for (auto &item : spilled)
+        item.second->nFilePos = item.first;
+    nFileSize = nTmpSize;
+
+    return true;
+}
+
+bool COrphanBlockPool::ReadData(const COrphanBlock *pOrphan, std::vector<uint8_t> &data) {
+    if (pOrphan->nFilePos < 0) {
+        data = pOrphan->vchBlock;
+        return true;
+    }
+
+    data.resize(pOrphan->nSize);
+    if (file == nullptr || fseek(file, pOrphan->nFilePos, SEEK_SET) != 0 ||
+        fread(data.data(), 1, data.size(), file) != data.size())
+        return ERRORMSG("unable to read orphan block %s from %s", pOrphan->blockHash.GetHex(), path.string());
+
+    return true;
+}
+
+void COrphanBlockPool::ResetFile() {
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+    nFileSize = 0;
+
+    if (!path.empty()) {
+        boost::system::error_code ec;
+        boost::filesystem::remove(path, ec);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class COrphanTxPool
+
+bool COrphanTxPool::Add(const std::shared_ptr<CBaseTx> &spTx, int32_t pendingHeight) {
+    const uint256 &txid = spTx->GetHash();
+    if (mapTxs.count(txid))
+        return true;
+
+    uint32_t nSize = ::GetSerializeSize(spTx, SER_NETWORK, PROTOCOL_VERSION);
+    while (mapTxs.size() >= MAX_ORPHAN_TXS || nBytes + nSize > MAX_ORPHAN_TX_BYTES) {
+        // drop the tx waiting for the highest regid, unless this one waits even longer
+        if (mapTxsByHeight.empty() || mapTxsByHeight.rbegin()->first <= pendingHeight)
+            return false;
+
+        Erase(mapTxsByHeight.rbegin()->second);
+    }
+
+    mapTxs.emplace(txid, COrphanTx{spTx, pendingHeight, nSize});
+    mapTxsByHeight.emplace(pendingHeight, txid);
+    nBytes += nSize;
+    return true;
+}
+
+void COrphanTxPool::TakeReady(int32_t height, std::vector<std::shared_ptr<CBaseTx>> &txs) {
+    while (!mapTxsByHeight.empty() && mapTxsByHeight.begin()->first <= height) {
+        uint256 txid = mapTxsByHeight.begin()->second;
+        txs.push_back(mapTxs.find(txid)->second.spTx);
+        Erase(txid);
+    }
+}
+
+void COrphanTxPool::Clear() {
+    mapTxs.clear();
+    mapTxsByHeight.clear();
+    nBytes = 0;
+}
+
+void COrphanTxPool::Erase(const uint256 &txid) {
+    auto it = mapTxs.find(txid);
+    if (it == mapTxs.end())
+        return;
+
+    auto range = mapTxsByHeight.equal_range(it->second.pendingHeight);
+    for (auto heightIt = range.first; heightIt != range.second; ++heightIt) {
+        if (heightIt->second == txid) {
+            mapTxsByHeight.erase(heightIt);
+            break;
+        }
+    }
+
+    nBytes -= it->second.nSize;
+    mapTxs.erase(it);
+}
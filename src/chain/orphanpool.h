@@ -0,0 +1,136 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_ORPHANPOOL_H
+#define CHAIN_ORPHANPOOL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include "commons/uint256.h"
+
+class CBlock;
+class CBaseTx;
+
+struct COrphanBlock {
+    uint256 blockHash;
+    uint256 prevBlockHash;
+    int32_t height   = 0;
+    uint32_t nSize   = 0;           // serialized size of the block
+    int64_t nFilePos = -1;          // position in the spill file, -1 while the block is held in vchBlock
+    std::vector<uint8_t> vchBlock;
+};
+
+/**
+ * Blocks whose parent is not known yet, indexed by hash and by parent hash.
+ *
+ * The store is bounded by count and by bytes: blocks of SPILL_BLOCK_SIZE and up, and any block once the
+ * memory budget is used up, are written to a temporary file in the data dir instead of being held in
+ * memory, up to the disk budget. When a budget is exceeded the highest orphans are dropped first, and a
+ * new orphan is refused if it is not lower than all of them, so the blocks next to the tip survive a
+ * flood from a fast peer. Requires cs_main.
+ */
+class COrphanBlockPool {
+public:
+    static const uint32_t SPILL_BLOCK_SIZE = 64 * 1024;
+
+    COrphanBlockPool();
+    ~COrphanBlockPool();
+
+    /** Set the budgets, in bytes, and the spill file, which is emptied. Nothing is spilled before. */
+    void Init(const boost::filesystem::path &pathIn, uint64_t nMaxMemBytesIn, uint64_t nMaxDiskBytesIn);
+
+    bool Exists(const uint256 &hash) const { return mapBlocks.count(hash) > 0; }
+    const COrphanBlock *Get(const uint256 &hash) const;
+
+    /** Hash of the first missing ancestor of the orphan hash, hash itself if it is not an orphan. */
+    uint256 GetRoot(const uint256 &hash) const;
+
+    /** Keep the block until its parent shows up, returns false if there is no room for it. */
+    bool Add(const CBlock &block, const uint256 &hash);
+
+    /** Remove the orphans whose parent is prevHash and append them to blocks. */
+    void TakeChildren(const uint256 &prevHash, std::vector<CBlock> &blocks);
+
+    void Clear();
+
+    size_t Size() const { return mapBlocks.size(); }
+    uint64_t GetMemBytes() const { return nMemBytes; }
+    uint64_t GetDiskBytes() const { return nDiskBytes; }
+    uint64_t GetSpilledCount() const { return nSpilled; }
+
+private:
+    struct CHeightComparator {
+        bool operator()(const COrphanBlock *pa, const COrphanBlock *pb) const { return pa->height < pb->height; }
+    };
+
+    std::map<uint256, COrphanBlock *> mapBlocks;
+    std::multimap<uint256, COrphanBlock *> mapBlocksByPrev;
+    std::multiset<COrphanBlock *, CHeightComparator> setBlocksByHeight;
+
+    boost::filesystem::path path;
+    FILE *file;
+    uint64_t nFileSize;     // bytes written to the spill file, including the ones of removed blocks
+    uint64_t nMaxMemBytes;
+    uint64_t nMaxDiskBytes;
+    uint64_t nMemBytes;
+    uint64_t nDiskBytes;    // bytes of the spilled blocks still in the store
+    uint64_t nSpilled;
+
+    bool PruneHighest(int32_t height);
+    void Erase(COrphanBlock *pOrphan);
+    bool Spill(COrphanBlock *pOrphan, const std::vector<uint8_t> &data);
+    bool Compact();
+    bool ReadData(const COrphanBlock *pOrphan, std::vector<uint8_t> &data);
+    void ResetFile();
+};
+
+/**
+ * Txes signed by a regid the local chain does not have yet, typically relayed by a peer that is ahead
+ * of us while the block registering the account is still on its way. They are retried once the tip
+ * reaches the height of the regid and dropped if they still fail. Bounded by count and bytes, the txes
+ * waiting for the highest regids are dropped first. Requires cs_main.
+ */
+class COrphanTxPool {
+public:
+    static const size_t MAX_ORPHAN_TXS      = 1000;
+    static const uint64_t MAX_ORPHAN_TX_BYTES = 5 * 1024 * 1024;
+
+    /** Keep the tx until the tip reaches pendingHeight, returns false if there is no room for it. */
+    bool Add(const std::shared_ptr<CBaseTx> &spTx, int32_t pendingHeight);
+
+    bool Exists(const uint256 &txid) const { return mapTxs.count(txid) > 0; }
+
+    /** Remove the txes waiting for a height up to height and append them to txs. */
+    void TakeReady(int32_t height, std::vector<std::shared_ptr<CBaseTx>> &txs);
+
+    void Clear();
+
+    size_t Size() const { return mapTxs.size(); }
+    uint64_t GetBytes() const { return nBytes; }
+
+private:
+    struct COrphanTx {
+        std::shared_ptr<CBaseTx> spTx;
+        int32_t pendingHeight;
+        uint32_t nSize;
+    };
+
+    std::map<uint256, COrphanTx> mapTxs;
+    std::multimap<int32_t, uint256> mapTxsByHeight;
+    uint64_t nBytes = 0;
+
+    void Erase(const uint256 &txid);
+};
+
+extern COrphanBlockPool orphanBlocks;
+extern COrphanTxPool orphanTxs;
+
+#endif  // CHAIN_ORPHANPOOL_H
@@ -0,0 +1,73 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "reorgstats.h"
+
+#include "commons/histogram.h"
+#include "commons/util/time.h"
+#include "persistence/block.h"
+
+CReorgStats reorgStats;
+
+void CReorgStats::Begin(const CBlockIndex *pOldTip, const CBlockIndex *pGlobalFinIndex) {
+    if (fInReorg)
+        return;
+
+    fInReorg   = true;
+    nStartTime = GetTimeMicros();
+    current    = CReorgRecord();
+
+    current.nTime = GetTime();
+    if (pOldTip != nullptr) {
+        current.nOldTipHeight = pOldTip->height;
+        current.oldTipHash    = pOldTip->GetBlockHash();
+    }
+    if (pGlobalFinIndex != nullptr)
+        current.nGlobalFinHeight = pGlobalFinIndex->height;
+}
+
+void CReorgStats::End(const CBlockIndex *pNewTip) {
+    if (!fInReorg)
+        return;
+
+    fInReorg = false;
+    current.nTotalTime  = GetTimeMicros() - nStartTime;
+    current.nForkHeight = current.nOldTipHeight - current.nDisconnected;
+    if (pNewTip != nullptr) {
+        current.nNewTipHeight = pNewTip->height;
+        current.newTipHash    = pNewTip->GetBlockHash();
+    }
+
+    static CHistogram &histTime       = histogramRegistry.Get("reorg.time");
+    static CHistogram &histDepth      = histogramRegistry.Get("reorg.depth");
+    static CHistogram &histConnected  = histogramRegistry.Get("reorg.connected");
+    static CHistogram &histUndoRead   = histogramRegistry.Get("reorg.undo_read");
+    static CHistogram &histCacheFlush = histogramRegistry.Get("reorg.cache_flush");
+    static CHistogram &histResurrect  = histogramRegistry.Get("reorg.mempool_resurrect");
+    histTime.Add(current.nTotalTime);
+    histDepth.Add(current.GetDepth());
+    histConnected.Add(current.nConnected);
+    histUndoRead.Add(current.nUndoReadTime);
+    histCacheFlush.Add(current.nCacheFlushTime);
+    histResurrect.Add(current.nResurrectTime);
+
+    LOCK(cs);
+    records.push_front(current);
+    if (records.size() > MAX_RECORDS)
+        records.pop_back();
+    nReorgs++;
+}
+
+uint64_t CReorgStats::GetCount() const {
+    LOCK(cs);
+    return nReorgs;
+}
+
+std::vector<CReorgRecord> CReorgStats::GetRecent(size_t count) const {
+    LOCK(cs);
+    if (count > records.size())
+        count = records.size();
+
+    return std::vector<CReorgRecord>(records.begin(), records.begin() + count);
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_REORGSTATS_H
+#define CHAIN_REORGSTATS_H
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "commons/uint256.h"
+#include "sync.h"
+
+class CBlockIndex;
+
+/** What one reorg of the active chain cost, all times in microseconds. */
+struct CReorgRecord {
+    int64_t nTime           = 0;   // unix time the reorg started at
+    int32_t nOldTipHeight   = 0;
+    uint256 oldTipHash;
+    int32_t nNewTipHeight   = 0;
+    uint256 newTipHash;
+    int32_t nForkHeight     = 0;   // height of the last block the two chains share
+    int32_t nGlobalFinHeight = -1; // pbft global fin block when the reorg started, -1 if none
+
+    uint32_t nDisconnected  = 0;
+    uint32_t nConnected     = 0;
+
+    int64_t nTotalTime      = 0;
+    int64_t nDisconnectTime = 0;   // DisconnectTip, including the undo read, flush and resurrect below
+    int64_t nConnectTime    = 0;   // ConnectTip
+    int64_t nUndoReadTime   = 0;   // reading the undo data of the disconnected blocks
+    int64_t nCacheFlushTime = 0;   // flushing the block caches into the global caches, both ways
+    int64_t nResurrectTime  = 0;   // putting the txes of the disconnected blocks back in the mempool
+
+    uint32_t GetDepth() const { return nDisconnected; }
+};
+
+/**
+ * Records the reorgs of the active chain made by ActivateBestChain(). The chain code fills in the
+ * record of the reorg in progress, which only it can see, under cs_main; the finished records are
+ * kept for getreorgstats and fed to the "reorg.*" histograms of histogramRegistry.
+ */
+class CReorgStats {
+public:
+    static const size_t MAX_RECORDS = 100;
+
+    /** Start a reorg away from pOldTip, unless one is in progress already. */
+    void Begin(const CBlockIndex *pOldTip, const CBlockIndex *pGlobalFinIndex);
+
+    /** The reorg in progress, nullptr if there is none. */
+    CReorgRecord *Current() { return fInReorg ? &current : nullptr; }
+
+    /** Close the reorg in progress, if any, at pNewTip. */
+    void End(const CBlockIndex *pNewTip);
+
+    uint64_t GetCount() const;
+
+    /** The last count reorgs, the latest first. */
+    std::vector<CReorgRecord> GetRecent(size_t count) const;
+
+private:
+    bool fInReorg = false;
+    int64_t nStartTime = 0;
+    CReorgRecord current;
+
+    mutable CCriticalSection cs;
+    std::deque<CReorgRecord> records;
+    uint64_t nReorgs = 0;
+};
+
+extern CReorgStats reorgStats;
+
+#endif  // CHAIN_REORGSTATS_H
@@ -0,0 +1,76 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arena.h"
+
+static thread_local CArena *pCurrentArena = nullptr;
+
+CArena::CArena()
+    : nChunk(0), pCur(nullptr), pEnd(nullptr), nUsedBytes(0), nReservedBytes(0), nLastUsedBytes(0),
+      nPeakUsedBytes(0), nAllocs(0), nReleases(0) {}
+
+CArena::~CArena() {
+    Release();
+    for (char *pChunk : vChunks)
+        ::operator delete(pChunk);
+}
+
+CArena *CArena::Current() { return pCurrentArena; }
+
+void *CArena::Allocate(size_t nSize, size_t nAlign) {
+    nAllocs.fetch_add(1, std::memory_order_relaxed);
+    nUsedBytes += nSize;
+    if (nSize > CHUNK_SIZE / 4)
+        return AllocateLarge(nSize);
+
+    uintptr_t nCur = ((uintptr_t)pCur + nAlign - 1) & ~(uintptr_t)(nAlign - 1);
+    if (pCur == nullptr || nCur + nSize > (uintptr_t)pEnd) {
+        if (nChunk == vChunks.size()) {
+            vChunks.push_back(static_cast<char *>(::operator new(CHUNK_SIZE)));
+            nReservedBytes.fetch_add(CHUNK_SIZE, std::memory_order_relaxed);
+        }
+        pCur = vChunks[nChunk++];
+        pEnd = pCur + CHUNK_SIZE;
+        nCur = ((uintptr_t)pCur + nAlign - 1) & ~(uintptr_t)(nAlign - 1);
+    }
+
+    pCur = (char *)(nCur + nSize);
+    return (void *)nCur;
+}
+
+void *CArena::AllocateLarge(size_t nSize) {
+    void *p = ::operator new(nSize);
+    vLarge.push_back(p);
+    nReservedBytes.fetch_add(nSize, std::memory_order_relaxed);
+    return p;
+}
+
+void CArena::Release() {
+    if (nUsedBytes == 0)
+        return;
+
+    for (void *p : vLarge)
+        ::operator delete(p);
+    vLarge.clear();
+
+    while (vChunks.size() > MAX_KEPT_CHUNKS) {
+        ::operator delete(vChunks.back());
+        vChunks.pop_back();
+    }
+
+    nChunk = 0;
+    pCur   = nullptr;
+    pEnd   = nullptr;
+
+    nReservedBytes.store(vChunks.size() * CHUNK_SIZE, std::memory_order_relaxed);
+    nLastUsedBytes.store(nUsedBytes, std::memory_order_relaxed);
+    if (nUsedBytes > nPeakUsedBytes.load(std::memory_order_relaxed))
+        nPeakUsedBytes.store(nUsedBytes, std::memory_order_relaxed);
+    nReleases.fetch_add(1, std::memory_order_relaxed);
+    nUsedBytes = 0;
+}
+
+CArenaScope::CArenaScope(CArena &arena) : pPrevArena(pCurrentArena) { pCurrentArena = &arena; }
+
+CArenaScope::~CArenaScope() { pCurrentArena = pPrevArena; }
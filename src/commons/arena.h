@@ -0,0 +1,138 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_ARENA_H
+#define COIN_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+/**
+ * Monotonic arena for the short-lived objects of one block.
+ *
+ * Memory is handed out by bumping a pointer through fixed size chunks and is never given back one
+ * object at a time: Release() takes it all back in one go, once every object carved out of the arena
+ * is gone. The chunks are kept for the next block, up to MAX_KEPT_CHUNKS, so connecting a block does
+ * not go through malloc for them. Not thread safe, each arena belongs to one user at a time.
+ */
+class CArena {
+public:
+    static const size_t CHUNK_SIZE      = 256 * 1024;
+    static const size_t MAX_KEPT_CHUNKS = 64;
+
+    CArena();
+    ~CArena();
+
+    CArena(const CArena &) = delete;
+    CArena &operator=(const CArena &) = delete;
+
+    void *Allocate(size_t nSize, size_t nAlign);
+
+    /** Take back all the memory handed out, objects allocated from the arena must be destroyed already. */
+    void Release();
+
+    size_t GetUsedBytes() const { return nUsedBytes; }
+    size_t GetReservedBytes() const { return nReservedBytes.load(std::memory_order_relaxed); }
+    size_t GetLastUsedBytes() const { return nLastUsedBytes.load(std::memory_order_relaxed); }
+    size_t GetPeakUsedBytes() const { return nPeakUsedBytes.load(std::memory_order_relaxed); }
+    uint64_t GetAllocCount() const { return nAllocs.load(std::memory_order_relaxed); }
+    uint64_t GetReleaseCount() const { return nReleases.load(std::memory_order_relaxed); }
+
+    /** The arena of the innermost CArenaScope of the calling thread, nullptr if there is none. */
+    static CArena *Current();
+
+private:
+    friend class CArenaScope;
+
+    std::vector<char *> vChunks;  // chunks of CHUNK_SIZE, the ones past nChunk are free
+    size_t nChunk;
+    char *pCur;
+    char *pEnd;
+    std::vector<void *> vLarge;   // allocations too large for a chunk, freed on release
+    size_t nUsedBytes;
+
+    std::atomic<size_t> nReservedBytes;
+    std::atomic<size_t> nLastUsedBytes;
+    std::atomic<size_t> nPeakUsedBytes;
+    std::atomic<uint64_t> nAllocs;
+    std::atomic<uint64_t> nReleases;
+
+    void *AllocateLarge(size_t nSize);
+};
+
+/**
+ * While it lives, CArenaAllocator instances default constructed on this thread allocate from the arena.
+ * Keep it around the construction of objects that are known to die before the arena is released, and
+ * nothing else: a container keeps the allocator it was constructed with.
+ */
+class CArenaScope {
+public:
+    explicit CArenaScope(CArena &arena);
+    ~CArenaScope();
+
+    CArenaScope(const CArenaScope &) = delete;
+    CArenaScope &operator=(const CArenaScope &) = delete;
+
+private:
+    CArena *pPrevArena;
+};
+
+/** Releases the arena when it goes out of scope, declare it before the objects allocated from the arena. */
+class CArenaReleaser {
+public:
+    explicit CArenaReleaser(CArena &arenaIn) : arena(arenaIn) {}
+    ~CArenaReleaser() { arena.Release(); }
+
+    CArenaReleaser(const CArenaReleaser &) = delete;
+    CArenaReleaser &operator=(const CArenaReleaser &) = delete;
+
+private:
+    CArena &arena;
+};
+
+/**
+ * Standard allocator on top of CArena. Bound to CArena::Current() when default constructed, and falls
+ * back to the heap when that is nullptr, so a container declared with it behaves as usual outside of
+ * any CArenaScope. A copy of a container takes the arena of the scope it is made in, not the one of the
+ * original.
+ */
+template <typename T>
+class CArenaAllocator {
+public:
+    typedef T value_type;
+
+    CArenaAllocator() : pArena(CArena::Current()) {}
+    explicit CArenaAllocator(CArena *pArenaIn) : pArena(pArenaIn) {}
+    template <typename U>
+    CArenaAllocator(const CArenaAllocator<U> &other) : pArena(other.pArena) {}
+
+    T *allocate(size_t n) {
+        if (pArena != nullptr)
+            return static_cast<T *>(pArena->Allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) {
+        if (pArena == nullptr)
+            ::operator delete(p);
+    }
+
+    CArenaAllocator select_on_container_copy_construction() const { return CArenaAllocator(); }
+
+    template <typename U>
+    bool operator==(const CArenaAllocator<U> &other) const { return pArena == other.pArena; }
+    template <typename U>
+    bool operator!=(const CArenaAllocator<U> &other) const { return pArena != other.pArena; }
+
+private:
+    template <typename U>
+    friend class CArenaAllocator;
+
+    CArena *pArena;
+};
+
+#endif  // COIN_ARENA_H
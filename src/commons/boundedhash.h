@@ -0,0 +1,250 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COMMONS_BOUNDEDHASH_H
+#define COMMONS_BOUNDEDHASH_H
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "commons/random.h"
+#include "commons/uint256.h"
+#include "crypto/siphash.h"
+
+/**
+ * Map from uint256 to V holding at most max_size() entries, for the "known" and "already asked" sets of
+ * the p2p and pbft code. The entries live in a ring of slots filled in insertion order, the lookups go
+ * through an open-addressing table of slot numbers with linear probing. Once the ring is full, a new
+ * entry takes the slot under the hand: with FIFO the oldest entry is dropped, with CLOCK an entry found
+ * by a lookup since the hand last passed it gets a second chance.
+ *
+ * Nothing is allocated per entry: the ring grows up to max_size() and the table doubles while it fills,
+ * then both stay as they are. The table is indexed by a salted SipHash of the key, so peers can not
+ * pick hashes that pile up on one probe chain. An erased entry leaves a free slot in the ring, which is
+ * reused when the hand comes to it. Not thread safe, the caller locks.
+ */
+template <typename V>
+class CBoundedHashMap {
+public:
+    enum Eviction { FIFO, CLOCK };
+    typedef size_t size_type;
+
+    explicit CBoundedHashMap(size_type nMaxSizeIn = 0, Eviction evictionIn = FIFO)
+        : nMaxSize(nMaxSizeIn), nSize(0), nHand(0), eviction(evictionIn) {
+        k0 = GetRand(std::numeric_limits<uint64_t>::max());
+        k1 = GetRand(std::numeric_limits<uint64_t>::max());
+        table.assign(MIN_TABLE_SIZE, NPOS);
+    }
+
+    size_type size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+    size_type max_size() const { return nMaxSize; }
+
+    /** Change the capacity, keeping the newest entries. */
+    size_type max_size(size_type s) {
+        std::vector<uint32_t> order;
+        GetSlotsByAge(order);
+
+        std::vector<uint256> oldKeys;
+        std::vector<V> oldValues;
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        clear();
+        nMaxSize = s;
+        for (size_t i = order.size() > s ? order.size() - s : 0; i < order.size(); i++)
+            insert(oldKeys[order[i]], oldValues[order[i]]);
+        return nMaxSize;
+    }
+
+    size_type count(const uint256 &key) const { return Lookup(key) != NPOS ? 1 : 0; }
+
+    /** The value of key, nullptr if it is not there. */
+    V *find(const uint256 &key) {
+        uint32_t slot = Lookup(key);
+        return slot != NPOS ? &values[slot] : nullptr;
+    }
+
+    const V *find(const uint256 &key) const {
+        uint32_t slot = Lookup(key);
+        return slot != NPOS ? &values[slot] : nullptr;
+    }
+
+    /** Add key with value, returns false and leaves the old value if key is there already. */
+    bool insert(const uint256 &key, const V &value) {
+        assert(nMaxSize > 0 && "max_size must be set before inserting");
+        uint32_t hash = Hash(key);
+        size_t pos    = hash & (table.size() - 1);
+        for (; table[pos] != NPOS; pos = (pos + 1) & (table.size() - 1)) {
+            if (keys[table[pos]] == key)
+                return false;
+        }
+
+        uint32_t slot;
+        if (keys.size() < nMaxSize) {
+            slot = keys.size();
+            keys.push_back(key);
+            values.push_back(value);
+            hashes.push_back(hash);
+            flags.push_back(USED);
+        } else {
+            slot = TakeSlot();
+            keys[slot]   = key;
+            values[slot] = value;
+            hashes[slot] = hash;
+            flags[slot]  = USED;
+            // the eviction may have shifted the probe chain, look for the free cell again
+            for (pos = hash & (table.size() - 1); table[pos] != NPOS; pos = (pos + 1) & (table.size() - 1)) {}
+        }
+        table[pos] = slot;
+        nSize++;
+
+        if (nSize * 2 > table.size())
+            Rehash(table.size() * 2);
+        return true;
+    }
+
+    bool erase(const uint256 &key) {
+        uint32_t slot = Lookup(key);
+        if (slot == NPOS)
+            return false;
+
+        Unlink(slot);
+        return true;
+    }
+
+    void clear() {
+        keys.clear();
+        values.clear();
+        hashes.clear();
+        flags.clear();
+        table.assign(MIN_TABLE_SIZE, NPOS);
+        nSize = 0;
+        nHand = 0;
+    }
+
+private:
+    static const uint32_t NPOS           = UINT32_MAX;
+    static const size_t MIN_TABLE_SIZE   = 16;
+    static const uint8_t USED            = 1;
+    static const uint8_t REFERENCED      = 2;
+
+    std::vector<uint256> keys;     // the ring of slots, in insertion order until it is full
+    std::vector<V> values;
+    std::vector<uint32_t> hashes;  // salted hash of each key, to rehash and shift without hashing again
+    mutable std::vector<uint8_t> flags;
+    std::vector<uint32_t> table;   // slot numbers, NPOS for a free cell, the size is a power of 2
+    size_type nMaxSize;
+    size_type nSize;
+    size_type nHand;               // next slot to take once the ring is full
+    uint64_t k0, k1;
+    Eviction eviction;
+
+    uint32_t Hash(const uint256 &key) const { return (uint32_t)SipHashUint256(k0, k1, key); }
+
+    uint32_t Lookup(const uint256 &key) const {
+        for (size_t pos = Hash(key) & (table.size() - 1); table[pos] != NPOS; pos = (pos + 1) & (table.size() - 1)) {
+            uint32_t slot = table[pos];
+            if (keys[slot] == key) {
+                if (eviction == CLOCK)
+                    flags[slot] |= REFERENCED;
+                return slot;
+            }
+        }
+        return NPOS;
+    }
+
+    // free the slot under the hand, passing over the referenced ones with CLOCK, and move the hand on
+    uint32_t TakeSlot() {
+        if (eviction == CLOCK) {
+            while (flags[nHand] & REFERENCED) {
+                flags[nHand] &= ~REFERENCED;
+                nHand = (nHand + 1) % keys.size();
+            }
+        }
+
+        uint32_t slot = nHand;
+        nHand         = (nHand + 1) % keys.size();
+        if (flags[slot] & USED)
+            Unlink(slot);
+        return slot;
+    }
+
+    // remove the slot from the table, shifting back the entries of the probe chain behind it
+    void Unlink(uint32_t slot) {
+        size_t mask = table.size() - 1;
+        size_t pos  = hashes[slot] & mask;
+        while (table[pos] != slot)
+            pos = (pos + 1) & mask;
+
+        table[pos] = NPOS;
+        for (size_t next = (pos + 1) & mask; table[next] != NPOS; next = (next + 1) & mask) {
+            size_t home = hashes[table[next]] & mask;
+            // leave the entry if its home is cyclically in (pos, next]
+            bool fStays = pos <= next ? (pos < home && home <= next) : (pos < home || home <= next);
+            if (!fStays) {
+                table[pos]  = table[next];
+                table[next] = NPOS;
+                pos         = next;
+            }
+        }
+
+        flags[slot] = 0;
+        nSize--;
+    }
+
+    void Rehash(size_t nTableSize) {
+        table.assign(nTableSize, NPOS);
+        for (uint32_t slot = 0; slot < keys.size(); slot++) {
+            if (!(flags[slot] & USED))
+                continue;
+
+            size_t pos = hashes[slot] & (nTableSize - 1);
+            while (table[pos] != NPOS)
+                pos = (pos + 1) & (nTableSize - 1);
+            table[pos] = slot;
+        }
+    }
+
+    // the used slots, oldest first
+    void GetSlotsByAge(std::vector<uint32_t> &order) const {
+        bool fFull = keys.size() == nMaxSize;
+        for (size_t i = 0; i < keys.size(); i++) {
+            uint32_t slot = fFull ? (nHand + i) % keys.size() : i;
+            if (flags[slot] & USED)
+                order.push_back(slot);
+        }
+    }
+};
+
+template <typename V> const uint32_t CBoundedHashMap<V>::NPOS;
+template <typename V> const size_t CBoundedHashMap<V>::MIN_TABLE_SIZE;
+template <typename V> const uint8_t CBoundedHashMap<V>::USED;
+template <typename V> const uint8_t CBoundedHashMap<V>::REFERENCED;
+
+/** Set of uint256 holding at most max_size() entries, see CBoundedHashMap. */
+class CBoundedHashSet {
+public:
+    typedef CBoundedHashMap<uint8_t>::Eviction Eviction;
+    typedef size_t size_type;
+
+    explicit CBoundedHashSet(size_type nMaxSizeIn = 0, Eviction evictionIn = CBoundedHashMap<uint8_t>::FIFO)
+        : map(nMaxSizeIn, evictionIn) {}
+
+    size_type size() const { return map.size(); }
+    bool empty() const { return map.empty(); }
+    size_type max_size() const { return map.max_size(); }
+    size_type max_size(size_type s) { return map.max_size(s); }
+    size_type count(const uint256 &key) const { return map.count(key); }
+    /** Returns true if key was not there. */
+    bool insert(const uint256 &key) { return map.insert(key, 1); }
+    bool erase(const uint256 &key) { return map.erase(key); }
+    void clear() { map.clear(); }
+
+private:
+    CBoundedHashMap<uint8_t> map;
+};
+
+#endif  // COMMONS_BOUNDEDHASH_H
@@ -0,0 +1,31 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "compress.h"
+
+#include "zstd.h"
+
+// Favours speed over ratio, blocks are relayed right after they are compressed
+static const int ZSTD_BLOCK_LEVEL = 1;
+
+void CompressZstd(const uint8_t *src, size_t srcSize, std::vector<uint8_t> &out) {
+    out.resize(ZSTD_compressBound(srcSize));
+    size_t nSize = ZSTD_compress(out.data(), out.size(), src, srcSize, ZSTD_BLOCK_LEVEL);
+    out.resize(ZSTD_isError(nSize) ? 0 : nSize);
+}
+
+bool DecompressZstd(const uint8_t *src, size_t srcSize, size_t rawSize, std::vector<uint8_t> &out) {
+    out.clear();
+    if (srcSize == 0)
+        return false;
+
+    out.resize(rawSize);
+    size_t nSize = ZSTD_decompress(out.data(), rawSize, src, srcSize);
+    if (ZSTD_isError(nSize) || nSize != rawSize) {
+        out.clear();
+        return false;
+    }
+
+    return true;
+}
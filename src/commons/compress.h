@@ -0,0 +1,26 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COMMONS_COMPRESS_H
+#define COMMONS_COMPRESS_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Byte compression into a zstd frame, backed by the upstream zstd vendored in external/zstd. Uses the fastest
+ * level, it is meant for block data that is compressed once and decompressed on every read or relay.
+ * out is left empty if the input can not be compressed.
+ */
+void CompressZstd(const uint8_t *src, size_t srcSize, std::vector<uint8_t> &out);
+
+/**
+ * Decompress data produced by CompressZstd(). rawSize must be the exact decompressed size, it bounds
+ * the output so that malformed input can not make it grow.
+ * @return false if the input is malformed or does not decompress to rawSize bytes
+ */
+bool DecompressZstd(const uint8_t *src, size_t srcSize, size_t rawSize, std::vector<uint8_t> &out);
+
+#endif  // COMMONS_COMPRESS_H
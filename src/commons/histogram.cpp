@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "histogram.h"
+
+#include <algorithm>
+
+CHistogramRegistry histogramRegistry;
+
+void CHistogram::Add(uint64_t value) {
+    int32_t i = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    if (i >= BUCKET_COUNT)
+        i = BUCKET_COUNT - 1;
+
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    nCount.fetch_add(1, std::memory_order_relaxed);
+    nSum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = nMax.load(std::memory_order_relaxed);
+    while (value > max && !nMax.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t CHistogram::GetPercentile(double q) const {
+    uint64_t count = GetCount();
+    if (count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(q * count + 0.5);
+    uint64_t seen = 0;
+    for (int32_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank && seen > 0)
+            return std::min(GetBucketLimit(i), GetMax());
+    }
+
+    return GetMax();
+}
+
+std::vector<uint64_t> CHistogram::GetBuckets() const {
+    std::vector<uint64_t> ret;
+    for (int32_t i = 0; i < BUCKET_COUNT; i++)
+        ret.push_back(buckets[i].load(std::memory_order_relaxed));
+
+    while (!ret.empty() && ret.back() == 0)
+        ret.pop_back();
+
+    return ret;
+}
+
+void CHistogram::Reset() {
+    for (auto &bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+
+    nCount.store(0, std::memory_order_relaxed);
+    nSum.store(0, std::memory_order_relaxed);
+    nMax.store(0, std::memory_order_relaxed);
+}
+
+CHistogram &CHistogramRegistry::Get(const std::string &name) {
+    LOCK(cs);
+    auto &spHistogram = mapHistograms[name];
+    if (!spHistogram)
+        spHistogram.reset(new CHistogram());
+
+    return *spHistogram;
+}
+
+std::vector<std::pair<std::string, const CHistogram *>> CHistogramRegistry::GetAll() const {
+    LOCK(cs);
+    std::vector<std::pair<std::string, const CHistogram *>> ret;
+    for (const auto &item : mapHistograms)
+        ret.emplace_back(item.first, item.second.get());
+
+    return ret;
+}
+
+void CHistogramRegistry::Reset() {
+    LOCK(cs);
+    for (auto &item : mapHistograms)
+        item.second->Reset();
+}
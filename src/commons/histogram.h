@@ -0,0 +1,86 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_HISTOGRAM_H
+#define COIN_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sync.h"
+#include "commons/util/time.h"
+
+/**
+ * Histogram of a non negative quantity, mostly latencies in microseconds, with power of two buckets:
+ * bucket 0 counts the zeros and bucket i the values in [2^(i-1), 2^i). Values are added with relaxed
+ * atomics, so it can be fed from any thread and read while it is fed.
+ */
+class CHistogram {
+public:
+    static const int32_t BUCKET_COUNT = 48;
+
+    CHistogram() { Reset(); }
+
+    void Add(uint64_t value);
+
+    uint64_t GetCount() const { return nCount.load(std::memory_order_relaxed); }
+    uint64_t GetSum() const { return nSum.load(std::memory_order_relaxed); }
+    uint64_t GetMax() const { return nMax.load(std::memory_order_relaxed); }
+
+    /** Upper bound of the bucket holding the q quantile, 0 <= q <= 1. */
+    uint64_t GetPercentile(double q) const;
+
+    /** Counts of the buckets, up to the last non empty one. */
+    std::vector<uint64_t> GetBuckets() const;
+
+    /** Upper bound (exclusive) of the values counted in bucket i. */
+    static uint64_t GetBucketLimit(int32_t i) { return i == 0 ? 1 : (uint64_t)1 << i; }
+
+    void Reset();
+
+private:
+    std::atomic<uint64_t> buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> nCount;
+    std::atomic<uint64_t> nSum;
+    std::atomic<uint64_t> nMax;
+};
+
+/** Adds the microseconds it lived to a histogram. */
+class CHistogramTimer {
+public:
+    explicit CHistogramTimer(CHistogram &histogramIn) : histogram(histogramIn), nStart(GetTimeMicros()) {}
+    ~CHistogramTimer() { histogram.Add(GetElapsed()); }
+
+    int64_t GetElapsed() const { return GetTimeMicros() - nStart; }
+
+private:
+    CHistogram &histogram;
+    int64_t nStart;
+};
+
+/**
+ * Named histograms. A histogram is created on first use and lives as long as the registry, so callers
+ * may keep the reference they get, e.g. in a function local static.
+ */
+class CHistogramRegistry {
+public:
+    CHistogram &Get(const std::string &name);
+
+    /** The names and histograms, sorted by name. */
+    std::vector<std::pair<std::string, const CHistogram *>> GetAll() const;
+
+    void Reset();
+
+private:
+    mutable CCriticalSection cs;
+    std::map<std::string, std::unique_ptr<CHistogram>> mapHistograms;
+};
+
+extern CHistogramRegistry histogramRegistry;
+
+#endif  // COIN_HISTOGRAM_H
@@ -1086,4 +1086,15 @@ shared_ptr<Benchmark> MakeBenchmark(const char *msg, const char *fileIn, int lin
 shared_ptr<Benchmark> MakeBenchmark(const char *msg, const char *fileIn, int lineIn,
                                     const char *funcIn, const Benchmark::Time &startIn) {
     return SysCfg().IsBenchmark() ? make_shared<Benchmark>(msg, fileIn, lineIn, funcIn, startIn) : nullptr;
+}
+
+shared_ptr<Benchmark> MakeBenchmark(const char *msg, const char *fileIn, int lineIn,
+                                    const char *funcIn, std::atomic<int64_t> *pTotal) {
+    if (!SysCfg().IsBenchmark() && pTotal == nullptr)
+        return nullptr;
+
+    auto bm    = make_shared<Benchmark>(msg, fileIn, lineIn, funcIn);
+    bm->fLog   = SysCfg().IsBenchmark();
+    bm->pTotal = pTotal;
+    return bm;
 }
\ No newline at end of file
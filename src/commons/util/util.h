@@ -19,6 +19,7 @@
 
 #include <stdarg.h>
 #include <stdint.h>
+#include <atomic>
 #include <cstdio>
 #include <exception>
 #include <map>
@@ -492,11 +493,18 @@ public:
                 endTime.time_since_epoch().count(), start.time_since_epoch().count(), fileIn,
                 lineIn, funcIn, "BENCHMARK", msgIn, us.count());
     }
-    inline void end() {
+    // returns the elapsed microseconds
+    inline int64_t end() {
         if (!is_end) {
-            log(msg, file, line, func, system_clock::now());
+            Time endTime = system_clock::now();
+            elapsed = std::chrono::duration_cast<std::chrono::microseconds>(endTime - start).count();
+            if (fLog)
+                log(msg, file, line, func, endTime);
+            if (pTotal != nullptr)
+                *pTotal += elapsed;
             is_end = true;
         }
+        return elapsed;
     }
     const char *msg  = nullptr;
     const char *file = nullptr;
@@ -505,6 +513,9 @@ public:
 
     Time start;
     bool is_end = false;
+    bool fLog   = true;
+    std::atomic<int64_t> *pTotal = nullptr;  // the elapsed microseconds are added to it, if set
+    int64_t elapsed = 0;
 };
 
 std::shared_ptr<Benchmark> MakeBenchmark(const char *msg, const char *fileIn, int lineIn,
@@ -513,7 +524,12 @@ std::shared_ptr<Benchmark> MakeBenchmark(const char *msg, const char *fileIn, in
 std::shared_ptr<Benchmark> MakeBenchmark(const char *msg, const char *fileIn, int lineIn,
                                          const char *funcIn, const Benchmark::Time &startIn);
 
+/** Also adds the elapsed time to *pTotal, without -benchmark too. Returns null if there is nothing to do. */
+std::shared_ptr<Benchmark> MakeBenchmark(const char *msg, const char *fileIn, int lineIn,
+                                         const char *funcIn, std::atomic<int64_t> *pTotal);
+
 #define MAKE_BENCHMARK(msg) MakeBenchmark(msg, __FILE__, __LINE__, __func__)
 #define MAKE_BENCHMARK_START(msg, start) MakeBenchmark(msg, __FILE__, __LINE__, __func__, start)
+#define MAKE_BENCHMARK_TOTAL(msg, pTotal) MakeBenchmark(msg, __FILE__, __LINE__, __func__, pTotal)
 
 #endif
\ No newline at end of file
@@ -78,6 +78,7 @@ protected:
     mutable int32_t nMaxForkTime;  // to limit the maximum fork time in seconds.
     mutable bool fGenBlock = false;  // whether to generate block on startup
     mutable bool fForcedConfirmBlock = false;  // whether to confirm block by block-producer forcedly
+    mutable bool fCompressBlocks = false;  // whether to write new blocks compressed to block files
 
 
 public:
@@ -171,6 +172,7 @@ public:
     int32_t GetTxCacheHeight() const { return nTxCacheHeight; }
     bool IsGenBlock() const { return fGenBlock; };
     bool IsForcedConfirmBlock() const { return fForcedConfirmBlock; };
+    bool IsCompressBlocks() const { return fCompressBlocks; };
     void SetImporting(bool flag) const { fImporting = flag; }
     void SetReIndex(bool flag) const { fReindex = flag; }
     void SetBenchMark(bool flag) const { fBenchmark = flag; }
@@ -181,6 +183,7 @@ public:
     void SetBestRecvTime(int64_t nTime) const { nTimeBestReceived = nTime; }
     void SetGenBlock(bool flag) const { fGenBlock = flag; }
     void SetForcedConfirmBlock(bool flag) const { fForcedConfirmBlock = flag; }
+    void SetCompressBlocks(bool flag) const { fCompressBlocks = flag; }
     // use for cdp interest
     uint32_t GetOneDayBlocks(const int32_t currBlockHeight) const;
     int32_t GetMaxForkHeight(int32_t currBlockHeight) const;
@@ -149,8 +149,16 @@ static const uint64_t DUST_AMOUNT_THRESHOLD = 10000;
 
 /** The maximum allowed size for a serialized block, in bytes (network rule) */
 static const uint32_t MAX_BLOCK_SIZE = 4000000;
+/** Set in the size field of a block file record when the block is stored compressed (-compressblocks) */
+static const uint32_t BLOCK_FILE_COMPRESSED = 0x80000000;
 /** Default for -blockmaxsize which control the range of sizes the mining code will create **/
 static const uint32_t DEFAULT_BLOCK_MAX_SIZE = 3750000;
+/** Default for -blocktemplate, keep a block executed ahead of the tip for the next local block producer */
+static const bool DEFAULT_BLOCK_TEMPLATE = true;
+/** Milliseconds between two rounds of the block template builder */
+static const int64_t BLOCK_TEMPLATE_INTERVAL_MS = 200;
+/** Milliseconds the block template builder holds cs_main for in one round */
+static const int64_t BLOCK_TEMPLATE_LOCK_MS = 50;
 
 /** The maximum size for transactions we're willing to relay/mine */
 static const uint32_t MAX_STANDARD_TX_SIZE = 100000;
@@ -159,10 +167,55 @@ static const uint32_t MAX_CONTRACT_TX_SIZE = 800000;
 
 /** The maximum number of orphan blocks kept in memory */
 static const uint32_t MAX_ORPHAN_BLOCKS = 750;
+/** Default for -maxorphanmem, megabytes of orphan blocks held in memory */
+static const uint32_t DEFAULT_MAX_ORPHAN_MEM = 32;
+/** Default for -maxorphandisk, megabytes of orphan blocks spilled to a temporary file */
+static const uint32_t DEFAULT_MAX_ORPHAN_DISK = 512;
+/** Default for -mempoolfullrescan, every <n> tip updates all the mempool txes are executed again */
+static const uint32_t DEFAULT_MEMPOOL_FULL_RESCAN = 100;
+/** Above this many keys written since the last mempool rescan, all the mempool txes are executed again */
+static const uint32_t MAX_MEMPOOL_DIRTY_KEYS = 200000;
+/** Default for -maxmempool, megabytes of txes and of their cache overlay kept in the mempool */
+static const uint32_t DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** Default for -maxmempoolsender, txes of one sender kept in the mempool */
+static const uint32_t DEFAULT_MAX_MEMPOOL_SENDER_TXS = 500;
+/** Once the mempool evicts a tx, a new tx must pay this much more per KB (in sawi) than the evicted one */
+static const uint64_t MEMPOOL_FEE_INCREMENT = MIN_RELAY_TX_FEE;
+/** Half life of the mempool minimum fee in seconds, shorter while the mempool is far from full */
+static const int64_t MEMPOOL_FEE_HALFLIFE = 60 * 60 * 12;
+/** Default for -persistmempool */
+static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Seconds between two dumps of the mempool to mempool.dat */
+static const int64_t DUMP_MEMPOOL_INTERVAL = 60 * 15;
+/** Format version of mempool.dat */
+static const uint32_t MEMPOOL_DUMP_VERSION = 1;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int32_t MAX_BLOCKS_IN_TRANSIT_PER_PEER = 128;
 /** Timeout in seconds before considering a block download peer unresponsive. */
 static const uint32_t BLOCK_DOWNLOAD_TIMEOUT  = 60;
+/** Maximum number of headers returned by one getheaders request. */
+static const int32_t MAX_HEADERS_RESULTS = 2000;
+/** Maximum number of headers kept ahead of the active tip during headers-first sync. */
+static const int32_t MAX_HEADERS_AHEAD = 4 * MAX_HEADERS_RESULTS;
+/** Blocks above the active tip that may be downloaded in parallel. Out-of-order blocks wait in the orphan pool,
+ *  so the window must stay below MAX_ORPHAN_BLOCKS. */
+static const int32_t BLOCK_DOWNLOAD_WINDOW = 512;
+/** Seconds between two scans of the download window from the active tip, to catch blocks given up on any path. */
+static const int64_t BLOCK_SCHEDULE_RESCAN_INTERVAL = 10;
+/** Maximum number of pre-checked blocks waiting to be connected. */
+static const uint32_t MAX_CHECKED_BLOCKS_QUEUE = 64;
+/** Maximum number of compact blocks waiting for their missing transactions. */
+static const uint32_t MAX_PARTIAL_BLOCKS = 16;
+/** Maximum number of compact blocks of a single peer waiting for their missing transactions. */
+static const uint32_t MAX_PARTIAL_BLOCKS_PER_PEER = 4;
+/** Maximum number of blocks read ahead of the connect stage while importing block files. */
+static const uint32_t MAX_IMPORT_BLOCKS_QUEUE = 1024;
+/** Maximum size in bytes of the blocks read ahead of the connect stage while importing block files. */
+static const uint64_t MAX_IMPORT_QUEUE_BYTES = 64 * 1024 * 1024;
+/** Interval in blocks of the import throughput logs. */
+static const uint32_t IMPORT_LOG_INTERVAL = 10000;
+/** Maximum number of block undo records waiting to be written to disk. */
+static const uint32_t MAX_UNDO_WRITE_QUEUE = 256;
 
 /** Minimum disk space required */
 static const uint64_t MIN_DISK_SPACE = 52428800;
@@ -229,5 +282,7 @@ static const uint32_t ACTIVATE_DELEGATE_DELAY_AFTER_V3 = 100;   //<! activate de
 ////////////////////////////////////////////////////////////////////////////////
 // pBFT
 static const uint32_t PBFT_LATEST_BLOCK_COUNT = 500; // the max processing letest block count of pbft
+static const bool DEFAULT_PBFT_BATCH = true;            // default for -pbftbatch, ask peers to batch confirm/finality messages
+static const uint32_t MAX_PBFT_BATCH_SIGNATURES = 1000; // the max signatures in one confirmblocks/finblocks message
 
 #endif //CONFIG_CONST_H
\ No newline at end of file
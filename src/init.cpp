@@ -18,10 +18,15 @@
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #include "main.h"
+#include "chain/orphanpool.h"
 #include "miner/miner.h"
+#include "miner/pbftmanager.h"
 #include "net.h"
 #include "p2p/node.h"
+#include "p2p/chainmessage.h"
 #include "persistence/blockdb.h"
+#include "persistence/blockundo.h"
+#include "txadmissionqueue.h"
 #include "persistence/accountdb.h"
 #include "persistence/txdb.h"
 #include "persistence/contractdb.h"
@@ -146,6 +151,9 @@ void Shutdown() {
     StopNode();
     UnregisterNodeSignals(GetNodeSignals());
 
+    if (SysCfg().GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        DumpMempool();
+
     {
         LOCK(cs_main);
 
@@ -155,7 +163,7 @@ void Shutdown() {
         }
 
         if (pCdMan != nullptr) {
-            pCdMan->Flush();
+            FlushChainState();
             delete pCdMan;
             pCdMan = nullptr;
         }
@@ -218,8 +226,18 @@ string HelpMessage() {
     strUsage += "  -daemon                " + _("Run in the background as a daemon and accept commands") + "\n";
 #endif
     strUsage += "  -datadir=<dir>         " + _("Specify data directory") + "\n";
+    strUsage += "  -compressblocks        " + _("Write new blocks to blk000??.dat files compressed (default: 0)") + "\n";
     strUsage += "  -dbcache=<n>           " + strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), MIN_DB_CACHE, MAX_DB_CACHE, DEFAULT_DB_CACHE) + "\n";
     strUsage += "  -loadblock=<file>      " + _("Imports blocks from external blk000??.dat file") + " " + _("on startup") + "\n";
+    strUsage += "  -importthreads=<n>     " + _("Number of threads checking blocks while reindexing or importing (default: number of cores - 1)") + "\n";
+    strUsage += "  -sigcheckthreads=<n>   " + _("Number of threads helping to verify batches of signatures, 0 to verify them on the calling thread (default: number of cores - 1)") + "\n";
+    strUsage += "  -txcheckthreads=<n>    " + _("Number of threads checking relayed txes before they are accepted into the mempool, 0 to check them on the message handler thread (default: number of cores - 1)") + "\n";
+    strUsage += "  -maxorphanmem=<n>      " + strprintf(_("Keep at most <n> MB of orphan blocks in memory (default: %u)"), DEFAULT_MAX_ORPHAN_MEM) + "\n";
+    strUsage += "  -maxorphandisk=<n>     " + strprintf(_("Spill at most <n> MB of orphan blocks to a temporary file in the data directory (default: %u)"), DEFAULT_MAX_ORPHAN_DISK) + "\n";
+    strUsage += "  -mempoolfullrescan=<n> " + strprintf(_("Execute all the mempool txes again every <n> tip updates, only the ones depending on the new blocks otherwise (default: %u)"), DEFAULT_MEMPOOL_FULL_RESCAN) + "\n";
+    strUsage += "  -maxmempool=<n>        " + strprintf(_("Keep the mempool txes and their cache overlay below <n> MB, evicting the lowest fee rates (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE) + "\n";
+    strUsage += "  -maxmempoolsender=<n>  " + strprintf(_("Keep at most <n> mempool txes of one sender, 0 for no limit (default: %u)"), DEFAULT_MAX_MEMPOOL_SENDER_TXS) + "\n";
+    strUsage += "  -persistmempool        " + strprintf(_("Save the mempool to mempool.dat on shutdown and load it on startup (default: %u)"), DEFAULT_PERSIST_MEMPOOL) + "\n";
     strUsage += "  -pid=<file>            " + _("Specify pid file (default: coin.pid)") + "\n";
     strUsage += "  -reindex               " + _("Rebuild block chain index from current blk000??.dat files") + " " + _("on startup") + "\n";
     strUsage += "  -txindex               " + _("Maintain a full transaction index (default: 0)") + "\n";
@@ -245,6 +263,7 @@ string HelpMessage() {
     strUsage += "  -maxsendbuffer=<n>     " + _("Maximum per-connection send buffer, <n>*1000 bytes (default: 1000)") + "\n";
     strUsage += "  -onion=<ip:port>       " + _("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: -proxy)") + "\n";
     strUsage += "  -onlynet=<net>         " + _("Only connect to nodes in network <net> (IPv4, IPv6 or Tor)") + "\n";
+    strUsage += "  -pbftbatch             " + strprintf(_("Ask peers to send the pbft confirm and finality messages of a block in one batch (default: %u)"), DEFAULT_PBFT_BATCH) + "\n";
     strUsage += "  -port=<port>           " + _("Listen for connections on <port> (default: 8333 or testnet: 18333)") + "\n";
     strUsage += "  -proxy=<ip:port>       " + _("Connect through SOCKS proxy") + "\n";
     strUsage += "  -ipserver=<server>     " + _("IP Reporting Service") + "\n";
@@ -309,6 +328,7 @@ string HelpMessage() {
 
     strUsage += "\n" + _("Block creation options:") + "\n";
     strUsage += "  -blockmaxsize=<n>      " + strprintf(_("Set maximum block size in bytes (default: %d)"), DEFAULT_BLOCK_MAX_SIZE) + "\n";
+    strUsage += "  -blocktemplate         " + strprintf(_("Execute the mempool txes ahead of the next local block producer slot (default: %u)"), DEFAULT_BLOCK_TEMPLATE) + "\n";
 
     strUsage += "\n" + _("RPC server options:") + "\n";
     strUsage += "  -rpcserver             " + _("Accept command line and JSON-RPC commands") + "\n";
@@ -394,6 +414,10 @@ void ThreadImport(vector<boost::filesystem::path> vImportFiles) {
             LogPrint(BCLog::INFO, "Warning: Could not open blocks file %s\n", path.string());
         }
     }
+
+    // mempool.dat, once the blocks are in so the txes are checked against the current tip
+    if (SysCfg().GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        LoadMempool();
 }
 
 /** Initialize native_modules
@@ -542,7 +566,10 @@ bool AppInit(boost::thread_group &threadGroup) {
         nMaxConnections = nFD - MIN_CORE_FILEDESCRIPTORS;
 
     SysCfg().SetBenchMark(SysCfg().GetBoolArg("-benchmark", false));
+    SysCfg().SetCompressBlocks(SysCfg().GetBoolArg("-compressblocks", false));
     mempool.SetSanityCheck(SysCfg().GetBoolArg("-checkmempool", RegTest()));
+    mempool.SetLimits((uint64_t)SysCfg().GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1024 * 1024,
+                      SysCfg().GetArg("-maxmempoolsender", DEFAULT_MAX_MEMPOOL_SENDER_TXS));
 
     setvbuf(stdout, nullptr, _IOLBF, 0);
 
@@ -794,7 +821,7 @@ bool AppInit(boost::thread_group &threadGroup) {
     if (SysCfg().IsArgCount("-printblock")) {
         string strMatch = SysCfg().GetArg("-printblock", "");
         int32_t nFound  = 0;
-        for (map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
+        for (CBlockIndexMap::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
             uint256 hash = (*mi).first;
             if (strncmp(hash.ToString().c_str(), strMatch.c_str(), strMatch.size()) == 0) {
                 CBlockIndex *pIndex = (*mi).second;
@@ -847,8 +874,34 @@ bool AppInit(boost::thread_group &threadGroup) {
         }
 
     }
+    // Orphan blocks beyond the memory budget go to a temporary file
+    orphanBlocks.Init(GetDataDir() / "orphanblocks.tmp",
+                      (uint64_t)SysCfg().GetArg("-maxorphanmem", DEFAULT_MAX_ORPHAN_MEM) * 1024 * 1024,
+                      (uint64_t)SysCfg().GetArg("-maxorphandisk", DEFAULT_MAX_ORPHAN_DISK) * 1024 * 1024);
+
+    // Write block undo data in the background
+    threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()>>, "undowriter",
+                                          boost::function<void()>(boost::bind(&CBlockUndoWriter::ThreadWrite, &undoWriter))));
+
+    // Help verifying the signatures of multi-signature txes and blocks
+    int32_t nSigCheckThreads = SysCfg().GetArg("-sigcheckthreads", max((int32_t)boost::thread::hardware_concurrency() - 1, 1));
+    for (int32_t i = 0; i < nSigCheckThreads; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()>>, "sigcheck",
+                                              boost::function<void()>(boost::bind(&CSigCheckQueue::ThreadCheck, &sigCheckQueue))));
+
+    // Check relayed txes concurrently before accepting them into the mempool
+    int32_t nTxCheckThreads = SysCfg().GetArg("-txcheckthreads", max((int32_t)boost::thread::hardware_concurrency() - 1, 1));
+    for (int32_t i = 0; i < nTxCheckThreads; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()>>, "txadmit",
+                                              boost::function<void()>(boost::bind(&CTxAdmissionQueue::ThreadAdmit, &txAdmissionQueue))));
+
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
 
+    // Save the mempool now and then, so a crash does not lose all of it
+    if (SysCfg().GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        threadGroup.create_thread(boost::bind(&LoopForever<void (*)()>, "dumpmempool", &DumpMempool,
+                                              DUMP_MEMPOOL_INTERVAL * 1000));
+
 
     nStart = GetTimeMillis();
     {
@@ -867,6 +920,12 @@ bool AppInit(boost::thread_group &threadGroup) {
 
     StartNode(threadGroup);
 
+    // Connect the blocks pre-checked by the message handler
+    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "blockconnect", &ThreadBlockConnect));
+
+    // Check the pbft messages off the message handler thread
+    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "pbft", &ThreadPBFTIntake));
+
     if (SysCfg().IsServer()) {
         if (!StartRPCServer()) {
             return InitError(_("Failed to start RPC server. "));
@@ -26,6 +26,9 @@
 #include "p2p/processmessage.hpp"
 #include "p2p/sendmessage.hpp"
 #include "chain/blockdelegates.h"
+#include "chain/orphanpool.h"
+#include "chain/reorgstats.h"
+#include "commons/histogram.h"
 #include "persistence/blockundo.h"
 #include "tx/txserializer.h"
 
@@ -50,11 +53,13 @@ using namespace boost;
 CCacheDBManager *pCdMan = nullptr;
 CCriticalSection cs_main;
 CTxMemPool mempool;
-map<uint256, CBlockIndex *> mapBlockIndex;
+CBlockIndexMap mapBlockIndex;
 int32_t nSyncTipHeight = 0;
 string publicIp;
 map<uint256/* blockhash */, std::shared_ptr<CCacheWrapper>> mapForkCache;
 CSignatureCache signatureCache;
+CConnectBlockStats connectBlockStats;
+CArena connectBlockArena;
 CChainActive chainActive;
 CChain chainMostWork;
 // may contain all CBlockIndex*'s that have validness >=BLOCK_VALID_TRANSACTIONS, and must contain those who aren't
@@ -66,9 +71,6 @@ CKeyID nodeKeyId;   // 1st keyId of the node
 extern CPBFTMan pbftMan;
 
 extern map<uint256, NodeId> mapBlockSource;  // Remember who we got this block from.
-map<uint256/* blockhash */, COrphanBlock *> mapOrphanBlocks;
-multimap<uint256/* blockhash */, COrphanBlock *> mapOrphanBlocksByPrev;
-map<uint256/* blockhash */, std::shared_ptr<CBaseTx> > mapOrphanTransactions;
 const string strMessageMagic = "Coin Signed Message:\n";
 
 
@@ -82,19 +84,6 @@ namespace {
 
 CBlockIndex *pIndexBestInvalid;
 
-struct COrphanBlockComparator {
-    bool operator()(COrphanBlock *pa, COrphanBlock *pb) const{
-        if (pa->height > pb->height)
-            return false;
-
-        if (pa->height < pb->height)
-            return true;
-
-        return false;
-    }
-};
-set<COrphanBlock *, COrphanBlockComparator> setOrphanBlock;  //set of Orphan Blocks
-
 CCriticalSection cs_LastBlockFile;
 CBlockFileInfo infoLastBlockFile;
 int32_t nLastBlockFile = 0;
@@ -108,7 +97,12 @@ uint32_t nBlockSequenceId = 1;
 
 }  // namespace
 
+void static FlushBlockFile(bool fFinalize = false);
+
 static bool UpdateBlockIndexDB(CBlockIndex *pIndex) {
+    // Make sure a queued index of this block doesn't overwrite the update
+    FlushBlockFile();
+
     CDiskBlockIndex diskBlockIndex;
     if (!pCdMan->pBlockIndexDb->GetBlockIndex(pIndex->GetBlockHash(), diskBlockIndex)) {
         return ERRORMSG("the index of block=%s not exist in db", pIndex->GetIdString());
@@ -190,7 +184,6 @@ void UnregisterNodeSignals(CNodeSignals &nodeSignals) {
 }
 
 bool IsStandardTx(CBaseTx *pBaseTx, string &reason) {
-    AssertLockHeld(cs_main);
     if (pBaseTx->nVersion > CBaseTx::CURRENT_VERSION || pBaseTx->nVersion < 1) {
         reason = "version";
         return false;
@@ -214,6 +207,23 @@ bool IsStandardTx(CBaseTx *pBaseTx, string &reason) {
     return true;
 }
 
+void CConnectBlockStats::SetNull() {
+    nSigChecks        = 0;
+    nSigCheckTime     = 0;
+    nBlocks           = 0;
+    nTxs              = 0;
+    nReadBlockTime    = 0;
+    nConnectBlockTime = 0;
+    nTxExecuteTime    = 0;
+    nTxSigCheckTime   = 0;
+    nCacheFlushTime   = 0;
+    nChainStateTime   = 0;
+    mapTxTypeTime.clear();
+}
+
+// Signature check time of the current thread, to split it out of the tx execution time
+static thread_local int64_t nThreadSigCheckTime = 0;
+
 bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey) {
     if (signature.size() == 0 && signature.size() >= MAX_SIGNATURE_SIZE) {
         return false;
@@ -223,8 +233,13 @@ bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signatu
         return true;
 
     {
-        auto bm = MAKE_BENCHMARK("execute pubkey verify");
-        if (!pubKey.Verify(sigHash, signature))
+        auto bm = MAKE_BENCHMARK_TOTAL("execute pubkey verify", connectBlockStats.Collect(connectBlockStats.nSigCheckTime));
+        bool fVerified = pubKey.Verify(sigHash, signature);
+        if (bm && connectBlockStats.fEnabled) {
+            connectBlockStats.nSigChecks++;
+            nThreadSigCheckTime += bm->end();
+        }
+        if (!fVerified)
             return false;
     }
 
@@ -232,8 +247,50 @@ bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signatu
     return true;
 }
 
-bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
-                        bool fLimitFree, bool fRejectInsaneFee) {
+bool PreCheckTxForMemPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx) {
+    auto bm = MAKE_BENCHMARK("PreCheckTxForMemPool");
+    uint256 hash = pBaseTx->GetHash();
+    if (pool.Exists(hash))
+        return state.Invalid(ERRORMSG("PreCheckTxForMemPool() : txid: %s already in mempool", hash.GetHex()),
+                            REJECT_INVALID, "tx-already-in-mempool");
+
+    if (pBaseTx->IsRelayForbidden())
+        return state.Invalid(ERRORMSG("PreCheckTxForMemPool() : forbid tx=%s to accept to memory pool! txid=%s",
+            pBaseTx->GetTxTypeName(), hash.GetHex()), REJECT_INVALID, "tx-coinbase-to-mempool");
+
+    string reason;
+    if (SysCfg().NetworkID() == MAIN_NET && !IsStandardTx(pBaseTx, reason))
+        return state.DoS(0, ERRORMSG("PreCheckTxForMemPool() : txid: %s is nonstandard transaction due to %s",
+                        hash.GetHex(), reason), REJECT_NONSTANDARD, reason);
+
+    // The pubkeys of the signers come from the account db without cs_main, leveldb reads are thread safe. The
+    // signers not flushed there yet are left to the accept stage. The db may be behind the tip, so a signature
+    // failing against it is checked again on the pubkeys of the mempool view before the tx is turned away.
+    vector<CSignatureCheck> checks;
+    {
+        CAccountDBCache accountSnapshot(pCdMan->pAccountDb);
+        pBaseTx->GetSignatureChecks(accountSnapshot, checks);
+    }
+
+    vector<uint8_t> results;
+    if (VerifySignatures(checks, results))
+        return true;
+
+    checks.clear();
+    {
+        LOCK2(cs_main, pool.cs);
+        pBaseTx->GetSignatureChecks(pool.cw->accountCache, checks);
+    }
+    if (!VerifySignatures(checks, results))
+        return state.DoS(100, ERRORMSG("PreCheckTxForMemPool() : txid: %s signature error", hash.GetHex()),
+                         REJECT_INVALID, "bad-tx-signature");
+
+    return true;
+}
+
+// spOwnedTx is either null or the owner of pBaseTx, the mempool entry adopts it rather than cloning pBaseTx
+static bool AcceptTxToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
+                                 const std::shared_ptr<CBaseTx> &spOwnedTx, bool fLimitFree, bool fRejectInsaneFee) {
     AssertLockHeld(cs_main);
 
     auto bm = MAKE_BENCHMARK("AcceptToMemoryPool");
@@ -271,7 +328,8 @@ bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBas
             return ERRORMSG("AcceptToMemoryPool() : CheckBaseTx/CheckTx failed, txid: %s", hash.GetHex());
     }
 
-    CTxMemPoolEntry entry(pBaseTx, GetTime(), newHeight);
+    CTxMemPoolEntry entry = spOwnedTx ? CTxMemPoolEntry(spOwnedTx, GetTime(), newHeight)
+                                      : CTxMemPoolEntry(pBaseTx, GetTime(), newHeight);
     auto nFees = std::get<1>(entry.GetFees());
     auto nSize = entry.GetTxSize();
     // Continuously rate-limit free trx
@@ -300,21 +358,28 @@ bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBas
     if (fRejectInsaneFee && nFees > SysCfg().GetMaxFee())
         return ERRORMSG("AcceptToMemoryPool() : txid: %s pay insane fees, %d > %d", hash.GetHex(), nFees, SysCfg().GetMaxFee());
 
-    return pool.AddUnchecked(hash, entry, state);
+    return pool.AddUnchecked(hash, std::move(entry), state);
+}
+
+bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
+                        bool fLimitFree, bool fRejectInsaneFee) {
+    return AcceptTxToMemoryPool(pool, state, pBaseTx, nullptr, fLimitFree, fRejectInsaneFee);
+}
+
+bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, const std::shared_ptr<CBaseTx> &spBaseTx,
+                        bool fLimitFree, bool fRejectInsaneFee) {
+    return AcceptTxToMemoryPool(pool, state, spBaseTx.get(), spBaseTx, fLimitFree, fRejectInsaneFee);
 }
 
 int32_t GetTxConfirmHeight(const uint256 &hash, CBlockDBCache &blockCache) {
     if (SysCfg().IsTxIndex()) {
         CDiskTxPos diskTxPos;
         if (blockCache.ReadTxIndex(hash, diskTxPos)) {
-            CAutoFile file(OpenBlockFile(diskTxPos, true), SER_DISK, CLIENT_VERSION);
+            // the record may be compressed, read it the same way as ReadBlockFromDisk does
             CBlockHeader header;
-            try {
-                file >> header;
-            } catch (std::exception &e) {
-                ERRORMSG("Deserialize or I/O error - %s", e.what());
+            if (!ReadBlockHeaderFromDisk(diskTxPos, header))
                 return -1;
-            }
+
             return header.GetHeight();
         }
     }
@@ -338,63 +403,14 @@ bool GetTransaction(std::shared_ptr<CBaseTx> &pBaseTx, const uint256 &hash, CBlo
         if (SysCfg().IsTxIndex()) {
             CDiskTxPos diskTxPos;
             if (blockCache.ReadTxIndex(hash, diskTxPos)) {
-                CAutoFile file(OpenBlockFile(diskTxPos, true), SER_DISK, CLIENT_VERSION);
                 CBlockHeader header;
-                try {
-                    file >> header;
-                    fseek(file, diskTxPos.nTxOffset, SEEK_CUR);
-                    file >> pBaseTx;
-                } catch (std::exception &e) {
-                    return ERRORMSG("Deserialize or I/O error - %s", e.what());
-                }
-                return true;
+                return ReadTxFromBlockFile(diskTxPos, header, pBaseTx);
             }
         }
     }
     return false;
 }
 
-uint256 GetOrphanRoot(const uint256 &hash) {
-    map<uint256, COrphanBlock *>::iterator it = mapOrphanBlocks.find(hash);
-    if (it == mapOrphanBlocks.end())
-        return hash;
-
-    // Work back to the first block in the orphan chain
-    do {
-        map<uint256, COrphanBlock *>::iterator it2 = mapOrphanBlocks.find(it->second->prevBlockHash);
-        if (it2 == mapOrphanBlocks.end())
-            return it->first;
-        it = it2;
-    } while (true);
-}
-
-// Remove a random orphan block (which does not have any dependent orphans).
-bool static PruneOrphanBlocks(int32_t height) {
-    if (mapOrphanBlocksByPrev.size() <= MAX_ORPHAN_BLOCKS) {
-        return true;
-    }
-
-    COrphanBlock *pOrphanBlock = *setOrphanBlock.rbegin();
-    if (pOrphanBlock->height <= height) {
-        return false;
-    }
-    uint256 hash     = pOrphanBlock->blockHash;
-    uint256 prevHash = pOrphanBlock->prevBlockHash;
-    setOrphanBlock.erase(pOrphanBlock);
-    multimap<uint256, COrphanBlock *>::iterator beg = mapOrphanBlocksByPrev.lower_bound(prevHash);
-    multimap<uint256, COrphanBlock *>::iterator end = mapOrphanBlocksByPrev.upper_bound(prevHash);
-    while (beg != end) {
-        if (beg->second->blockHash == hash) {
-            mapOrphanBlocksByPrev.erase(beg);
-            break;
-        }
-        ++beg;
-    }
-    mapOrphanBlocks.erase(hash);
-    delete pOrphanBlock;
-    return true;
-}
-
 bool fLargeWorkForkFound         = false;
 bool fLargeWorkInvalidChainFound = false;
 CBlockIndex *pIndexBestForkTip   = nullptr;
@@ -534,6 +550,8 @@ void static InvalidBlockFound(CBlockIndex *pIndex, CBlock &block, const CValidat
     if (!state.CorruptionPossible()) {
         pIndex->nStatus |= BLOCK_FAILED_VALID;
         const auto &bpRegid = GetBlockBpRegid(block);
+        // a queued index of this block must not overwrite the failed status
+        FlushBlockFile();
         pCdMan->pBlockIndexDb->WriteBlockIndex(CDiskBlockIndex(pIndex, block, bpRegid));
         setBlockIndexValid.erase(pIndex);
         InvalidChainFound(pIndex);
@@ -593,8 +611,8 @@ bool ReconsiderBlock(CValidationState &state, CBlockIndex *pIndex, bool children
     AssertLockHeld(cs_main);
 
     // Remove the invalidity flag from this block and all its descendants.
-    map<uint256, CBlockIndex *>::const_iterator it = mapBlockIndex.begin();
-    int32_t height                                    = pIndex->height;
+    CBlockIndexMap::const_iterator it = mapBlockIndex.begin();
+    int32_t height                    = pIndex->height;
     if (children) {
         while (it != mapBlockIndex.end()) {
             if (it->second->nStatus & BLOCK_FAILED_MASK && it->second->GetAncestor(height) == pIndex) {
@@ -637,8 +655,14 @@ bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CVal
     if (pos.IsNull())
         return ERRORMSG("no undo data available");
 
+    static CHistogram &histUndoRead = histogramRegistry.Get("chain.undo_read");
+    int64_t nUndoReadStart = GetTimeMicros();
     if (!blockUndo.ReadFromDisk(pos, pIndex->pprev->GetBlockHash()))
         return ERRORMSG("failure reading undo data");
+    int64_t nUndoReadTime = GetTimeMicros() - nUndoReadStart;
+    histUndoRead.Add(nUndoReadTime);
+    if (reorgStats.Current() != nullptr)
+        reorgStats.Current()->nUndoReadTime += nUndoReadTime;
 
     if ((blockUndo.vtxundo.size() != block.vptx.size()) && (blockUndo.vtxundo.size() != (block.vptx.size() + 1)))
         return ERRORMSG("block and undo data inconsistent");
@@ -685,26 +709,43 @@ bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CVal
     }
 }
 
-void static FlushBlockFile(bool fFinalize = false) {
-    LOCK(cs_LastBlockFile);
+void static FlushBlockFile(bool fFinalize) {
+    // Write the queued undo data first, it is committed with the undo file below
+    if (!undoWriter.Flush())
+        AbortNode(_("Error: failed to write undo data"));
 
-    CDiskBlockPos posOld(nLastBlockFile, 0);
+    {
+        LOCK(cs_LastBlockFile);
 
-    FILE *fileOld = OpenBlockFile(posOld);
-    if (fileOld) {
-        if (fFinalize)
-            TruncateFile(fileOld, infoLastBlockFile.nSize);
-        FileCommit(fileOld);
-        fclose(fileOld);
-    }
+        CDiskBlockPos posOld(nLastBlockFile, 0);
 
-    fileOld = OpenUndoFile(posOld);
-    if (fileOld) {
-        if (fFinalize)
-            TruncateFile(fileOld, infoLastBlockFile.nUndoSize);
-        FileCommit(fileOld);
-        fclose(fileOld);
+        FILE *fileOld = OpenBlockFile(posOld);
+        if (fileOld) {
+            if (fFinalize)
+                TruncateFile(fileOld, infoLastBlockFile.nSize);
+            FileCommit(fileOld);
+            fclose(fileOld);
+        }
+
+        fileOld = OpenUndoFile(posOld);
+        if (fileOld) {
+            if (fFinalize)
+                TruncateFile(fileOld, infoLastBlockFile.nUndoSize);
+            FileCommit(fileOld);
+            fclose(fileOld);
+        }
     }
+
+    // The block and undo data are on disk, the indexes referencing them may be written now
+    if (!undoWriter.WriteBlockIndexes())
+        AbortNode(_("Error: failed to write block index"));
+}
+
+void FlushChainState() {
+    AssertLockHeld(cs_main);
+    FlushBlockFile();
+    pCdMan->Flush();
+    mapForkCache.clear();
 }
 
 static bool FindUndoPos(CValidationState &state, int32_t nFile, CDiskBlockPos &pos, uint32_t nAddSize) {
@@ -880,8 +921,8 @@ bool SaveTxIndex(const uint256 &txid, CCacheWrapper &cw, CValidationState &state
 }
 
 // compute vote staking interest && revoke votes
-static bool ComputeVoteStakingInterestAndRevokeVotes(const uint256& blockHash, const int32_t currHeight, const uint32_t currBlockTime,
-                                                    CCacheWrapper &cw, CValidationState &state) {
+bool ComputeVoteStakingInterestAndRevokeVotes(const uint256& blockHash, const int32_t currHeight, const uint32_t currBlockTime,
+                                              CCacheWrapper &cw, CValidationState &state) {
     // acquire votes list
     map<CRegIDKey, vector<CCandidateReceivedVote>> regId2ReceivedVotes;
     if (!cw.delegateCache.GetVoterList(regId2ReceivedVotes)) {
@@ -889,38 +930,23 @@ static bool ComputeVoteStakingInterestAndRevokeVotes(const uint256& blockHash, c
                          REJECT_INVALID, "bad-get-vote-list");
     }
 
-    // revoke votes if necessary
-    map<CRegID, vector<CCandidateVote>> regId2CandidateVotes;
+    // votes revoked from each delegate, summed over all the voters and applied once per delegate. Keyed by
+    // keyid, which every account has, as the candidate uid may be a pubkey
+    map<CKeyID, uint64_t> delegateRevokedVotes;
+    vector<CReceipt> receipts;
     for (auto &item : regId2ReceivedVotes) {
         const CRegID &regId = item.first.regid;
         auto &candidateReceivedVotes = item.second;
-        vector<CCandidateVote> candidateVotes;
         assert(!candidateReceivedVotes.empty());
-        // If the voter only votes to one candidate, not bother to revoke votes.
-        if (candidateReceivedVotes.size() == 1) {
-            regId2CandidateVotes.emplace(regId, candidateVotes /* empty */);
-            continue;
-        }
 
         // If the voter votes to more than one candidates, need to revoke votes from the second
         // candidates.
-        auto it = candidateReceivedVotes.begin();
-        ++it;  // skip the first item
-        for (; it < candidateReceivedVotes.end(); ++it) {
-            const auto &uid  = it->GetCandidateUid();
-            const auto votes = it->GetVotedBcoins();
-            candidateVotes.emplace_back(VoteType::MINUS_BCOIN, uid, votes);  // revoke votes
+        vector<CCandidateVote> candidateVotes;
+        for (auto it = candidateReceivedVotes.begin() + 1; it < candidateReceivedVotes.end(); ++it) {
+            candidateVotes.emplace_back(VoteType::MINUS_BCOIN, it->GetCandidateUid(), it->GetVotedBcoins());
         }
 
-        regId2CandidateVotes.emplace(regId, candidateVotes);
-    }
-
-    vector<CReceipt> receipts;
-    // compute vote staking interest
-    for (const auto &item : regId2CandidateVotes) {
-        const auto &regId          = item.first;
-        const auto &candidateVotes = item.second;
-
+        // compute vote staking interest
         vector<CCandidateReceivedVote> candidateVotesInOut;
         cw.delegateCache.GetCandidateVotes(regId, candidateVotesInOut);
         CAccount account;
@@ -948,27 +974,36 @@ static bool ComputeVoteStakingInterestAndRevokeVotes(const uint256& blockHash, c
                 return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : read KeyId(%s) account info error",
                                 delegateUId.ToString()), UPDATE_ACCOUNT_FAIL, "bad-read-accountdb");
             }
-            uint64_t oldVotes = delegate.received_votes;
-            if (!delegate.StakeVoteBcoins(VoteType(vote.GetCandidateVoteType()), vote.GetVotedBcoins())) {
-                return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : operate delegate address %s vote fund error",
-                                delegateUId.ToString()), UPDATE_ACCOUNT_FAIL, "operate-vote-error");
-            }
+            delegateRevokedVotes[delegate.keyid] += vote.GetVotedBcoins();
+        }
+    }
 
-            // Votes: set the new value and erase the old value when different
-            if (delegate.received_votes != oldVotes) {
-                if (!cw.delegateCache.SetDelegateVotes(delegate.regid, delegate.received_votes))
-                    return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : save account id %s vote info error",
-                                    delegate.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-delegatedb");
+    for (const auto &item : delegateRevokedVotes) {
+        CAccount delegate;
+        if (!cw.accountCache.GetAccount(item.first, delegate)) {
+            return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : read KeyId(%s) account info error",
+                            item.first.ToString()), UPDATE_ACCOUNT_FAIL, "bad-read-accountdb");
+        }
+        uint64_t oldVotes = delegate.received_votes;
+        if (!delegate.StakeVoteBcoins(VoteType::MINUS_BCOIN, item.second)) {
+            return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : operate delegate address %s vote fund error",
+                            item.first.ToString()), UPDATE_ACCOUNT_FAIL, "operate-vote-error");
+        }
 
-                if (!cw.delegateCache.EraseDelegateVotes(delegate.regid, oldVotes))
-                    return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : erase account id %s vote info error",
-                                    delegate.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-delegatedb");
-            }
+        // Votes: set the new value and erase the old value when different
+        if (delegate.received_votes != oldVotes) {
+            if (!cw.delegateCache.SetDelegateVotes(delegate.regid, delegate.received_votes))
+                return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : save account id %s vote info error",
+                                delegate.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-delegatedb");
 
-            if (!cw.accountCache.SaveAccount(delegate))
-                return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : save account id %s info error",
-                                account.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-accountdb");
+            if (!cw.delegateCache.EraseDelegateVotes(delegate.regid, oldVotes))
+                return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : erase account id %s vote info error",
+                                delegate.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-delegatedb");
         }
+
+        if (!cw.accountCache.SaveAccount(delegate))
+            return state.DoS(100, ERRORMSG("ComputeVoteStakingInterestAndRevokeVotes() : save account id %s info error",
+                            delegate.regid.ToString()), UPDATE_ACCOUNT_FAIL, "bad-save-accountdb");
     }
 
     if (!cw.delegateCache.SetLastVoteHeight(currHeight)) {
@@ -987,7 +1022,7 @@ static bool ComputeVoteStakingInterestAndRevokeVotes(const uint256& blockHash, c
 bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck) {
     AssertLockHeld(cs_main);
 
-    auto bm = MAKE_BENCHMARK("ConnectBlock");
+    auto bm = MAKE_BENCHMARK_TOTAL("ConnectBlock", connectBlockStats.Collect(connectBlockStats.nConnectBlockTime));
     bool isGensisBlock = (block.GetHeight() == 0) && (block.GetHash() == SysCfg().GetGenesisBlockHash());
 
     // Check it again in case a previous version let a bad block in
@@ -1057,6 +1092,20 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
         uint32_t fuelRate     = block.GetFuelRate();
         uint64_t totalFuel    = 0;
 
+        // Verify the signatures of the block in one batch to fill the signature cache the txes are then
+        // checked against. The accounts are the ones before the block, a signer changing its key within
+        // the block only misses the cache.
+        if (GetFeatureForkVersion(pIndex->height) >= MAJOR_VER_R2) {
+            static CHistogram &histPreVerify = histogramRegistry.Get("chain.sig_preverify");
+            CHistogramTimer preVerifyTimer(histPreVerify);
+            vector<CSignatureCheck> sigChecks;
+            for (int32_t index = 1; index < (int32_t)block.vptx.size(); ++index)
+                block.vptx[index]->GetSignatureChecks(cw.accountCache, sigChecks);
+
+            vector<uint8_t> sigResults;
+            VerifySignatures(sigChecks, sigResults);
+        }
+
         for (int32_t index = 1; index < (int32_t)block.vptx.size(); ++index) {
             auto bmTx = MAKE_BENCHMARK("execute tx in ConnectBlock");
             std::shared_ptr<CBaseTx> &pBaseTx = block.vptx[index];
@@ -1073,7 +1122,18 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
 
             uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
             CTxExecuteContext context(pIndex->height, index, fuelRate, pIndex->nTime, prevBlockTime, bpRegid, &cw, &state);
-            if (!pBaseTx->CheckAndExecuteTx(context)) {
+            int64_t nSigCheckStart = nThreadSigCheckTime;
+            auto bmExecute = MAKE_BENCHMARK_TOTAL("CheckAndExecuteTx", connectBlockStats.Collect(connectBlockStats.nTxExecuteTime));
+            bool fExecuted = pBaseTx->CheckAndExecuteTx(context);
+            if (bmExecute && connectBlockStats.fEnabled) {
+                int64_t nTxTime = bmExecute->end();
+                connectBlockStats.nTxs++;
+                connectBlockStats.nTxSigCheckTime += nThreadSigCheckTime - nSigCheckStart;
+                auto &typeTime = connectBlockStats.mapTxTypeTime[pBaseTx->nTxType];
+                typeTime.first++;
+                typeTime.second += nTxTime;
+            }
+            if (!fExecuted) {
                 pCdMan->pLogCache->SetExecuteFail(pIndex->height, pBaseTx->GetHash(), state.GetRejectCode(), state.GetRejectReason());
                 return state.DoS(100, ERRORMSG("[%d] txid=%s check/execute failed, in detail: %s", pIndex->height,
                                  pBaseTx->GetHash().GetHex(), pBaseTx->ToString(cw.accountCache)), REJECT_INVALID, "tx-execute-failed");
@@ -1200,10 +1260,14 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
     if (fJustCheck)
         return true;
 
+    // the mempool executes again only the txes depending on what the block on top of the tip wrote
+    if (pIndex->pprev == chainActive.Tip())
+        mempool.AddBlockWrites(blockUndo);
+
     // Write undo information to disk
     if (pIndex->GetUndoPos().IsNull() || (pIndex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_SCRIPTS) {
+        CDiskBlockPos pos;
         if (pIndex->GetUndoPos().IsNull()) {
-            CDiskBlockPos pos;
             if (!FindUndoPos(state, pIndex->nFile, pos, ::GetSerializeSize(blockUndo, SER_DISK, CLIENT_VERSION) + 40))
                 return state.Abort(_("ConnectBlock() : failed to find undo data's position"));
 
@@ -1218,13 +1282,10 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
             //     preHash = uint256{};
             // }
 
-            if (!blockUndo.WriteToDisk(pos, pIndex->pprev->GetBlockHash()))
-                return state.Abort(_("ConnectBlock() : failed to write undo data"));
-
             //block.SetMerkleRootHash(blockUndo.CalcStateHash(preHash));
 
-            // Update nUndoPos in block index
-            pIndex->nUndoPos = pos.nPos;
+            // Update nUndoPos in block index, the undo data itself is written by undoWriter
+            pIndex->nUndoPos = CBlockUndoWriter::GetUndoDataPos(pos);
             pIndex->nStatus |= BLOCK_HAVE_UNDO;
         }
 
@@ -1232,8 +1293,12 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
 
         CRegID bpRegid = GetBlockBpRegid(block);
         CDiskBlockIndex blockIndex(pIndex, block, bpRegid);
-        if (!pCdMan->pBlockIndexDb->WriteBlockIndex(blockIndex))
+        if (!pos.IsNull()) {
+            // The block index is written once the undo data has been committed
+            undoWriter.Push(pos, pIndex->pprev->GetBlockHash(), std::move(blockUndo), blockIndex);
+        } else if (!pCdMan->pBlockIndexDb->WriteBlockIndex(blockIndex)) {
             return state.Abort(_("ConnectBlock() : failed to write block index"));
+        }
     }
 
     if (!cw.txCache.AddBlockTx(block)) {
@@ -1263,6 +1328,9 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
     // Set best block to current account cache.
     cw.blockCache.SetBestBlock(pIndex->GetBlockHash());
 
+    if (connectBlockStats.fEnabled)
+        connectBlockStats.nBlocks++;
+
     return true;
 }
 
@@ -1282,8 +1350,9 @@ bool static WriteChainState(CValidationState &state) {
         pCdMan->pLogCache->GetCacheSize() +
         pCdMan->pReceiptCache->GetCacheSize();
 
-    if (!IsInitialBlockDownload() || cacheSize > SysCfg().GetCacheSize() ||
-        GetTimeMicros() > nLastWrite + 60 * 1000000) {
+    // Not on every block, the commits of the block and undo files would stall ConnectTip(). A crash loses
+    // at most the blocks connected since the last write, they are downloaded again.
+    if (cacheSize > SysCfg().GetCacheSize() || GetTimeMicros() > nLastWrite + 60 * 1000000) {
         // Typical CCoins structures on disk are around 100 bytes in size.
         // Pushing a new one to the database can cause it to be written
         // twice (once in the log, and once in the tables). This is already
@@ -1292,10 +1361,7 @@ bool static WriteChainState(CValidationState &state) {
         if (!CheckDiskSpace(cacheSize))
             return state.Error("out of disk space");
 
-        FlushBlockFile();
-        // pCdMan->pBlockCache->Sync();
-        pCdMan->Flush();
-        mapForkCache.clear();
+        FlushChainState();
         nLastWrite = GetTimeMicros();
     }
     return true;
@@ -1339,6 +1405,8 @@ void static UpdateTip(CBlockIndex *pIndexNew, const CBlock &block) {
 // Disconnect chainActive's tip.
 bool DisconnectTip(CValidationState &state) {
     auto bmTx = MAKE_BENCHMARK("DisconnectTip");
+    static CHistogram &histDisconnectTip = histogramRegistry.Get("chain.disconnect_tip");
+    CHistogramTimer timer(histDisconnectTip);
     CBlockIndex *pBlockIndexToDelete = chainActive.Tip();
     assert(pBlockIndexToDelete);
     // check global fin block
@@ -1359,7 +1427,9 @@ bool DisconnectTip(CValidationState &state) {
         return ERRORMSG("DisconnectBlock %s failed", pBlockIndexToDelete->GetBlockHash().ToString());
 
     // Need to re-sync all to global cache layer.
+    int64_t nFlushStart = GetTimeMicros();
     spCW->Flush();
+    int64_t nFlushTime = GetTimeMicros() - nFlushStart;
 
     // Attention: need to reset the lastest block price median
     CBlockIndex *pPreBlockIndex = pBlockIndexToDelete->pprev;
@@ -1376,36 +1446,59 @@ bool DisconnectTip(CValidationState &state) {
     // Update chainActive and related variables.
     CBlockIndex *pNewTipIndex = pBlockIndexToDelete->pprev;
     UpdateTip(pNewTipIndex, block);
+    mempool.SetFullRescan();
     // Resurrect mempool transactions from the disconnected block.
+    int64_t nResurrectStart = GetTimeMicros();
     for (const auto &pTx : block.vptx) {
         list<std::shared_ptr<CBaseTx> > removed;
         CValidationState stateDummy;
         if (!pTx->IsRelayForbidden()) {
-            if (!AcceptToMemoryPool(mempool, stateDummy, pTx.get(), false)) {
+            // the block is dropped after this, so the pool can take its txes over
+            if (!AcceptToMemoryPool(mempool, stateDummy, pTx, false)) {
                 mempool.Remove(pTx.get(), removed, true);
             }
         } else {
             EraseTransactionFromWallet(pTx->GetHash());
         }
     }
+    int64_t nResurrectTime = GetTimeMicros() - nResurrectStart;
     pbftMan.AfterDisconnectTip(pNewTipIndex);
 
+    if (CReorgRecord *pReorg = reorgStats.Current()) {
+        pReorg->nDisconnected++;
+        pReorg->nDisconnectTime += timer.GetElapsed();
+        pReorg->nCacheFlushTime += nFlushTime;
+        pReorg->nResurrectTime += nResurrectTime;
+    }
+
     return true;
 }
 
 // Connect a new block to chainActive.
 bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
     auto bmTx = MAKE_BENCHMARK("ConnectTip");
+    static CHistogram &histConnectTip = histogramRegistry.Get("chain.connect_tip");
+    CHistogramTimer timer(histConnectTip);
     assert(pIndexNew->pprev == chainActive.Tip());
     // Read block from disk.
     CBlock block;
+    auto bmRead = MAKE_BENCHMARK_TOTAL("ReadBlockFromDisk", connectBlockStats.Collect(connectBlockStats.nReadBlockTime));
     if (!ReadBlockFromDisk(pIndexNew, block))
         return state.Abort(strprintf("Failed to read block hash: %s", pIndexNew->GetBlockHash().GetHex()));
+    if (bmRead)
+        bmRead->end();
 
     // Apply the block automatically to the chain state.
     CInv inv(MSG_BLOCK, pIndexNew->GetBlockHash());
 
-    auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
+    // The cache maps of the block are carved out of connectBlockArena and given back in one go when spCW is
+    // gone, so arenaReleaser must be declared before it.
+    CArenaReleaser arenaReleaser(connectBlockArena);
+    std::shared_ptr<CCacheWrapper> spCW;
+    {
+        CArenaScope arenaScope(connectBlockArena);
+        spCW = std::make_shared<CCacheWrapper>(pCdMan);
+    }
     if (!ConnectBlock(block, *spCW, pIndexNew, state)) {
         if (state.IsInvalid()) {
             InvalidBlockFound(pIndexNew, block, state);
@@ -1419,18 +1512,28 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
     }
 
     // Need to re-sync all to global cache layer.
+    int64_t nFlushStart = GetTimeMicros();
     spCW->Flush();
-
+    int64_t nFlushTime = GetTimeMicros() - nFlushStart;
+    if (connectBlockStats.fEnabled)
+        connectBlockStats.nCacheFlushTime += nFlushTime;
 
     // Write the chain state to disk, if necessary.
-    if (!WriteChainState(state))
-        return false;
+    {
+        auto bmChainState = MAKE_BENCHMARK_TOTAL("WriteChainState", connectBlockStats.Collect(connectBlockStats.nChainStateTime));
+        if (!WriteChainState(state))
+            return false;
+    }
 
     // Update chainActive & related variables.
     UpdateTip(pIndexNew, block);
 
-    for (auto &pTxItem : block.vptx) {
-        mempool.memPoolTxs.erase(pTxItem->GetHash());
+    mempool.RemoveConfirmed(block);
+
+    if (CReorgRecord *pReorg = reorgStats.Current()) {
+        pReorg->nConnected++;
+        pReorg->nConnectTime += timer.GetElapsed();
+        pReorg->nCacheFlushTime += nFlushTime;
     }
     return true;
 }
@@ -1458,6 +1561,8 @@ inline void SetForkInvalidByRoot(CBlockIndex *root, CBlockIndex *last) {
 // Make chainMostWork correspond to the chain with the most work in it, that isn't
 // known to be invalid (it's however far from certain to be valid).
 bool static FindMostWorkChain(CValidationState &state) {
+    static CHistogram &histFindMostWork = histogramRegistry.Get("chain.find_most_work");
+    CHistogramTimer timer(histFindMostWork);
     CBlockIndex *pIndexNew = nullptr;
 
     // In case the current best is invalid, do not consider it.
@@ -1535,6 +1640,13 @@ bool static FindMostWorkChain(CValidationState &state) {
 // Try to activate to the most-work chain (thereby connecting it).
 bool ActivateBestChain(CValidationState &state, CBlockIndex* pNewIndex) {
     LOCK(cs_main);
+    static CHistogram &histActivate = histogramRegistry.Get("chain.activate_best_chain");
+    CHistogramTimer timer(histActivate);
+    // closes the record of the reorg started below, if any, whichever way we leave
+    struct CReorgEnd {
+        ~CReorgEnd() { reorgStats.End(chainActive.Tip()); }
+    } reorgEnd;
+
     CBlockIndex *pIndexOldTip = chainActive.Tip();
     bool fComplete            = false;
 
@@ -1550,6 +1662,9 @@ bool ActivateBestChain(CValidationState &state, CBlockIndex* pNewIndex) {
             break;
 
         // Disconnect active blocks which are no longer in the best chain.
+        if (chainActive.Tip() && !chainMostWork.Contains(chainActive.Tip()))
+            reorgStats.Begin(chainActive.Tip(), pbftMan.GetGlobalFinIndex());
+
         while (chainActive.Tip() && !chainMostWork.Contains(chainActive.Tip())) {
             if (!DisconnectTip(state))
                 return false;
@@ -1598,18 +1713,14 @@ bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos
     if (mapBlockIndex.count(hash))
         return state.Invalid(ERRORMSG("AddToBlockIndex() : %s already exists", block.GetIdStr()), 0, "duplicate");
 
-    // Construct new block index object
-    CBlockIndex *pIndexNew = new CBlockIndex(block);
-
-    assert(pIndexNew);
+    // Construct new block index object in the block index pool
+    CBlockIndex *pIndexNew = mapBlockIndex.emplace(hash, block).first->second;
     {
         LOCK(cs_nBlockSequenceId);
         pIndexNew->nSequenceId = nBlockSequenceId++;
     }
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
     // LogPrint(BCLog::INFO, "in map hash:%s map size:%d\n", hash.GetHex(), mapBlockIndex.size());
-    pIndexNew->pBlockHash                        = &((*mi).first);
-    map<uint256, CBlockIndex *>::iterator miPrev = mapBlockIndex.find(block.GetPrevBlockHash());
+    CBlockIndexMap::iterator miPrev = mapBlockIndex.find(block.GetPrevBlockHash());
     if (miPrev != mapBlockIndex.end()) {
         pIndexNew->pprev  = (*miPrev).second;
         pIndexNew->height = pIndexNew->pprev->height + 1;
@@ -1705,6 +1816,9 @@ bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, uint32_t nAddSize
 }
 
 bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValidationState &state) {
+    static CHistogram &histForkedChain = histogramRegistry.Get("chain.process_forked_chain");
+    static CHistogram &histRollback    = histogramRegistry.Get("chain.fork_cache_rollback");
+    CHistogramTimer timer(histForkedChain);
     bool forkChainTipFound = false;
     uint256 forkChainTipBlockHash;
     vector<CBlock> vPreBlocks;
@@ -1773,6 +1887,7 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
             pBlockIndex = pBlockIndex->pprev;
         }  // Rollback the active chain to the forked point.
 
+        histRollback.Add(chainActive.Height() - pPreBlockIndex->height);
         mapForkCache[pPreBlockIndex->GetBlockHash()] = spCW;
         forkChainTipBlockHash = pPreBlockIndex->GetBlockHash();
         forkChainTipFound     = true;
@@ -1905,7 +2020,7 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
     CBlockIndex *pPrevBlockIndex = nullptr;
     int32_t height = 0;
     if (block.GetHeight() != 0 || blockHash != SysCfg().GetGenesisBlockHash()) {
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(block.GetPrevBlockHash());
+        CBlockIndexMap::iterator mi = mapBlockIndex.find(block.GetPrevBlockHash());
         if (mi == mapBlockIndex.end())
             return state.DoS(10, ERRORMSG("[%d] prev block not found", blockHeight), 0, "bad-prevblk");
 
@@ -1942,16 +2057,24 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
 
     // Write block to history file
     try {
-        uint32_t nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
         CDiskBlockPos blockPos;
-        if (dbp != nullptr)
-            blockPos = *dbp;
+        if (dbp != nullptr) {
+            // The block may be stored compressed, take its size from the file
+            uint32_t nDiskSize = 0;
+            if (!ReadBlockDiskSize(*dbp, nDiskSize))
+                return state.Abort(_("Failed to read block size"));
 
-        if (!FindBlockPos(state, blockPos, nBlockSize + 8, height, block.GetTime(), dbp != nullptr))
-            return ERRORMSG("FindBlockPos failed");
+            blockPos = *dbp;
+            if (!FindBlockPos(state, blockPos, nDiskSize, height, block.GetTime(), true))
+                return ERRORMSG("FindBlockPos failed");
+        } else {
+            CBlockFileRecord record(block);
+            if (!FindBlockPos(state, blockPos, record.GetDiskSize(), height, block.GetTime()))
+                return ERRORMSG("FindBlockPos failed");
 
-        if (dbp == nullptr && !WriteBlockToDisk(block, blockPos))
-            return state.Abort(_("Failed to write block"));
+            if (!WriteBlockToDisk(record, blockPos))
+                return state.Abort(_("Failed to write block"));
+        }
 
         if (!AddToBlockIndex(block, state, blockPos))
             return ERRORMSG("AddToBlockIndex failed");
@@ -1966,10 +2089,18 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
     if (pTip->GetBlockHash() == blockHash) {
         {
             LOCK(cs_vNodes);
+            std::unique_ptr<CCompressedBlock> pCompressed;
+            std::unique_ptr<CBlockHeaderAndShortTxIDs> pCmpctBlock;
+            bool fInitialDownload = IsInitialBlockDownload();
             for (auto pNode : vNodes) {
+                // Peers rebuild the block from their mempool, which saves a round trip for most of it
+                if (pNode->fPreferCompactBlocks && (mining || !fInitialDownload)) {
+                    PushCompactBlock(pNode, block, pCmpctBlock);
+                    continue;
+                }
                 //p2p_xiaoyu_20191116
                 if (mining) {
-                    pNode->PushMessage(NetMsgType::BLOCK, block);
+                    PushBlockMessage(pNode, block, pCompressed);
                     continue;
                 }
                 if (chainActive.Height() > (pNode->nStartingHeight != -1 ? pNode->nStartingHeight - 2000 : 0))
@@ -2098,7 +2229,26 @@ void PushGetBlocksOnCondition(CNode *pNode, CBlockIndex *pIndexBegin, uint256 ha
     }
 }
 
-bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBlockPos *dbp) {
+// Retry the orphan txes whose regid the active chain has reached, they are dropped if they still fail
+static void RetryOrphanTxs() {
+    AssertLockHeld(cs_main);
+    if (orphanTxs.Size() == 0)
+        return;
+
+    vector<std::shared_ptr<CBaseTx>> txs;
+    orphanTxs.TakeReady(chainActive.Height(), txs);
+    for (auto &spTx : txs) {
+        CValidationState state;
+        if (AcceptToMemoryPool(mempool, state, spTx, true)) {
+            RelayTransaction(spTx.get(), spTx->GetHash());
+            LogPrint(BCLog::NET, "accepted orphan tx %s (poolsz %u)\n", spTx->GetHash().GetHex(), mempool.memPoolTxs.size());
+        } else {
+            LogPrint(BCLog::NET, "drop orphan tx %s: %s\n", spTx->GetHash().GetHex(), state.GetRejectReason());
+        }
+    }
+}
+
+bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBlockPos *dbp, bool fCheckedBlock) {
     int64_t llBeginTime = GetTimeMillis();
     // LogPrint(BCLog::INFO, "ProcessBlock() enter:%lld\n", llBeginTime);
     AssertLockHeld(cs_main);
@@ -2108,14 +2258,14 @@ bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBl
     if (mapBlockIndex.count(blockHash))
         return state.Invalid(ERRORMSG("[%u] block(%s) exists", blockHeight, blockHash.ToString()), 0, "duplicate");
 
-    if (mapOrphanBlocks.count(blockHash))
+    if (orphanBlocks.Exists(blockHash))
         return state.Invalid(ERRORMSG("[%u] (orphan) block(%s) exists", blockHeight, blockHash.ToString()), 0, "duplicate");
 
     int64_t llBeginCheckBlockTime = GetTimeMillis();
     auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
 
-    // Preliminary checks
-    if (!CheckBlock(*pBlock, state, *spCW, false)) {
+    // Preliminary checks, skipped when the caller has run them already
+    if (!fCheckedBlock && !CheckBlock(*pBlock, state, *spCW, false)) {
         LogPrint(BCLog::INFO, "[%d] CheckBlock elapse time: %lld ms\n", chainActive.Height(),
                  GetTimeMillis() - llBeginCheckBlockTime);
 
@@ -2131,28 +2281,20 @@ bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBl
 
         // Accept orphans as long as there is a node to request its parents from
         if (pFrom) {
-            bool success = PruneOrphanBlocks(pBlock->GetHeight());
-            if (success) {
-                COrphanBlock *pblock2 = new COrphanBlock();
-                CDataStream ss(SER_DISK, CLIENT_VERSION);
-                ss << *pBlock;
-                pblock2->vchBlock      = vector<uint8_t>(ss.begin(), ss.end());
-                pblock2->blockHash     = blockHash;
-                pblock2->prevBlockHash = pBlock->GetPrevBlockHash();
-                pblock2->height        = pBlock->GetHeight();
-                mapOrphanBlocks.insert(make_pair(blockHash, pblock2));
-                mapOrphanBlocksByPrev.insert(make_pair(pblock2->prevBlockHash, pblock2));
-                setOrphanBlock.insert(pblock2);
-            }
+            bool success = orphanBlocks.Add(*pBlock, blockHash);
+
+            // Blocks of the header chain arrive out of order, their parents are already scheduled for download
+            if (IsBlockInHeaderChain(blockHeight, blockHash))
+                return true;
 
             // Ask this guy to fill in what we're missing
             LogPrint(BCLog::NET,
                      "receive an orphan block height=%d hash=%s, %s it, leading to getblocks (current block height=%d, "
                      "current block hash=%s, orphan blocks=%d)\n",
                      pBlock->GetHeight(), pBlock->GetHash().GetHex(), success ? "keep" : "abandon",
-                     chainActive.Height(), chainActive.Tip()->GetBlockHash().GetHex(), mapOrphanBlocksByPrev.size());
+                     chainActive.Height(), chainActive.Tip()->GetBlockHash().GetHex(), orphanBlocks.Size());
 
-            PushGetBlocksOnCondition(pFrom, chainActive.Tip(), GetOrphanRoot(blockHash));
+            PushGetBlocksOnCondition(pFrom, chainActive.Tip(), orphanBlocks.GetRoot(blockHash));
         }
         return true;
     }
@@ -2171,14 +2313,9 @@ bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBl
     vector<uint256> vWorkQueue;
     vWorkQueue.push_back(blockHash);
     for (uint32_t i = 0; i < vWorkQueue.size(); i++) {
-        uint256 prevBlockHash = vWorkQueue[i];
-        for (multimap<uint256, COrphanBlock *>::iterator mi = mapOrphanBlocksByPrev.lower_bound(prevBlockHash);
-             mi != mapOrphanBlocksByPrev.upper_bound(prevBlockHash); ++mi) {
-            CBlock block;
-            {
-                CDataStream ss(mi->second->vchBlock, SER_DISK, CLIENT_VERSION);
-                ss >> block;
-            }
+        vector<CBlock> children;
+        orphanBlocks.TakeChildren(vWorkQueue[i], children);
+        for (auto &block : children) {
             block.BuildMerkleTree();
             /**
              * Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan resolution
@@ -2186,15 +2323,13 @@ bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBl
              */
             CValidationState stateDummy;
             if (AcceptBlock(block, stateDummy)) {
-                vWorkQueue.push_back(mi->second->blockHash);
+                vWorkQueue.push_back(block.GetHash());
             }
-            setOrphanBlock.erase(mi->second);
-            mapOrphanBlocks.erase(mi->second->blockHash);
-            delete mi->second;
         }
-        mapOrphanBlocksByPrev.erase(prevBlockHash);
     }
 
+    RetryOrphanTxs();
+
     LogPrint(BCLog::DEBUG, "[%d] elapse time:%lld ms\n", pBlock->GetHeight(), GetTimeMillis() - llBeginTime);
     return true;
 }
@@ -2416,13 +2551,13 @@ bool InitBlockIndex() {
         try {
             CBlock &block = const_cast<CBlock &>(SysCfg().GenesisBlock());
             // Start new block file
-            uint32_t nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+            CBlockFileRecord record(block);
             CDiskBlockPos blockPos;
             CValidationState state;
-            if (!FindBlockPos(state, blockPos, nBlockSize + 8, 0, block.GetTime()))
+            if (!FindBlockPos(state, blockPos, record.GetDiskSize(), 0, block.GetTime()))
                 return ERRORMSG("FindBlockPos failed");
 
-            if (!WriteBlockToDisk(block, blockPos))
+            if (!WriteBlockToDisk(record, blockPos))
                 return ERRORMSG("writing genesis block to disk failed");
 
             if (!AddToBlockIndex(block, state, blockPos))
@@ -2440,7 +2575,7 @@ void PrintBlockTree() {
     AssertLockHeld(cs_main);
     // pre-compute tree structure
     map<CBlockIndex *, vector<CBlockIndex *> > mapNext;
-    for (map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
+    for (CBlockIndexMap::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
         CBlockIndex *pIndex = (*mi).second;
         mapNext[pIndex->pprev].push_back(pIndex);
     }
@@ -2494,11 +2629,61 @@ void PrintBlockTree() {
     }
 }
 
-bool LoadExternalBlockFile(FILE *fileIn, CDiskBlockPos *dbp) {
-    int64_t nStart = GetTimeMillis();
-    int32_t nLoaded    = 0;
+/**
+ * Pipeline behind LoadExternalBlockFile(): a reader thread scans the file for serialized blocks, a pool of workers
+ * deserializes them and runs the context-free CheckBlock(), and the calling thread connects them in file order.
+ */
+class CBlockImporter {
+public:
+    CBlockImporter(FILE *fileIn, CDiskBlockPos *dbpIn, int32_t nWorkersIn)
+        : file(fileIn), dbp(dbpIn), nWorkers(max(nWorkersIn, 1)) {}
+
+    // Returns the number of blocks loaded.
+    int32_t Run();
+
+private:
+    struct CImportItem {
+        uint64_t nBlockPos = 0;
+        uint32_t nSize     = 0;
+        bool fCompressed   = false;
+        vector<char> vchBlock;
+        std::shared_ptr<CBlock> pBlock;
+        bool fChecked = false;  // worker finished with the block
+        bool fValid   = false;  // block passed CheckBlock()
+    };
+
+    void ReadBlocks();
+    void CheckBlocks();
+    void LogStats(bool fFinal);
+
+    FILE *file;
+    CDiskBlockPos *dbp;
+    int32_t nWorkers;
+
+    boost::mutex cs;
+    boost::condition_variable cond;
+    map<uint64_t, CImportItem> mapItems;  // read but not yet connected blocks, by sequence in the file
+    uint64_t nNextRead    = 0;
+    uint64_t nNextCheck   = 0;
+    uint64_t nNextConnect = 0;
+    uint64_t nQueuedBytes = 0;
+    bool fReadDone        = false;
+    bool fAbort           = false;
+    string strError;
+
+    // Per-stage statistics, busy time in microseconds
+    uint64_t nReadBytes    = 0;
+    int64_t nReadTime      = 0;
+    int64_t nCheckTime     = 0;
+    int64_t nConnectTime   = 0;
+    int32_t nConnected     = 0;
+    int32_t nLoaded        = 0;
+};
+
+void CBlockImporter::ReadBlocks() {
     try {
-        CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE, MAX_BLOCK_SIZE + 8, SER_DISK, CLIENT_VERSION);
+        int64_t nBeginTime = GetTimeMicros();
+        CBufferedFile blkdat(file, 4 * MAX_BLOCK_SIZE, MAX_BLOCK_SIZE + 8, SER_DISK, CLIENT_VERSION);
         uint64_t nStartByte = 0;
         if (dbp) {
             // (try to) skip already indexed part
@@ -2515,7 +2700,8 @@ bool LoadExternalBlockFile(FILE *fileIn, CDiskBlockPos *dbp) {
             blkdat.SetPos(nRewind);
             nRewind++;          // start one byte further next time, in case of failure
             blkdat.SetLimit();  // remove former limit
-            uint32_t nSize = 0;
+            uint32_t nSize   = 0;
+            bool fCompressed = false;
             try {
                 // locate a header
                 uint8_t buf[MESSAGE_START_SIZE];
@@ -2526,39 +2712,207 @@ bool LoadExternalBlockFile(FILE *fileIn, CDiskBlockPos *dbp) {
                     continue;
                 // read size
                 blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
+                fCompressed = nSize & BLOCK_FILE_COMPRESSED;
+                nSize &= ~BLOCK_FILE_COMPRESSED;
+                if (nSize < (fCompressed ? 8 : 80) || nSize > MAX_BLOCK_SIZE)
                     continue;
             } catch (std::exception &e) {
                 // no valid block header found; don't complain
                 break;
             }
             try {
-                // read block
+                // read the serialized block, deserialization is left to the workers
                 uint64_t nBlockPos = blkdat.GetPos();
                 blkdat.SetLimit(nBlockPos + nSize);
-                CBlock block;
-                blkdat >> block;
+                CImportItem item;
+                item.nBlockPos = nBlockPos;
+                item.nSize       = nSize;
+                item.fCompressed = fCompressed;
+                item.vchBlock.resize(nSize);
+                blkdat.read(&item.vchBlock[0], nSize);
                 nRewind = blkdat.GetPos();
 
-                // process block
                 if (nBlockPos >= nStartByte) {
-                    LOCK(cs_main);
-                    if (dbp)
-                        dbp->nPos = nBlockPos;
-                    CValidationState state;
-                    if (ProcessBlock(state, nullptr, &block, dbp))
-                        nLoaded++;
-                    if (state.IsError())
+                    int64_t nWaitBegin = GetTimeMicros();
+                    boost::unique_lock<boost::mutex> lock(cs);
+                    while (!fAbort && (nNextRead - nNextConnect >= MAX_IMPORT_BLOCKS_QUEUE ||
+                                       nQueuedBytes >= MAX_IMPORT_QUEUE_BYTES))
+                        cond.wait(lock);
+
+                    if (fAbort)
                         break;
+
+                    nBeginTime += GetTimeMicros() - nWaitBegin;
+                    nQueuedBytes += nSize;
+                    nReadBytes += nSize;
+                    nReadTime = GetTimeMicros() - nBeginTime;
+                    mapItems[nNextRead++] = std::move(item);
+                    cond.notify_all();
                 }
             } catch (std::exception &e) {
                 LogPrint(BCLog::ERROR, "Deserialize or I/O error - %s\n", e.what());
             }
         }
-        fclose(fileIn);
     } catch (runtime_error &e) {
-        AbortNode(_("Error: system error: ") + e.what());
+        boost::unique_lock<boost::mutex> lock(cs);
+        strError = e.what();
     }
+
+    boost::unique_lock<boost::mutex> lock(cs);
+    fReadDone = true;
+    cond.notify_all();
+}
+
+void CBlockImporter::CheckBlocks() {
+    CCacheWrapper cw(pCdMan);
+    while (true) {
+        CImportItem *pItem = nullptr;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            while (!fAbort && !fReadDone && nNextCheck == nNextRead)
+                cond.wait(lock);
+
+            if (fAbort || nNextCheck == nNextRead)
+                return;
+
+            // items are only erased by the connect stage once they are checked
+            pItem = &mapItems[nNextCheck++];
+        }
+
+        int64_t nBeginTime = GetTimeMicros();
+        try {
+            CDataStream ss(pItem->vchBlock, SER_DISK, CLIENT_VERSION);
+            auto pBlock = std::make_shared<CBlock>();
+            if (pItem->fCompressed) {
+                CCompressedBlock compressed;
+                ss >> compressed;
+                if (!compressed.Decompress(*pBlock, SER_DISK, CLIENT_VERSION))
+                    throw runtime_error("decompress block failed");
+            } else {
+                ss >> *pBlock;
+            }
+            vector<char>().swap(pItem->vchBlock);
+
+            CValidationState state;
+            pItem->fValid = CheckBlock(*pBlock, state, cw, false);
+            pItem->pBlock = pBlock;
+        } catch (std::exception &e) {
+            LogPrint(BCLog::ERROR, "Deserialize or I/O error - %s\n", e.what());
+        }
+
+        boost::unique_lock<boost::mutex> lock(cs);
+        pItem->fChecked = true;
+        nCheckTime += GetTimeMicros() - nBeginTime;
+        cond.notify_all();
+    }
+}
+
+void CBlockImporter::LogStats(bool fFinal) {
+    boost::unique_lock<boost::mutex> lock(cs);
+    LogPrint(fFinal ? BCLog::INFO : BCLog::REINDEX,
+             "import stats: read %llu blocks %.2f MB in %.2fs (%.2f MB/s), check %llu blocks in %.2fs cpu on %d "
+             "workers (%.1f blocks/s), connect %d blocks in %.2fs (%.1f blocks/s), queued %llu blocks %.2f MB\n",
+             nNextRead, nReadBytes / 1048576.0, nReadTime * 0.000001,
+             nReadTime ? nReadBytes / 1.048576 / nReadTime : 0.0, nNextCheck, nCheckTime * 0.000001, nWorkers,
+             nCheckTime ? nNextCheck * 1000000.0 * nWorkers / nCheckTime : 0.0, nConnected, nConnectTime * 0.000001,
+             nConnectTime ? nConnected * 1000000.0 / nConnectTime : 0.0, nNextRead - nNextConnect,
+             nQueuedBytes / 1048576.0);
+}
+
+int32_t CBlockImporter::Run() {
+    boost::thread_group stageThreads;
+    stageThreads.create_thread(boost::bind(&CBlockImporter::ReadBlocks, this));
+    for (int32_t i = 0; i < nWorkers; i++)
+        stageThreads.create_thread(boost::bind(&CBlockImporter::CheckBlocks, this));
+
+    try {
+        while (true) {
+            CImportItem item;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                auto it = mapItems.find(nNextConnect);
+                while (!fAbort && !(it != mapItems.end() && it->second.fChecked) &&
+                       !(fReadDone && nNextConnect == nNextRead)) {
+                    cond.wait(lock);
+                    it = mapItems.find(nNextConnect);
+                }
+
+                if (fAbort || it == mapItems.end())
+                    break;
+
+                item = std::move(it->second);
+                mapItems.erase(it);
+                nNextConnect++;
+                nQueuedBytes -= item.nSize;
+                cond.notify_all();
+            }
+
+            if (!item.pBlock)
+                continue;
+
+            if (!item.fValid) {
+                LogPrint(BCLog::ERROR, "[%d] CheckBlock FAILED: block#%s\n", item.pBlock->GetHeight(),
+                         item.pBlock->GetHash().GetHex());
+                continue;
+            }
+
+            int64_t nBeginTime = GetTimeMicros();
+            bool fError        = false;
+            {
+                LOCK(cs_main);
+                if (dbp)
+                    dbp->nPos = item.nBlockPos;
+                CValidationState state;
+                if (ProcessBlock(state, nullptr, item.pBlock.get(), dbp, true))
+                    nLoaded++;
+                fError = state.IsError();
+            }
+
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                nConnectTime += GetTimeMicros() - nBeginTime;
+                nConnected++;
+            }
+
+            if (fError)
+                break;
+
+            if (nConnected % IMPORT_LOG_INTERVAL == 0)
+                LogStats(false);
+        }
+    } catch (...) {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            fAbort = true;
+            cond.notify_all();
+        }
+        stageThreads.interrupt_all();
+        stageThreads.join_all();
+        throw;
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        fAbort = true;
+        cond.notify_all();
+    }
+    stageThreads.join_all();
+    LogStats(true);
+
+    if (!strError.empty())
+        AbortNode(_("Error: system error: ") + strError);
+
+    return nLoaded;
+}
+
+bool LoadExternalBlockFile(FILE *fileIn, CDiskBlockPos *dbp) {
+    int64_t nStart = GetTimeMillis();
+    int32_t nWorkers = SysCfg().GetArg("-importthreads", max((int32_t)boost::thread::hardware_concurrency() - 1, 1));
+
+    CBlockImporter importer(fileIn, dbp, nWorkers);
+    int32_t nLoaded = importer.Run();
+    fclose(fileIn);
+
     if (nLoaded > 0)
         LogPrint(BCLog::INFO, "Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
 
@@ -2621,18 +2975,10 @@ class CMainCleanup {
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        map<uint256, CBlockIndex *>::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
         mapBlockIndex.clear();
 
         // orphan blocks
-        map<uint256, COrphanBlock *>::iterator it2 = mapOrphanBlocks.begin();
-        for (; it2 != mapOrphanBlocks.end(); it2++)
-            delete (*it2).second;
-        mapOrphanBlocks.clear();
-        mapOrphanBlocksByPrev.clear();
-        setOrphanBlock.clear();
+        orphanBlocks.Clear();
     }
 } instance_of_cmaincleanup;
 
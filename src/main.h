@@ -12,6 +12,7 @@
 
 #include <stdint.h>
 #include <algorithm>
+#include <atomic>
 #include <exception>
 #include <map>
 #include <set>
@@ -19,16 +20,19 @@
 #include <utility>
 #include <vector>
 
+#include "commons/arena.h"
 #include "commons/arith_uint256.h"
 #include "commons/types.h"
 #include "commons/uint256.h"
 #include "config/chainparams.h"
 #include "config/const.h"
 #include "config/errorcode.h"
+#include "chain/blockindexmap.h"
 #include "chain/chain.h"
 #include "chain/merkletree.h"
 #include "persistence/cachewrapper.h"
 #include "sigcache.h"
+#include "sigcheckqueue.h"
 #include "tx/tx.h"
 #include "tx/txmempool.h"
 //#include "tx/txserializer.h"
@@ -43,7 +47,7 @@ extern CChainActive chainActive;
 extern CSignatureCache signatureCache;
 
 extern CTxMemPool mempool;
-extern map<uint256, CBlockIndex *> mapBlockIndex;
+extern CBlockIndexMap mapBlockIndex;
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
 extern const string strMessageMagic;
@@ -99,14 +103,52 @@ void Misbehaving(NodeId nodeid, int32_t howmuch);
 
 bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey);
 
+/**
+ * The checks of AcceptToMemoryPool that do not depend on the chain state: format, size and signatures,
+ * against the signer pubkeys as of the call. Does not require cs_main, so relayed and submitted txes
+ * can be checked concurrently before AcceptToMemoryPool, whose signature checks then hit the cache.
+ */
+bool PreCheckTxForMemPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx);
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
                         bool fLimitFree, bool fRejectInsaneFee = false);
+/** Same as above, but the pool takes spBaseTx over instead of cloning it. The caller must not change it afterwards. */
+bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, const std::shared_ptr<CBaseTx> &spBaseTx,
+                        bool fLimitFree, bool fRejectInsaneFee = false);
 
 struct CNodeStateStats {
     int32_t nMisbehavior;
 };
 
+/** Time spent connecting blocks, split by stage. Only collected while fEnabled is set
+ *  (by bench_connectblock), through the MAKE_BENCHMARK_TOTAL hooks; all times are in microseconds. */
+struct CConnectBlockStats {
+    std::atomic<bool> fEnabled;
+    std::atomic<uint64_t> nSigChecks;           // signature verifications that missed the cache
+    std::atomic<int64_t> nSigCheckTime;         // in VerifySignature, all threads
+
+    // Updated by the thread holding cs_main
+    uint64_t nBlocks;
+    uint64_t nTxs;
+    std::atomic<int64_t> nReadBlockTime;        // ReadBlockFromDisk in ConnectTip
+    std::atomic<int64_t> nConnectBlockTime;     // whole ConnectBlock
+    std::atomic<int64_t> nTxExecuteTime;        // CheckAndExecuteTx, including VM execution
+    int64_t nTxSigCheckTime;                    // signature checks made from CheckAndExecuteTx
+    int64_t nCacheFlushTime;                    // CCacheWrapper::Flush into the global caches
+    std::atomic<int64_t> nChainStateTime;       // WriteChainState, flushing the global caches to db
+    map<uint8_t, pair<uint64_t, int64_t>> mapTxTypeTime;  // nTxType -> (count, time)
+
+    CConnectBlockStats() : fEnabled(false) { SetNull(); }
+
+    void SetNull();
+    /** The total to pass to MAKE_BENCHMARK_TOTAL, null while the stats are not collected. */
+    std::atomic<int64_t> *Collect(std::atomic<int64_t> &total) { return fEnabled ? &total : nullptr; }
+};
+
+extern CConnectBlockStats connectBlockStats;
+/** Arena of the caches of the block being connected, guarded by cs_main */
+extern CArena connectBlockArena;
+
 /** Check for standard transaction types
     @return True if all outputs (scriptPubKeys) use only standard transaction forms
 */
@@ -212,6 +254,9 @@ protected:
 bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool *pfClean = nullptr);
 // Apply the effects of this block (with given index) on the UTXO set represented by coins
 bool ConnectBlock   (CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck = false);
+// Pay the vote staking interest of all the voters and revoke their votes but the biggest one, at the R2 fork
+bool ComputeVoteStakingInterestAndRevokeVotes(const uint256 &blockHash, const int32_t currHeight, const uint32_t currBlockTime,
+                                              CCacheWrapper &cw, CValidationState &state);
 
 // Add this block to the block index, and if necessary, switch the active block chain to this
 bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos &pos);
@@ -229,6 +274,9 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp = nu
 //disconnect block for test
 bool DisconnectTip(CValidationState &state);
 
+/** Commit the block and undo files, then flush the chain state. Requires cs_main */
+void FlushChainState();
+
 /** Mark a block as invalid. */
 bool InvalidateBlock(CValidationState &state, CBlockIndex *pIndex);
 
@@ -245,7 +293,8 @@ void PushGetBlocks(CNode *pNode, CBlockIndex *pindexBegin, uint256 hashEnd);
 /** Push getblocks request with different filtering strategies */
 void PushGetBlocksOnCondition(CNode *pNode, CBlockIndex *pindexBegin, uint256 hashEnd);
 /** Process an incoming block */
-bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBlockPos *dbp = nullptr);
+bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBlockPos *dbp = nullptr,
+                  bool fCheckedBlock = false);
 /** Print the loaded block tree */
 void PrintBlockTree();
 
@@ -18,8 +18,10 @@
 #include "persistence/contractdb.h"
 #include "persistence/cachewrapper.h"
 #include "p2p/protocol.h"
+#include "commons/histogram.h"
 
 #include <algorithm>
+#include <functional>
 #include <boost/circular_buffer.hpp>
 
 extern CWallet *pWalletMain;
@@ -33,6 +35,9 @@ MinedBlockInfo miningBlockInfo;
 boost::circular_buffer<MinedBlockInfo> minedBlocks(MAX_MINED_BLOCK_COUNT);
 CCriticalSection csMinedBlocks;
 bool g_isMiningTimeLimit = true;
+// arena of the caches used by ProduceBlock() to pack a block, only used with cs_main held. The block template
+// builder thread does not pack in it, its caches outlive a single block.
+static CArena produceBlockArena;
 
 // check the time is not exceed the limit time (2s) for packing new block
 static bool CheckPackBlockTime(int64_t startMiningMs, int32_t blockHeight) {
@@ -85,27 +90,25 @@ uint32_t GetElementForBurn(CBlockIndex *pIndex) {
     return newFuelRate;
 }
 
-// Sort transactions by priority and fee to decide priority orders to process transactions.
-void GetPriorityTx(CCacheWrapper &cw, int32_t height, set<TxPriority> &txPriorities, const int32_t nFuelRate) {
-    static TokenSymbol feeSymbol;
-    static uint64_t fee    = 0;
-    static uint32_t txSize = 0;
-    static double feePerKb = 0;
-    static double priority = 0;
-
-    for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.memPoolTxs.begin(); mi != mempool.memPoolTxs.end(); ++mi) {
-        CBaseTx *pBaseTx = mi->second.GetTransaction().get();
-        if (!pBaseTx->IsBlockRewardTx() && !pCdMan->pTxCache->HasTx(pBaseTx->GetHash())) {
-            feeSymbol = std::get<0>(mi->second.GetFees());
-            fee       = std::get<1>(mi->second.GetFees());
-            txSize    = mi->second.GetTxSize();
-            feePerKb  = double(fee - pBaseTx->GetFuelFee(cw, height, nFuelRate)) / txSize * 1000.0;
-            priority  = mi->second.GetPriority();
-
-            txPriorities.emplace(TxPriority(priority, feePerKb, mi->second.GetTransaction()));
+// Walks the mempool txes in packing order without copying or sorting the pool. Requires mempool.cs.
+class CPackingOrder {
+public:
+    CPackingOrder() : poolIt(mempool.GetTxPriorities().rbegin()), poolEnd(mempool.GetTxPriorities().rend()) {}
+
+    // the next tx to pack, nullptr when there is none left
+    const TxPriority *Next() {
+        while (poolIt != poolEnd) {
+            const TxPriority *pNext = &*poolIt++;
+            if (!pNext->baseTx->IsBlockRewardTx() && !pCdMan->pTxCache->HasTx(pNext->baseTx->GetHash()))
+                return pNext;
         }
+        return nullptr;
     }
-}
+
+private:
+    set<TxPriority>::const_reverse_iterator poolIt;
+    set<TxPriority>::const_reverse_iterator poolEnd;
+};
 
 
 bool GetCurrentDelegate(const int64_t currentTime, const int32_t currHeight, const VoteDelegateVector &delegates,
@@ -312,16 +315,15 @@ static bool CreateNewBlockForPreStableCoinRelease(Miner &miner, CCacheWrapper &c
         uint64_t totalFuelFee   = 0;
         uint64_t reward         = 0;
 
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(cwIn, height, txPriorities, fuelRate);
+        // The mempool keeps its txes sorted by priority rules.
+        CPackingOrder packingOrder;
 
         LogPrint(BCLog::MINER, "got %lu transaction(s) sorted by priority rules\n",
-                 txPriorities.size());
+                 mempool.GetTxPriorities().size());
 
         // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
-            CBaseTx *pBaseTx = itor->baseTx.get();
+        for (const TxPriority *pTxPriority = packingOrder.Next(); pTxPriority != nullptr; pTxPriority = packingOrder.Next()) {
+            CBaseTx *pBaseTx = pTxPriority->baseTx.get();
 
             uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
             if (totalBlockSize + txSize >= nBlockMaxSize) {
@@ -375,7 +377,7 @@ static bool CreateNewBlockForPreStableCoinRelease(Miner &miner, CCacheWrapper &c
 
             ++index;
 
-            pBlock->vptx.push_back(itor->baseTx);
+            pBlock->vptx.push_back(pTxPriority->baseTx);
 
             LogPrint(BCLog::DEBUG, "miner's total fuel fee:%d, tx fuel fee:%d, fuel:%d, fuelRate:%d, txid:%s\n",
                     totalFuelFee, fuelFee, pBaseTx->fuel, fuelRate, pBaseTx->GetHash().GetHex());
@@ -422,147 +424,315 @@ static bool CreateStableCoinGenesisBlock(std::unique_ptr<CBlock> &pBlock) {
     return true;
 }
 
-static bool CreateNewBlockForStableCoinRelease(int64_t startMiningMs, Miner &miner, CCacheWrapper &cwIn, std::unique_ptr<CBlock> &pBlock) {
-    pBlock->vptx.push_back(std::make_shared<CUCoinBlockRewardTx>());
+// The txes packed into a block so far, executed one after the other on spCW. Requires cs_main.
+struct CBlockPack {
+    CBlockIndex *pIndexPrev = nullptr;
+    int32_t height          = 0;
+    uint32_t fuelRate       = 0;
+    CRegID minerRegid;
+    std::shared_ptr<CCacheWrapper> spCW;
+    std::unique_ptr<CBlock> pBlock;
+    uint32_t nBlockMaxSize  = 0;
+    uint64_t totalBlockSize = 0;
+    uint64_t totalFuel      = 0;
+    uint64_t totalFees      = 0;
+    uint64_t totalFuelFee   = 0;
+    map<TokenSymbol, uint64_t> rewards = { {SYMB::WICC, 0}, {SYMB::WUSD, 0} };
+    set<uint256> packedTxids;
+    set<uint256> failedTxids;   // not tried again until the block is produced
+    BlockPackStats stats;
+};
+
+// Account the execution of a tx, totalUs also counts its checks. Requires cs_main, which guards mapHistExecByType.
+static void AddPackExecTime(BlockPackStats &stats, const CBaseTx *pBaseTx, int64_t execUs, int64_t totalUs) {
+    static CHistogram &histExec = histogramRegistry.Get("miner.tx_exec");
+    static map<TxType, CHistogram *> mapHistExecByType;
+    AssertLockHeld(cs_main);
+
+    stats.execTime += execUs;
+    auto &typeStats = stats.txTypes[pBaseTx->GetTxTypeName()];
+    typeStats.count++;
+    typeStats.execTime += execUs;
+    histExec.Add(execUs);
+
+    auto itHist = mapHistExecByType.find(pBaseTx->nTxType);
+    if (itHist == mapHistExecByType.end())
+        itHist = mapHistExecByType.emplace(pBaseTx->nTxType,
+                                           &histogramRegistry.Get("miner.tx_exec." + pBaseTx->GetTxTypeName())).first;
+    itHist->second->Add(execUs);
+
+    if (pBaseTx->nTxType == PRICE_MEDIAN_TX)
+        stats.medianPriceTime += totalUs;
+    else if (pBaseTx->nTxType == CDP_FORCE_SETTLE_INTEREST_TX)
+        stats.forceSettleTime += totalUs;
+}
 
-    // Largest block you're willing to create:
-    uint32_t nBlockMaxSize = SysCfg().GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
-    // Limit to between 1K and MAX_BLOCK_SIZE-1K for sanity:
-    nBlockMaxSize = std::max<uint32_t>(1000, std::min<uint32_t>((MAX_BLOCK_SIZE - 1000), nBlockMaxSize));
+// Execute a tx on top of the txes packed so far and add it to the block, false if it is left out. The txes of
+// the block producer itself, fProducerTx, are exempt from the block size and fuel limits. Requires cs_main.
+static bool PackBlockTx(CBlockPack &pack, const std::shared_ptr<CBaseTx> &spTx, bool fProducerTx) {
+    CCacheWrapper &cwIn = *pack.spCW;
+    int32_t height      = pack.height;
+    uint32_t fuelRate   = pack.fuelRate;
+    CBaseTx *pBaseTx    = spTx.get();
+    const uint256 txid  = pBaseTx->GetHash();
+
+    uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+    pack.stats.triedTxCount++;
+    if (!fProducerTx && pack.totalBlockSize + txSize >= pack.nBlockMaxSize) {
+        LogPrint(BCLog::MINER, "Exceed max block size, txid: %s\n", txid.GetHex());
+
+        pack.failedTxids.insert(txid);
+        pack.stats.AddRejected("block-size");
+        return false;
+    }
 
-    // Collect memory pool transactions into the block
-    {
-        LOCK2(cs_main, mempool.cs);
+    auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
+    int64_t startUs = GetTimeMicros();
 
-        CBlockIndex *pIndexPrev            = chainActive.Tip();
-        uint32_t blockTime                 = pBlock->GetTime();
-        int32_t height                     = pIndexPrev->height + 1;
-        int32_t index                      = 0; // 0: block reward tx
-        uint32_t fuelRate                  = GetElementForBurn(pIndexPrev);
-        uint64_t totalBlockSize            = ::GetSerializeSize(*pBlock, SER_NETWORK, PROTOCOL_VERSION);
-        uint64_t totalFuel              = 0;
-        uint64_t totalFees                 = 0;
-        uint64_t totalFuelFee              = 0;
-        map<TokenSymbol, uint64_t> rewards = { {SYMB::WICC, 0}, {SYMB::WUSD, 0} };
-
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(cwIn, height, txPriorities, fuelRate);
-
-        // Push block price median transaction into queue.
-        txPriorities.emplace(TxPriority(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, std::make_shared<CBlockPriceMedianTx>(height)));
-
-        if (GetFeatureForkVersion(height) >= MAJOR_VER_R3) {
-            auto spCdpForceSettleInterestTx = std::make_shared<CCDPInterestForceSettleTx>(height);
-            if (!GetSettledInterestCdps(cwIn, height, spCdpForceSettleInterestTx->cdp_list)) {
-                return ERRORMSG("GetSettledInterestCdps error");
-            }
-            if (!spCdpForceSettleInterestTx->cdp_list.empty()) {
-                txPriorities.emplace(TxPriority(TRANSACTION_PRIORITY_CEILING, 0, spCdpForceSettleInterestTx));
+    try {
+        auto bm = MAKE_BENCHMARK("execute tx in mining block");
+        CValidationState state;
 
-                LogPrint(BCLog::MINER, "create CCDPInterestForceSettleTx to block! tx=%s\n",
-                        spCdpForceSettleInterestTx->ToString(cwIn.accountCache));
-            }
-        }
+        pBaseTx->nFuelRate = fuelRate;
 
-        LogPrint(BCLog::MINER, "Got %lu trx(s), sorted by priority\n", txPriorities.size());
+        LogPrint(BCLog::MINER, "begin to pack trx: %s\n", pBaseTx->ToString(spCW->accountCache));
 
-        // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
+        uint32_t prevBlockTime = pack.pIndexPrev->GetBlockTime();
+        CTxExecuteContext context(height, pack.pBlock->vptx.size(), fuelRate, pack.pBlock->GetTime(), prevBlockTime,
+                                  pack.minerRegid, spCW.get(), &state,
+                                  TxExecuteContextType::PRODUCE_BLOCK);
 
-            if (!CheckPackBlockTime(startMiningMs, height)) {
-                LogPrint(BCLog::MINER, "[%d] no time left to pack more tx, ignore! start_ms=%lld, tx_count=%u\n",
-                        height, startMiningMs, pBlock->vptx.size());
-                break;
-            }
+        int64_t execStartUs = GetTimeMicros();
+        bool fExecuted      = pBaseTx->CheckAndExecuteTx(context);
+        int64_t execUs      = GetTimeMicros() - execStartUs;
+        AddPackExecTime(pack.stats, pBaseTx, execUs, GetTimeMicros() - startUs);
 
-            CBaseTx *pBaseTx = itor->baseTx.get();
+        if (!fExecuted) {
+            LogPrint(BCLog::MINER, "failed to check/exec tx: %s\n", pBaseTx->ToString(spCW->accountCache));
 
-            uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
-            if (totalBlockSize + txSize >= nBlockMaxSize) {
-                LogPrint(BCLog::MINER, "Exceed max block size, txid: %s\n", pBaseTx->GetHash().GetHex());
+            pCdMan->pLogCache->SetExecuteFail(height, txid, state.GetRejectCode(), state.GetRejectReason());
+            pack.failedTxids.insert(txid);
+            pack.stats.AddRejected(state.GetRejectReason().empty() ? "execute-failed" : state.GetRejectReason());
+            return false;
+        }
 
-                continue;
-            }
+        // Run step limits
+        if (!fProducerTx && pack.totalFuel + pBaseTx->fuel >= MAX_BLOCK_FUEL) {
+            LogPrint(BCLog::MINER, "Exceed max block run steps, txid: %s\n", txid.GetHex());
+            pack.failedTxids.insert(txid);
+            pack.stats.AddRejected("block-fuel");
+            return false;
+        }
+    } catch (std::exception &e) {
+        LogPrint(BCLog::ERROR, "unexpected exception: %s\n", e.what());
 
-            auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
+        pack.failedTxids.insert(txid);
+        pack.stats.AddRejected("exception");
+        return false;
+    }
 
-            try {
-                auto bm = MAKE_BENCHMARK("execute tx in mining block");
-                CValidationState state;
+    spCW->Flush();
 
-                pBaseTx->nFuelRate = fuelRate;
+    auto fuelFee     = pBaseTx->GetFuelFee(cwIn, height, fuelRate);
+    auto fees_symbol = std::get<0>(pBaseTx->GetFees());
+    auto fees        = std::get<1>(pBaseTx->GetFees());
+    assert(fees_symbol == SYMB::WICC || fees_symbol == SYMB::WUSD);
 
-                // Special case for price median tx,
-                if (pBaseTx->IsPriceMedianTx()) {
-                    CBlockPriceMedianTx *pPriceMedianTx = (CBlockPriceMedianTx *)itor->baseTx.get();
-                    if (!spCW->ppCache.CalcMedianPrices(*spCW, height, pPriceMedianTx->median_prices))
-                        return ERRORMSG("calculate block median prices error");
-                }
+    pack.totalBlockSize += txSize;
+    pack.totalFuel += pBaseTx->fuel;
+    pack.totalFuelFee += fuelFee;
+    pack.totalFees += fees;
+    assert(fees >= fuelFee);
+    pack.rewards[fees_symbol] += (fees - fuelFee);
 
-                LogPrint(BCLog::MINER, "begin to pack trx: %s\n", pBaseTx->ToString(spCW->accountCache));
+    pack.pBlock->vptx.push_back(spTx);
+    pack.packedTxids.insert(txid);
+    pack.failedTxids.erase(txid);
+    pack.stats.includedTxCount++;
 
-                uint32_t prevBlockTime = pIndexPrev->GetBlockTime();
-                CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime,
-                                          miner.account.regid, spCW.get(), &state,
-                                          TxExecuteContextType::PRODUCE_BLOCK);
+    LogPrint(BCLog::DEBUG, "miner total_fuel_fee=%d, tx_fuel_fee=%d, fuel=%d, fuelRate:%d, txid:%s\n",
+            pack.totalFuelFee, fuelFee, pBaseTx->fuel, fuelRate, txid.GetHex());
 
-                if (!pBaseTx->CheckAndExecuteTx(context)) {
-                    LogPrint(BCLog::MINER, "failed to check/exec tx: %s\n", pBaseTx->ToString(spCW->accountCache));
+    return true;
+}
 
-                    pCdMan->pLogCache->SetExecuteFail(height, pBaseTx->GetHash(), state.GetRejectCode(), state.GetRejectReason());
-                    continue;
-                }
+static bool InitBlockPack(CBlockPack &pack, const std::shared_ptr<CCacheWrapper> &spCW, CBlockIndex *pIndexPrev,
+                          uint32_t blockTime, const CRegID &minerRegid) {
+    pack.pIndexPrev = pIndexPrev;
+    pack.height     = pIndexPrev->height + 1;
+    pack.fuelRate   = GetElementForBurn(pIndexPrev);
+    pack.minerRegid = minerRegid;
+    pack.spCW       = spCW;
+    pack.pBlock.reset(new CBlock());
+    pack.pBlock->SetTime(blockTime);
+    pack.pBlock->vptx.push_back(std::make_shared<CUCoinBlockRewardTx>());
 
-                // Run step limits
-                if (totalFuel + pBaseTx->fuel >= MAX_BLOCK_FUEL) {
-                    LogPrint(BCLog::MINER, "Exceed max block run steps, txid: %s\n", pBaseTx->GetHash().GetHex());
-                    continue;
-                }
-            } catch (std::exception &e) {
-                LogPrint(BCLog::ERROR, "unexpected exception: %s\n", e.what());
+    // Largest block you're willing to create:
+    pack.nBlockMaxSize = SysCfg().GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
+    // Limit to between 1K and MAX_BLOCK_SIZE-1K for sanity:
+    pack.nBlockMaxSize  = std::max<uint32_t>(1000, std::min<uint32_t>((MAX_BLOCK_SIZE - 1000), pack.nBlockMaxSize));
+    pack.totalBlockSize = ::GetSerializeSize(*pack.pBlock, SER_NETWORK, PROTOCOL_VERSION);
+
+    // The txes of the block producer itself are executed first, ahead of any mempool tx, so that they always
+    // fit in the block and the same-block txes run on the new median prices.
+    int64_t medianStartUs = GetTimeMicros();
+    auto spPriceMedianTx  = std::make_shared<CBlockPriceMedianTx>(pack.height);
+    if (!spCW->ppCache.CalcMedianPrices(*spCW, pack.height, spPriceMedianTx->median_prices))
+        return ERRORMSG("calculate block median prices error");
+
+    pack.stats.medianPriceTime += GetTimeMicros() - medianStartUs;
+    if (!PackBlockTx(pack, spPriceMedianTx, true))
+        return ERRORMSG("[%d] failed to pack the block price median tx", pack.height);
+
+    if (GetFeatureForkVersion(pack.height) >= MAJOR_VER_R3) {
+        int64_t startUs = GetTimeMicros();
+        auto spCdpForceSettleInterestTx = std::make_shared<CCDPInterestForceSettleTx>(pack.height);
+        if (!GetSettledInterestCdps(*spCW, pack.height, spCdpForceSettleInterestTx->cdp_list)) {
+            return ERRORMSG("GetSettledInterestCdps error");
+        }
+        pack.stats.forceSettleTime += GetTimeMicros() - startUs;
+        if (!spCdpForceSettleInterestTx->cdp_list.empty()) {
+            LogPrint(BCLog::MINER, "create CCDPInterestForceSettleTx to block! tx=%s\n",
+                    spCdpForceSettleInterestTx->ToString(spCW->accountCache));
 
-                continue;
+            PackBlockTx(pack, spCdpForceSettleInterestTx, true);
+        }
+    }
+
+    return true;
+}
+
+// Pack the mempool txes not packed yet in priority order while fContinue() returns true. The txes that failed
+// in an earlier call are tried again only if fRetryFailed. If fContinue() stops it, pCutOffTxCount, when
+// given, is set to the number of txes left out. Requires cs_main and mempool.cs.
+static void PackBlockTxes(CBlockPack &pack, bool fRetryFailed, const std::function<bool()> &fContinue,
+                          uint32_t *pCutOffTxCount = nullptr) {
+    // Collect transactions into the block.
+    CPackingOrder packingOrder;
+    for (const TxPriority *pTxPriority = packingOrder.Next(); pTxPriority != nullptr; pTxPriority = packingOrder.Next()) {
+        const uint256 &txid = pTxPriority->baseTx->GetHash();
+        if (pack.packedTxids.count(txid) || (!fRetryFailed && pack.failedTxids.count(txid)))
+            continue;
+
+        if (!fContinue()) {
+            if (pCutOffTxCount != nullptr) {
+                // the candidates left out, this one included
+                *pCutOffTxCount = 1;
+                for (pTxPriority = packingOrder.Next(); pTxPriority != nullptr; pTxPriority = packingOrder.Next()) {
+                    const uint256 &leftTxid = pTxPriority->baseTx->GetHash();
+                    if (!pack.packedTxids.count(leftTxid) && (fRetryFailed || !pack.failedTxids.count(leftTxid)))
+                        (*pCutOffTxCount)++;
+                }
             }
+            break;
+        }
 
-            spCW->Flush();
+        PackBlockTx(pack, pTxPriority->baseTx, false);
+    }
+}
 
-            auto fuelFee        = pBaseTx->GetFuelFee(cwIn, height, fuelRate);
-            auto fees_symbol = std::get<0>(pBaseTx->GetFees());
-            auto fees        = std::get<1>(pBaseTx->GetFees());
-            assert(fees_symbol == SYMB::WICC || fees_symbol == SYMB::WUSD);
+// Fill in the reward fees and the header, the block reward tx is completed and signed by CreateBlockRewardTx()
+static void FinishBlockPack(CBlockPack &pack) {
+    CBlock *pBlock = pack.pBlock.get();
+    nLastBlockTx   = pBlock->vptx.size();
+    nLastBlockSize = pack.totalBlockSize;
 
-            totalBlockSize += txSize;
-            totalFuel += pBaseTx->fuel;
-            totalFuelFee += fuelFee;
-            totalFees += fees;
-            assert(fees >= fuelFee);
-            rewards[fees_symbol] += (fees - fuelFee);
+    ((CUCoinBlockRewardTx *)pBlock->vptx[0].get())->reward_fees = pack.rewards;
 
-            ++index;
+    // Fill in header
+    pBlock->SetPrevBlockHash(pack.pIndexPrev->GetBlockHash());
+    pBlock->SetNonce(0);
+    pBlock->SetHeight(pack.height);
+    pBlock->SetFuel(pack.totalFuelFee);
+    pBlock->SetFuelRate(pack.fuelRate);
 
-            pBlock->vptx.push_back(itor->baseTx);
+    LogPrint(BCLog::INFO, "[%d] tx=%d, totalBlockSize=%llu\n", pack.height, pBlock->vptx.size(), pack.totalBlockSize);
+}
 
-            LogPrint(BCLog::DEBUG, "miner total_fuel_fee=%d, tx_fuel_fee=%d, fuel=%d, fuelRate:%d, txid:%s\n",
-                    totalFuelFee, fuelFee, pBaseTx->fuel, fuelRate, pBaseTx->GetHash().GetHex());
+/**
+ * Keeps a block pack ahead of the tip while a local block producer is on duty for the next block: the
+ * mempool txes are executed on it as they come in, a little at a time, and the pack is dropped as soon as
+ * the tip changes. At slot time the block producer takes it over, packs the txes that came in last while
+ * time allows and signs. Requires cs_main.
+ */
+class CBlockTemplateBuilder {
+public:
+    /**
+     * The template built on pIndexPrev for minerRegid, nullptr if there is none. Its txes were executed with
+     * its own block time, so it is only taken over when that is blockTime, the time the block is stamped with.
+     */
+    std::unique_ptr<CBlockPack> Take(CBlockIndex *pIndexPrev, const CRegID &minerRegid, uint32_t blockTime) {
+        std::unique_ptr<CBlockPack> pPack = std::move(pTemplate);
+        if (pPack == nullptr || pPack->pIndexPrev != pIndexPrev || pPack->minerRegid != minerRegid ||
+            pPack->pBlock->GetTime() != blockTime)
+            return nullptr;
+
+        return pPack;
+    }
 
-        }
+    /** One round of the builder thread. */
+    void Update();
 
-        nLastBlockTx                   = index + 1;
-        nLastBlockSize                 = totalBlockSize;
+    void Clear() { pTemplate.reset(); }
 
-        ((CUCoinBlockRewardTx *)pBlock->vptx[0].get())->reward_fees = rewards;
+private:
+    CBlockIndex *pIndexTried = nullptr;  // the tip a template was last tried on, used by the builder thread only
+    std::unique_ptr<CBlockPack> pTemplate;
+};
 
-        // Fill in header
-        pBlock->SetPrevBlockHash(pIndexPrev->GetBlockHash());
-        pBlock->SetNonce(0);
-        pBlock->SetHeight(height);
-        pBlock->SetFuel(totalFuelFee);
-        pBlock->SetFuelRate(fuelRate);
+static CBlockTemplateBuilder blockTemplateBuilder;
 
-        LogPrint(BCLog::INFO, "[%d] tx=%d, totalBlockSize=%llu\n", height, index + 1, totalBlockSize);
+static bool CreateNewBlockForStableCoinRelease(int64_t startMiningMs, Miner &miner, const std::shared_ptr<CCacheWrapper> &spCW,
+                                               std::unique_ptr<CBlock> &pBlock, BlockPackStats &stats) {
+    static CHistogram &histPackTime    = histogramRegistry.Get("miner.pack_time");
+    static CHistogram &histIncluded    = histogramRegistry.Get("miner.included_txs");
+    static CHistogram &histRejected    = histogramRegistry.Get("miner.rejected_txs");
+    static CHistogram &histCutOff      = histogramRegistry.Get("miner.cutoff_txs");
+    static CHistogram &histMedianPrice = histogramRegistry.Get("miner.median_price");
+    static CHistogram &histForceSettle = histogramRegistry.Get("miner.force_settle");
+
+    // Collect memory pool transactions into the block
+    LOCK2(cs_main, mempool.cs);
+    int64_t startUs = GetTimeMicros();
+
+    CBlockIndex *pIndexPrev = chainActive.Tip();
+    std::unique_ptr<CBlockPack> pPack = blockTemplateBuilder.Take(pIndexPrev, miner.account.regid, pBlock->GetTime());
+    if (pPack != nullptr) {
+        LogPrint(BCLog::MINER, "[%d] take over the block template, block_time=%u, tx_count=%u, failed_tx_count=%u\n",
+                 pPack->height, pPack->pBlock->GetTime(), pPack->pBlock->vptx.size(), pPack->failedTxids.size());
+        pPack->stats.templateTxCount = pPack->stats.includedTxCount;
+    } else {
+        pPack.reset(new CBlockPack());
+        if (!InitBlockPack(*pPack, spCW, pIndexPrev, pBlock->GetTime(), miner.account.regid))
+            return false;
     }
 
+    LogPrint(BCLog::MINER, "Got %lu trx(s), sorted by priority\n", mempool.GetTxPriorities().size());
+
+    int32_t height = pPack->height;
+    auto fContinue = [&]() {
+        if (!CheckPackBlockTime(startMiningMs, height)) {
+            LogPrint(BCLog::MINER, "[%d] no time left to pack more tx, ignore! start_ms=%lld, tx_count=%u\n",
+                    height, startMiningMs, pPack->pBlock->vptx.size());
+            pPack->stats.cutOffTime = (GetTimeMillis() - startMiningMs) * 1000;
+            return false;
+        }
+        return true;
+    };
+    PackBlockTxes(*pPack, true, fContinue, &pPack->stats.cutOffTxCount);
+
+    FinishBlockPack(*pPack);
+    pBlock = std::move(pPack->pBlock);
+
+    stats          = pPack->stats;
+    stats.packTime = GetTimeMicros() - startUs;
+    histPackTime.Add(stats.packTime);
+    histIncluded.Add(stats.includedTxCount);
+    histRejected.Add(stats.rejectedTxCount);
+    histCutOff.Add(stats.cutOffTxCount);
+    histMedianPrice.Add(stats.medianPriceTime);
+    histForceSettle.Add(stats.forceSettleTime);
+
     return true;
 }
 
@@ -647,6 +817,7 @@ static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &
     int64_t lastTime    = 0;
     bool success        = false;
     int32_t blockHeight = 0;
+    BlockPackStats packStats;
     std::unique_ptr<CBlock> pBlock(new CBlock());
     if (!pBlock.get())
         throw runtime_error("ProduceBlock() : failed to create new block");
@@ -661,18 +832,26 @@ static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &
     }
 
     lastTime  = GetTimeMillis();
-    auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
 
     pBlock->SetTime(MillisToSecond(startMiningMs));  // set block time first
 
-    if (blockHeight == (int32_t)SysCfg().GetVer2GenesisHeight()) {
-        success = CreateStableCoinGenesisBlock(pBlock);  // stable coin genesis
+    {
+        // The block and per tx caches are all dropped once the txes are packed, so they are carved out of
+        // produceBlockArena. The scope must end before CheckWork(), which connects the block.
+        AssertLockHeld(cs_main);
+        CArenaReleaser arenaReleaser(produceBlockArena);
+        CArenaScope arenaScope(produceBlockArena);
+        auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
 
-    } else if (GetFeatureForkVersion(blockHeight) == MAJOR_VER_R1) {
-        success = CreateNewBlockForPreStableCoinRelease(miner, *spCW, pBlock); // pre-stable coin release
+        if (blockHeight == (int32_t)SysCfg().GetVer2GenesisHeight()) {
+            success = CreateStableCoinGenesisBlock(pBlock);  // stable coin genesis
 
-    } else {
-        success = CreateNewBlockForStableCoinRelease(startMiningMs, miner, *spCW, pBlock);    // stable coin release
+        } else if (GetFeatureForkVersion(blockHeight) == MAJOR_VER_R1) {
+            success = CreateNewBlockForPreStableCoinRelease(miner, *spCW, pBlock); // pre-stable coin release
+
+        } else {
+            success = CreateNewBlockForStableCoinRelease(startMiningMs, miner, spCW, pBlock, packStats);    // stable coin release
+        }
     }
 
     if (!success) {
@@ -711,6 +890,7 @@ static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &
     {
         LOCK(csMinedBlocks);
         miningBlockInfo.Set(pBlock.get());
+        miningBlockInfo.packStats = packStats;
         minedBlocks.push_front(miningBlockInfo);
         miningBlockInfo.SetNull();
     }
@@ -721,6 +901,72 @@ static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &
     return true;
 }
 
+void CBlockTemplateBuilder::Update() {
+    CBlockIndex *pIndexPrev = nullptr;
+    {
+        LOCK(cs_main);
+        pIndexPrev = chainActive.Tip();
+        if (pTemplate != nullptr && pTemplate->pIndexPrev != pIndexPrev)
+            pTemplate.reset();  // built on an old tip
+    }
+
+    if (pIndexPrev == nullptr || SysCfg().IsReindex() || IsInitialBlockDownload())
+        return;
+
+    if (pIndexPrev != pIndexTried) {
+        // a new tip, start a template if one of our delegates is on duty for the next block
+        pIndexTried    = pIndexPrev;
+        int32_t height = pIndexPrev->height + 1;
+        if (height == (int32_t)SysCfg().GetVer2GenesisHeight() || GetFeatureForkVersion(height) == MAJOR_VER_R1)
+            return;
+
+        int64_t blockTime = pIndexPrev->GetBlockTime() + GetBlockInterval(height);
+        Miner miner;
+        uint32_t totalDelegateNum;
+        if (!GetMiner(blockTime * 1000, height, miner, totalDelegateNum) ||
+            !miner.account.CheckPerms(AccountPermType::PERM_MINE_BLOCK))
+            return;
+
+        LOCK2(cs_main, mempool.cs);
+        if (chainActive.Tip() != pIndexPrev)
+            return;
+
+        std::unique_ptr<CBlockPack> pPack(new CBlockPack());
+        if (!InitBlockPack(*pPack, std::make_shared<CCacheWrapper>(pCdMan), pIndexPrev, blockTime, miner.account.regid))
+            return;
+
+        LogPrint(BCLog::MINER, "[%d] start a block template, block_time=%lld, regid=%s\n", height, blockTime,
+                 miner.account.regid.ToString());
+        pTemplate = std::move(pPack);
+    }
+
+    // execute the txes that came in since the last round, without holding cs_main for long
+    LOCK2(cs_main, mempool.cs);
+    if (pTemplate == nullptr || pTemplate->pIndexPrev != chainActive.Tip())
+        return;
+
+    int64_t deadlineMs = GetTimeMillis() + BLOCK_TEMPLATE_LOCK_MS;
+    PackBlockTxes(*pTemplate, false, [&]() { return GetTimeMillis() < deadlineMs; });
+}
+
+void static ThreadBuildBlockTemplate() {
+    RenameThread("coin-blocktemplate");
+
+    try {
+        while (true) {
+            boost::this_thread::interruption_point();
+            blockTemplateBuilder.Update();
+            MilliSleep(BLOCK_TEMPLATE_INTERVAL_MS);
+        }
+    } catch (...) {
+        {
+            LOCK(cs_main);
+            blockTemplateBuilder.Clear();
+        }
+        throw;
+    }
+}
+
 void static ThreadBlockProducing(CWallet *pWallet, int32_t targetHeight) {
     LogPrint(BCLog::INFO, "started\n");
 
@@ -866,6 +1112,8 @@ void GenerateProduceBlockThread(bool fGenerate, CWallet *pWallet, int32_t target
 
     minerThreads = new boost::thread_group();
     minerThreads->create_thread(boost::bind(&ThreadBlockProducing, pWallet, targetHeight));
+    if (SysCfg().GetBoolArg("-blocktemplate", DEFAULT_BLOCK_TEMPLATE))
+        minerThreads->create_thread(&ThreadBuildBlockTemplate);
 }
 
 void MinedBlockInfo::SetNull() {
@@ -878,6 +1126,7 @@ void MinedBlockInfo::SetNull() {
     totalBlockSize = 0;
     hash.SetNull();
     hashPrevBlock.SetNull();
+    packStats      = BlockPackStats();
 }
 
 void MinedBlockInfo::Set(const CBlock *pBlock) {
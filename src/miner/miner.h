@@ -39,24 +39,29 @@ struct Miner {
     CKey key;
 };
 
-struct TxPriority {
-    double priority;
-    double feePerKb;
-    std::shared_ptr<CBaseTx> baseTx;
-
-    TxPriority(const double priorityIn, const double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn)
-        : priority(priorityIn), feePerKb(feePerKbIn), baseTx(baseTxIn) {}
-
-    bool operator<(const TxPriority &other) const {
-        if (fabs(this->priority - other.priority) <= 1000) {
-            if (fabs(this->feePerKb < other.feePerKb) <= 1e-8) {
-                return this->baseTx->GetHash() < other.baseTx->GetHash();
-            } else {
-                return this->feePerKb < other.feePerKb;
-            }
-        } else {
-            return this->priority < other.priority;
-        }
+// how the txes of a mined block were packed, times in microseconds
+struct BlockPackStats {
+    struct TxTypeStats {
+        uint32_t count    = 0;  // txes executed, included or not
+        int64_t execTime  = 0;  // time spent in CheckAndExecuteTx
+    };
+
+    uint32_t triedTxCount     = 0;  // txes executed or refused for size
+    uint32_t includedTxCount  = 0;
+    uint32_t rejectedTxCount  = 0;
+    uint32_t templateTxCount  = 0;  // txes included by the block template builder, before the slot
+    uint32_t cutOffTxCount    = 0;  // candidate txes left out when the packing time ran out
+    int64_t cutOffTime        = 0;  // packing time used up when it ran out, 0 if it did not
+    int64_t packTime          = 0;  // time spent packing in the slot, template rounds excluded
+    int64_t execTime          = 0;
+    int64_t medianPriceTime   = 0;  // median price calculation and execution of the price median tx
+    int64_t forceSettleTime   = 0;  // cdp selection and execution of the force settle tx
+    map<string, uint32_t> rejectReasons;
+    map<string, TxTypeStats> txTypes;
+
+    void AddRejected(const string &reason) {
+        rejectedTxCount++;
+        rejectReasons[reason]++;
     }
 };
 
@@ -72,6 +77,7 @@ public:
     uint64_t totalBlockSize;  // block size(bytes)
     uint256 hash;             // block hash
     uint256 hashPrevBlock;    // prev block has
+    BlockPackStats packStats; // empty for the blocks packed before the stable coin release
 
 public:
     MinedBlockInfo() { SetNull(); }
@@ -93,8 +99,6 @@ bool CheckWork(CBlock *pBlock);
 /** Get burn element */
 uint32_t GetElementForBurn(CBlockIndex *pIndex);
 
-void GetPriorityTx(CCacheWrapper &cw, vector<TxPriority> &vecPriority, int32_t nFuelRate);
-
 void ShuffleDelegates(const int32_t nCurHeight, const int64_t blockTime,
         VoteDelegateVector &delegates);
 
@@ -11,8 +11,7 @@
 #include <set>
 #include "sync.h"
 #include "commons/uint256.h"
-#include "miner/pbftlimitmap.h"
-#include "commons/mruset.h"
+#include "commons/boundedhash.h"
 #include "entities/vote.h"
 #include "commons/lrucache.hpp"
 
@@ -27,8 +26,8 @@ public:
     CCriticalSection cs_pbftmessage;
 private:
     CLruCache<uint256, BpMsgMap, CUint256Hasher> blockMessagesMap;
-    mruset<uint256> broadcastedBlockHashSet;
-    mruset<MsgType> messageKnown;
+    CBoundedHashSet broadcastedBlockHashSet;
+    CBoundedHashSet messageKnown;  // msg hashes
 
 public:
     CPBFTMessageMan()
@@ -48,12 +47,12 @@ public:
 
     bool IsKnown(const MsgType msg) {
         LOCK(cs_pbftmessage);
-        return messageKnown.count(msg) != 0;
+        return messageKnown.count(msg.GetHash()) != 0;
     }
 
      const BpMsgMap *InsertMessageNoLock(const MsgType& msg) {
         AssertLockHeld(cs_pbftmessage);
-        messageKnown.insert(msg);
+        messageKnown.insert(msg.GetHash());
         auto pBpMsgMap = blockMessagesMap.Touch(msg.blockHash);
         assert(pBpMsgMap && "Touch() must return a valid pBpMsgMap");
         auto ret = pBpMsgMap->emplace(msg.miner, msg);
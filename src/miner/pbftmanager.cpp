@@ -12,18 +12,34 @@
 #include "wallet/wallet.h"
 #include "net.h"
 #include "p2p/node.h"
+#include "sigcheckqueue.h"
+
+#include <boost/thread.hpp>
 
 CPBFTMan pbftMan;
+CPBFTMessageQueue pbftMessageQueue;
 extern CWallet *pWalletMain;
 extern CCacheDBManager *pCdMan;
 
-static inline const VoteDelegateVector& GetBpListByHeight(ActiveDelegatesStore &activeDelegatesStore, HeightType height) {
+static inline const VoteDelegateVector& GetBpListByHeight(const ActiveDelegatesStore &activeDelegatesStore, HeightType height) {
     // make sure the height > tip height - 100
     return (height > activeDelegatesStore.active_delegates.update_height || activeDelegatesStore.last_delegates.IsEmpty())
             ? activeDelegatesStore.active_delegates.delegates
             : activeDelegatesStore.last_delegates.delegates;
 }
 
+const ActiveDelegatesStore* CPBFTMan::GetActiveDelegatesStore() {
+
+    AssertLockHeld(cs_main);
+    // the active delegates only change with the tip, read them once per tip
+    uint256 tipHash = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256();
+    if (!fActiveDelegatesCached || activeDelegatesTipHash != tipHash) {
+        fActiveDelegatesCached = pCdMan->pDelegateCache->GetActiveDelegates(activeDelegatesCache);
+        activeDelegatesTipHash = tipHash;
+    }
+    return fActiveDelegatesCached ? &activeDelegatesCache : nullptr;
+}
+
 void CPBFTMan::InitFinIndex(CBlockIndex *globalFinIndex) {
     LOCK(cs_finblock);
     global_fin_index = globalFinIndex;
@@ -70,8 +86,8 @@ bool CPBFTMan::UpdateLocalFinBlock(CBlockIndex* pTipIndex){
         return true;
     }
 
-    ActiveDelegatesStore activeDelegatesStore;
-    if (!pCdMan->pDelegateCache->GetActiveDelegates(activeDelegatesStore)) {
+    const ActiveDelegatesStore *pDelegatesStore = GetActiveDelegatesStore();
+    if (pDelegatesStore == nullptr) {
         return ERRORMSG("get active delegates error");
     }
 
@@ -83,7 +99,7 @@ bool CPBFTMan::UpdateLocalFinBlock(CBlockIndex* pTipIndex){
     CBlockIndex* pIndex = pTipIndex;
     while (pIndex && (uint32_t)pIndex->height > minHeight) {
 
-        const auto &bpList = GetBpListByHeight(activeDelegatesStore, pIndex->height);
+        const auto &bpList = GetBpListByHeight(*pDelegatesStore, pIndex->height);
         if (confirmMessageMan.CheckConfirmByBlock(pIndex->GetBlockHash(), bpList)) {
             local_fin_index = pIndex;
             return true;
@@ -99,8 +115,8 @@ bool CPBFTMan::UpdateGlobalFinBlock(CBlockIndex* pTipIndex){
     AssertLockHeld(cs_main);
     assert(pTipIndex == chainActive.Tip() && pTipIndex != nullptr && "tip index invalid");
 
-    ActiveDelegatesStore activeDelegatesStore;
-    if (!pCdMan->pDelegateCache->GetActiveDelegates(activeDelegatesStore)) {
+    const ActiveDelegatesStore *pDelegatesStore = GetActiveDelegatesStore();
+    if (pDelegatesStore == nullptr) {
         return ERRORMSG("get active delegates error");
     }
 
@@ -118,7 +134,7 @@ bool CPBFTMan::UpdateGlobalFinBlock(CBlockIndex* pTipIndex){
     minHeight = max(globalFinHeight, minHeight);
 
     while (pIndex && (uint32_t)pIndex->height > minHeight) {
-        const auto &bpList = GetBpListByHeight(activeDelegatesStore, pIndex->height);
+        const auto &bpList = GetBpListByHeight(*pDelegatesStore, pIndex->height);
         if (finalityMessageMan.CheckConfirmByBlock(pIndex->GetBlockHash(), bpList)) {
             return SaveGlobalFinBlock(pIndex);
         }
@@ -168,6 +184,47 @@ CBlockIndex* CPBFTMan::GetNewGlobalFinIndex(const CBlockFinalityMessage& msg) {
     return pIndex;
 }
 
+bool CPBFTMan::AcceptBlockConfirmMessage(const CBlockConfirmMessage& msg, bool &fNewFin) {
+
+    AssertLockHeld(cs_main);
+    LOCK2(cs_finblock, confirmMessageMan.cs_pbftmessage);
+    auto pBpMsgMap = confirmMessageMan.InsertMessageNoLock(msg);
+
+    CBlockIndex* pNewIndex = GetNewLocalFinIndex(msg);
+    if (pNewIndex != nullptr) {
+        const ActiveDelegatesStore *pDelegatesStore = GetActiveDelegatesStore();
+        if (pDelegatesStore == nullptr) {
+            return ERRORMSG("get active delegates error");
+        }
+        const auto &bpList = GetBpListByHeight(*pDelegatesStore, pNewIndex->height);
+        if (confirmMessageMan.CheckConfirm(pBpMsgMap, bpList)) {
+            local_fin_index = pNewIndex;
+            fNewFin = true;
+        }
+    }
+    return true;
+}
+
+bool CPBFTMan::AcceptBlockFinalityMessage(const CBlockFinalityMessage& msg) {
+
+    AssertLockHeld(cs_main);
+    LOCK2(cs_finblock, finalityMessageMan.cs_pbftmessage);
+    auto pBpMsgMap = finalityMessageMan.InsertMessageNoLock(msg);
+
+    CBlockIndex* pNewIndex = GetNewGlobalFinIndex(msg);
+    if (pNewIndex != nullptr) {
+        const ActiveDelegatesStore *pDelegatesStore = GetActiveDelegatesStore();
+        if (pDelegatesStore == nullptr) {
+            return ERRORMSG("get active delegates error");
+        }
+        const auto &bpList = GetBpListByHeight(*pDelegatesStore, pNewIndex->height);
+        if (finalityMessageMan.CheckConfirm(pBpMsgMap, bpList)) {
+            UpdateGlobalFinBlock(pNewIndex);
+        }
+    }
+    return true;
+}
+
 bool CPBFTMan::ProcessBlockConfirmMessage(CNode *pFrom, const CBlockConfirmMessage& msg) {
 
     if(confirmMessageMan.IsKnown(msg)){
@@ -181,29 +238,13 @@ bool CPBFTMan::ProcessBlockConfirmMessage(CNode *pFrom, const CBlockConfirmMessa
     }
 
     LOCK(cs_main);
-    CBlockIndex* pNewIndex = nullptr;
-    {
-        LOCK2(cs_finblock, confirmMessageMan.cs_pbftmessage);
-        auto pBpMsgMap = confirmMessageMan.InsertMessageNoLock(msg);
-
-        pNewIndex = GetNewLocalFinIndex(msg);
-        if (pNewIndex != nullptr) {
-            ActiveDelegatesStore activeDelegatesStore;
-            if (!pCdMan->pDelegateCache->GetActiveDelegates(activeDelegatesStore)) {
-                return ERRORMSG("get active delegates error");
-            }
-            const auto &bpList = GetBpListByHeight(activeDelegatesStore, pNewIndex->height);
-            if (confirmMessageMan.CheckConfirm(pBpMsgMap, bpList)) {
-                local_fin_index = pNewIndex;
-            } else {
-                pNewIndex = nullptr;
-            }
-        }
-    }
+    bool fNewFin = false;
+    if (!AcceptBlockConfirmMessage(msg, fNewFin))
+        return false;
 
     RelayBlockConfirmMessage(msg);
 
-    if(pNewIndex != nullptr){
+    if(fNewFin){
         BroadcastBlockFinality(GetLocalFinIndex());
     }
     return true;
@@ -224,26 +265,53 @@ bool CPBFTMan::ProcessBlockFinalityMessage(CNode *pFrom, const CBlockFinalityMes
     }
 
     LOCK(cs_main);
-    {
-        LOCK2(cs_finblock, finalityMessageMan.cs_pbftmessage);
+    if (!AcceptBlockFinalityMessage(msg))
+        return false;
 
-        auto pBpMsgMap = finalityMessageMan.InsertMessageNoLock(msg);
+    RelayBlockFinalityMessage(msg);
+    return true;
+}
 
-        CBlockIndex* pNewIndex = GetNewGlobalFinIndex(msg);
-        if (pNewIndex != nullptr) {
-            ActiveDelegatesStore activeDelegatesStore;
-            if (!pCdMan->pDelegateCache->GetActiveDelegates(activeDelegatesStore)) {
-                return ERRORMSG("get active delegates error");
-            }
-            const auto &bpList = GetBpListByHeight(activeDelegatesStore, pNewIndex->height);
-            if (finalityMessageMan.CheckConfirm(pBpMsgMap, bpList)) {
-                UpdateGlobalFinBlock(pNewIndex);
-            }
-        }
+bool CPBFTMan::ProcessBlockConfirmMessages(PBFTConfirmList& msgs) {
+
+    CheckPBFTMessages(PBFTMsgType::CONFIRM_BLOCK, confirmMessageMan, msgs);
+    if (msgs.empty())
+        return false;
+
+    LOCK(cs_main);
+    bool fNewFin   = false;
+    bool fAccepted = false;
+    for (const auto &item : msgs) {
+        // one rejected msg must not hold back the others of the batch
+        if (!AcceptBlockConfirmMessage(item.second, fNewFin))
+            continue;
+
+        RelayBlockConfirmMessage(item.second);
+        fAccepted = true;
     }
 
-    RelayBlockFinalityMessage(msg);
-    return true;
+    if(fNewFin){
+        BroadcastBlockFinality(GetLocalFinIndex());
+    }
+    return fAccepted;
+}
+
+bool CPBFTMan::ProcessBlockFinalityMessages(PBFTFinalityList& msgs) {
+
+    CheckPBFTMessages(PBFTMsgType::FINALITY_BLOCK, finalityMessageMan, msgs);
+    if (msgs.empty())
+        return false;
+
+    LOCK(cs_main);
+    bool fAccepted = false;
+    for (const auto &item : msgs) {
+        if (!AcceptBlockFinalityMessage(item.second))
+            continue;
+
+        RelayBlockFinalityMessage(item.second);
+        fAccepted = true;
+    }
+    return fAccepted;
 }
 
 static bool PbftFindMiner(CRegID delegate, Miner &miner){
@@ -382,16 +450,15 @@ bool CPBFTMan::BroadcastBlockConfirm(const CBlockIndex* pTipIndex) {
     return true;
 }
 
-bool CPBFTMan::CheckPBFTMessage(CNode *pFrom, const int32_t msgType ,const CPBFTMessage& msg) {
+bool CPBFTMan::CheckPBFTMessageState(NodeId nodeId, const int32_t msgType, const CPBFTMessage& msg, CAccount& account) {
 
     //check message type;
     if(msg.msgType != msgType ) {
         LogPrint(BCLog::INFO, "Misbehaving: invalid pbft_msg_type=%d, expected=%d, Misbehavior add 100\n", msg.msgType, msgType);
-        Misbehaving(pFrom->GetId(), 100);
+        Misbehaving(nodeId, 100);
         return false;
     }
 
-    CAccount account;
     {
         LOCK(cs_main);
         uint32_t tipHeight = chainActive.Height();
@@ -426,26 +493,35 @@ bool CPBFTMan::CheckPBFTMessage(CNode *pFrom, const int32_t msgType ,const CPBFT
             }
         }
 
-        ActiveDelegatesStore activeDelegatesStore;
-        if (!pCdMan->pDelegateCache->GetActiveDelegates(activeDelegatesStore)) {
+        const ActiveDelegatesStore *pDelegatesStore = GetActiveDelegatesStore();
+        if (pDelegatesStore == nullptr) {
             return ERRORMSG("get active delegates error");
         }
 
-        const auto &bpList = GetBpListByHeight(activeDelegatesStore, msg.height);
+        const auto &bpList = GetBpListByHeight(*pDelegatesStore, msg.height);
         if (std::find(bpList.begin(), bpList.end(), msg.miner) == bpList.end()) {
             LogPrint(BCLog::INFO, "the miner=%s of msg is not in bp list! Misbehavior add %d, msg_block=%s\n",
                 msg.miner.ToString(), 2, msg.GetBlockId());
-            Misbehaving(pFrom->GetId(), 2);
+            Misbehaving(nodeId, 2);
         }
 
         //check signature
         if(!pCdMan->pAccountCache->GetAccount(msg.miner, account)) {
             LogPrint(BCLog::INFO, "the miner=%s of msg is not found! Misbehavior add %d, msg_block=%s\n",
                 msg.miner.ToString(), 10, msg.GetBlockId());
-            Misbehaving(pFrom->GetId(), 10);
+            Misbehaving(nodeId, 10);
             return false;
         }
     }
+    return true;
+}
+
+bool CPBFTMan::CheckPBFTMessage(CNode *pFrom, const int32_t msgType ,const CPBFTMessage& msg) {
+
+    CAccount account;
+    if (!CheckPBFTMessageState(pFrom->GetId(), msgType, msg, account))
+        return false;
+
     uint256 messageHash = msg.GetHash();
     if (!VerifySignature(messageHash, msg.vSignature, account.owner_pubkey)) {
         if (!VerifySignature(messageHash, msg.vSignature, account.miner_pubkey)) {
@@ -460,6 +536,56 @@ bool CPBFTMan::CheckPBFTMessage(CNode *pFrom, const int32_t msgType ,const CPBFT
 
 }
 
+template <typename MsgType>
+void CPBFTMan::CheckPBFTMessages(const int32_t msgType, CPBFTMessageMan<MsgType>& msgMan,
+                                 vector<pair<NodeId, MsgType>>& msgs) {
+
+    vector<pair<NodeId, MsgType>> checkedMsgs;
+    vector<CAccount> accounts;
+    {
+        // The same msg relayed by several peers is checked once. It is keyed on the signed content and the
+        // signature, as MsgType::operator< ignores parts of both: a forged copy must not shadow the real one.
+        set<pair<uint256, vector<unsigned char>>> msgsSeen;
+        LOCK(cs_main);
+        for (const auto &item : msgs) {
+            if (msgMan.IsKnown(item.second) ||
+                !msgsSeen.emplace(item.second.GetHash(), item.second.vSignature).second)
+                continue;
+
+            CAccount account;
+            if (!CheckPBFTMessageState(item.first, msgType, item.second, account))
+                continue;
+
+            checkedMsgs.push_back(item);
+            accounts.push_back(account);
+        }
+    }
+
+    // the signatures are mostly made with the owner keys, verify them in one batch
+    vector<uint256> hashes;
+    vector<CSignatureCheck> checks;
+    hashes.reserve(checkedMsgs.size());
+    checks.reserve(checkedMsgs.size());
+    for (size_t i = 0; i < checkedMsgs.size(); i++) {
+        hashes.push_back(checkedMsgs[i].second.GetHash());
+        checks.emplace_back(hashes[i], checkedMsgs[i].second.vSignature, accounts[i].owner_pubkey);
+    }
+    vector<uint8_t> results;
+    VerifySignatures(checks, results);
+
+    msgs.clear();
+    for (size_t i = 0; i < checkedMsgs.size(); i++) {
+        const MsgType &msg = checkedMsgs[i].second;
+        if (!results[i] && !VerifySignature(hashes[i], msg.vSignature, accounts[i].miner_pubkey)) {
+            LogPrint(BCLog::INFO, "verify signature error! Misbehavior add %d, miner=%s, msg_block=%s\n",
+                10, msg.miner.ToString(), msg.GetBlockId());
+            Misbehaving(checkedMsgs[i].first, 10);
+            continue;
+        }
+        msgs.push_back(checkedMsgs[i]);
+    }
+}
+
 bool CPBFTMan::IsBlockReversible(HeightType height, const uint256 &hash) {
     LOCK(cs_finblock);
     return !global_fin_index || height > (uint32_t)global_fin_index->height;
@@ -511,3 +637,77 @@ bool RelayBlockFinalityMessage(const CBlockFinalityMessage& msg){
     }
     return true;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// class CPBFTMessageQueue
+
+bool CPBFTMessageQueue::Push(NodeId nodeId, const CBlockConfirmMessage& msg) {
+    if (!fRunning)
+        return false;
+
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (confirmMsgs.size() + finalityMsgs.size() >= MAX_QUEUED_MSGS)
+            return false;
+
+        confirmMsgs.emplace_back(nodeId, msg);
+    }
+    condWork.notify_one();
+    return true;
+}
+
+bool CPBFTMessageQueue::Push(NodeId nodeId, const CBlockFinalityMessage& msg) {
+    if (!fRunning)
+        return false;
+
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (confirmMsgs.size() + finalityMsgs.size() >= MAX_QUEUED_MSGS)
+            return false;
+
+        finalityMsgs.emplace_back(nodeId, msg);
+    }
+    condWork.notify_one();
+    return true;
+}
+
+void CPBFTMessageQueue::Take(PBFTConfirmList& confirms, PBFTFinalityList& finalities) {
+    boost::unique_lock<boost::mutex> lock(cs);
+    while (confirmMsgs.empty() && finalityMsgs.empty())
+        condWork.wait(lock);
+
+    confirms.clear();
+    finalities.clear();
+    confirms.swap(confirmMsgs);
+    finalities.swap(finalityMsgs);
+}
+
+size_t CPBFTMessageQueue::Size() {
+    boost::unique_lock<boost::mutex> lock(cs);
+    return confirmMsgs.size() + finalityMsgs.size();
+}
+
+void ThreadPBFTIntake() {
+    pbftMessageQueue.SetRunning(true);
+
+    try {
+        PBFTConfirmList confirms;
+        PBFTFinalityList finalities;
+        while (true) {
+            pbftMessageQueue.Take(confirms, finalities);
+
+            try {
+                if (!confirms.empty())
+                    pbftMan.ProcessBlockConfirmMessages(confirms);
+
+                if (!finalities.empty())
+                    pbftMan.ProcessBlockFinalityMessages(finalities);
+            } catch (std::exception &e) {
+                PrintExceptionContinue(&e, "pbft");
+            }
+        }
+    } catch (const boost::thread_interrupted &) {
+        pbftMessageQueue.SetRunning(false);
+        throw;
+    }
+}
@@ -9,10 +9,20 @@
 
 #include "chain/chain.h"
 #include "miner/pbftcontext.h"
+#include "p2p/protocol.h"
 
-class CBlockConfirmMessage;
-class CBlockFinalityMessage;
-class CPBFTMessage;
+#include <atomic>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CAccount;
+
+typedef int32_t NodeId;
+
+// pbft messages paired with the peer they came from
+typedef vector<pair<NodeId, CBlockConfirmMessage>> PBFTConfirmList;
+typedef vector<pair<NodeId, CBlockFinalityMessage>> PBFTFinalityList;
 
 class CPBFTMan {
 
@@ -22,10 +32,22 @@ private:
     CPBFTMessageMan<CBlockConfirmMessage> confirmMessageMan;
     CPBFTMessageMan<CBlockFinalityMessage> finalityMessageMan;
     CCriticalSection cs_finblock;
+    // the active delegates as of activeDelegatesTipHash, guarded by cs_main
+    ActiveDelegatesStore activeDelegatesCache;
+    uint256 activeDelegatesTipHash;
+    bool fActiveDelegatesCached = false;
+    const ActiveDelegatesStore* GetActiveDelegatesStore();
     bool SaveGlobalFinBlock(CBlockIndex *pNewIndex);
     CBlockIndex* GetNewLocalFinIndex(const CBlockConfirmMessage& msg);
     CBlockIndex* GetNewGlobalFinIndex(const CBlockFinalityMessage& msg);
+    bool CheckPBFTMessageState(NodeId nodeId, const int32_t msgType, const CPBFTMessage& msg, CAccount& account);
     bool CheckPBFTMessage(CNode *pFrom, const int32_t msgType ,const CPBFTMessage& msg);
+    // keep the messages which are new and valid, their signatures verified in one batch
+    template <typename MsgType>
+    void CheckPBFTMessages(const int32_t msgType, CPBFTMessageMan<MsgType>& msgMan, vector<pair<NodeId, MsgType>>& msgs);
+    // insert a checked message and move the fin block forward, requires cs_main
+    bool AcceptBlockConfirmMessage(const CBlockConfirmMessage& msg, bool &fNewFin);
+    bool AcceptBlockFinalityMessage(const CBlockFinalityMessage& msg);
 public:
     void InitFinIndex(CBlockIndex *globalFinIndex);
     void ClearFinIndex();
@@ -36,6 +58,9 @@ public:
     bool UpdateGlobalFinBlock(CBlockIndex* pIndex);
     bool ProcessBlockConfirmMessage(CNode *pFrom, const CBlockConfirmMessage& msg);
     bool ProcessBlockFinalityMessage(CNode *pFrom, const CBlockFinalityMessage& msg);
+    // the messages of a batch or of a queue drain, msgs is left with the accepted ones
+    bool ProcessBlockConfirmMessages(PBFTConfirmList& msgs);
+    bool ProcessBlockFinalityMessages(PBFTFinalityList& msgs);
 
     bool BroadcastBlockConfirm(const CBlockIndex* pTipIndex);
     bool BroadcastBlockFinality(const CBlockIndex* pTipIndex);
@@ -48,6 +73,42 @@ public:
     void AfterDisconnectTip(CBlockIndex* pTipIndex);
 };
 
+/**
+ * The pbft messages handed over by the message handler to the "pbft" thread. The thread takes all the
+ * queued messages at once and checks them together: the state checks under one cs_main hold, the
+ * signatures in one batch on the sigcheck workers with no lock held, then only the accepted messages
+ * take cs_main again to update the confirms and the fin blocks.
+ */
+class CPBFTMessageQueue {
+public:
+    static const size_t MAX_QUEUED_MSGS = 10000;
+
+    CPBFTMessageQueue() : fRunning(false) {}
+
+    /** Returns false if the thread is not running or the queue is full, the caller processes the msg itself then. */
+    bool Push(NodeId nodeId, const CBlockConfirmMessage& msg);
+    bool Push(NodeId nodeId, const CBlockFinalityMessage& msg);
+
+    /** Wait for messages and take all of them. */
+    void Take(PBFTConfirmList& confirms, PBFTFinalityList& finalities);
+
+    void SetRunning(bool fRunningIn) { fRunning = fRunningIn; }
+    size_t Size();
+
+private:
+    boost::mutex cs;  // guards the fields below
+    boost::condition_variable condWork;
+    PBFTConfirmList confirmMsgs;
+    PBFTFinalityList finalityMsgs;
+
+    std::atomic<bool> fRunning;
+};
+
+extern CPBFTMessageQueue pbftMessageQueue;
+
+/** Body of the "pbft" thread. */
+void ThreadPBFTIntake();
+
 bool RelayBlockConfirmMessage(const CBlockConfirmMessage& msg);
 
 bool RelayBlockFinalityMessage(const CBlockFinalityMessage& msg);
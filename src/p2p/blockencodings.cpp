@@ -0,0 +1,149 @@
+// Copyright (c) 2016-2018 The Bitcoin Core developers
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockencodings.h"
+
+#include "commons/random.h"
+#include "crypto/hash.h"
+#include "crypto/siphash.h"
+#include "tx/txmempool.h"
+#include "tx/txserializer.h"
+
+#include <limits>
+#include <set>
+#include <unordered_map>
+
+// No serialized tx is smaller than this, it bounds the tx count of a compact block
+static const size_t MIN_SERIALIZED_TX_SIZE = 10;
+
+// Transactions which are made by the block producer and never enter a mempool
+static bool IsPrefilledTx(const std::shared_ptr<CBaseTx> &pTx) {
+    return pTx->IsBlockRewardTx() || pTx->IsPriceMedianTx() || pTx->IsCoinMintTx();
+}
+
+CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock &block)
+    : header(block), nonce(GetRand(std::numeric_limits<uint64_t>::max())) {
+    FillShortTxIDSelector();
+
+    int32_t lastPrefilled = -1;
+    for (size_t i = 0; i < block.vptx.size(); i++) {
+        const auto &pTx = block.vptx[i];
+        if (i == 0 || IsPrefilledTx(pTx)) {
+            prefilledTxs.push_back({(uint32_t)(i - lastPrefilled - 1), pTx});
+            lastPrefilled = i;
+        } else {
+            shortTxIds.push_back(GetShortID(pTx->GetHash()));
+        }
+    }
+}
+
+void CBlockHeaderAndShortTxIDs::FillShortTxIDSelector() {
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << header.GetHash() << nonce;
+    uint256 hash = ss.GetHash();
+    shortIdK0    = hash.GetUint64(0);
+    shortIdK1    = hash.GetUint64(1);
+}
+
+uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256 &txid) const {
+    return SipHashUint256(shortIdK0, shortIdK1, txid) & 0xFFFFFFFFFFFFULL;
+}
+
+CBlockTransactions::CBlockTransactions(const CBlock &block, const CBlockTransactionsRequest &req)
+    : blockHash(req.blockHash) {
+    for (auto index : req.indexes) {
+        if (index >= block.vptx.size())
+            break;
+
+        vptx.push_back(block.vptx[index]);
+    }
+}
+
+CPartiallyDownloadedBlock::ReadStatus CPartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs &cmpctBlock,
+                                                                          const CTxMemPool &pool) {
+    size_t txCount = cmpctBlock.BlockTxCount();
+    if (txCount == 0 || txCount > MAX_BLOCK_SIZE / MIN_SERIALIZED_TX_SIZE)
+        return READ_INVALID;
+
+    header = cmpctBlock.header;
+    vptx.assign(txCount, nullptr);
+
+    int64_t lastPrefilled = -1;
+    for (const auto &prefilled : cmpctBlock.prefilledTxs) {
+        lastPrefilled += (int64_t)prefilled.index + 1;
+        if (lastPrefilled >= (int64_t)txCount || !prefilled.pTx)
+            return READ_INVALID;
+
+        vptx[lastPrefilled] = prefilled.pTx;
+    }
+
+    // Position of each short id in the block, skipping the prefilled slots
+    std::unordered_map<uint64_t, uint32_t> mapShortIds;
+    mapShortIds.reserve(cmpctBlock.shortTxIds.size());
+    uint32_t index = 0;
+    for (const auto &shortId : cmpctBlock.shortTxIds) {
+        while (vptx[index])
+            index++;
+
+        if (!mapShortIds.emplace(shortId.id, index++).second)
+            return READ_FAILED;  // two txs of the block share a short id
+    }
+
+    std::set<uint32_t> setCollided;
+    {
+        LOCK(pool.cs);
+        for (const auto &item : pool.memPoolTxs) {
+            auto it = mapShortIds.find(cmpctBlock.GetShortID(item.first));
+            if (it == mapShortIds.end() || setCollided.count(it->second))
+                continue;
+
+            if (vptx[it->second]) {
+                // two mempool txs match the short id, let the peer send the right one
+                vptx[it->second].reset();
+                setCollided.insert(it->second);
+            } else {
+                vptx[it->second] = item.second.GetTransaction();
+            }
+        }
+    }
+
+    return READ_OK;
+}
+
+vector<uint32_t> CPartiallyDownloadedBlock::GetMissingIndexes() const {
+    vector<uint32_t> indexes;
+    for (uint32_t i = 0; i < vptx.size(); i++) {
+        if (!vptx[i])
+            indexes.push_back(i);
+    }
+
+    return indexes;
+}
+
+CPartiallyDownloadedBlock::ReadStatus CPartiallyDownloadedBlock::FillBlock(
+    CBlock &block, const vector<std::shared_ptr<CBaseTx>> &vMissingTx) const {
+    block = CBlock(header);
+    block.vptx = vptx;
+
+    size_t next = 0;
+    for (auto &pTx : block.vptx) {
+        if (pTx)
+            continue;
+
+        if (next >= vMissingTx.size() || !vMissingTx[next])
+            return READ_INVALID;
+
+        pTx = vMissingTx[next++];
+    }
+
+    if (next != vMissingTx.size())
+        return READ_INVALID;
+
+    // A short id collision with a mempool tx gives a different merkle root
+    if (block.BuildMerkleTree() != header.GetMerkleRootHash())
+        return READ_FAILED;
+
+    return READ_OK;
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2016-2018 The Bitcoin Core developers
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_BLOCKENCODINGS_H
+#define P2P_BLOCKENCODINGS_H
+
+#include "persistence/block.h"
+
+#include <memory>
+#include <vector>
+
+class CTxMemPool;
+
+/** Version of the compact block encoding, sent in "sendcmpct" */
+static const uint64_t CMPCT_BLOCK_VERSION = 1;
+
+/** A short transaction id: the low 48 bits of SipHash-2-4 of the txid, keyed per block */
+struct CShortTxId {
+    uint64_t id;
+
+    CShortTxId() : id(0) {}
+    CShortTxId(uint64_t idIn) : id(idIn) {}
+
+    IMPLEMENT_SERIALIZE(
+        uint32_t lsb = id & 0xFFFFFFFF;
+        uint16_t msb = (id >> 32) & 0xFFFF;
+        READWRITE(lsb);
+        READWRITE(msb);
+        if (fRead)
+            const_cast<CShortTxId *>(this)->id = ((uint64_t)msb << 32) | lsb;
+    )
+};
+
+/** A transaction sent in full inside a compact block */
+struct CPrefilledTx {
+    uint32_t index;  // differentially encoded against the previous prefilled tx
+    std::shared_ptr<CBaseTx> pTx;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(VARINT(index));
+        READWRITE(pTx);
+    )
+};
+
+/** A block announced with its header and the short ids of its transactions, the receiver rebuilds it
+ *  from its mempool. Transactions which never enter a mempool (block reward, price median) are prefilled. */
+class CBlockHeaderAndShortTxIDs {
+public:
+    CBlockHeader header;
+    uint64_t nonce;
+    vector<CShortTxId> shortTxIds;
+    vector<CPrefilledTx> prefilledTxs;
+
+    CBlockHeaderAndShortTxIDs() : nonce(0), shortIdK0(0), shortIdK1(0) {}
+    explicit CBlockHeaderAndShortTxIDs(const CBlock &block);
+
+    uint64_t GetShortID(const uint256 &txid) const;
+    size_t BlockTxCount() const { return shortTxIds.size() + prefilledTxs.size(); }
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(header);
+        READWRITE(nonce);
+        READWRITE(shortTxIds);
+        READWRITE(prefilledTxs);
+        if (fRead)
+            const_cast<CBlockHeaderAndShortTxIDs *>(this)->FillShortTxIDSelector();
+    )
+
+private:
+    uint64_t shortIdK0;
+    uint64_t shortIdK1;
+
+    void FillShortTxIDSelector();
+};
+
+/** Transactions of a compact block which the receiver could not find in its mempool */
+class CBlockTransactionsRequest {
+public:
+    uint256 blockHash;
+    vector<uint32_t> indexes;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(indexes);
+    )
+};
+
+/** Reply to a CBlockTransactionsRequest */
+class CBlockTransactions {
+public:
+    uint256 blockHash;
+    vector<std::shared_ptr<CBaseTx>> vptx;
+
+    CBlockTransactions() {}
+    CBlockTransactions(const CBlock &block, const CBlockTransactionsRequest &req);
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(vptx);
+    )
+};
+
+/** A block being rebuilt from a compact block, the mempool and the missing transactions */
+class CPartiallyDownloadedBlock {
+public:
+    enum ReadStatus {
+        READ_OK,
+        READ_INVALID,  // the peer sent malformed data
+        READ_FAILED,   // short id collision or mismatch, fall back to the whole block
+    };
+
+    ReadStatus InitData(const CBlockHeaderAndShortTxIDs &cmpctBlock, const CTxMemPool &pool);
+    vector<uint32_t> GetMissingIndexes() const;
+    ReadStatus FillBlock(CBlock &block, const vector<std::shared_ptr<CBaseTx>> &vMissingTx) const;
+
+    const CBlockHeader &GetHeader() const { return header; }
+
+private:
+    CBlockHeader header;
+    vector<std::shared_ptr<CBaseTx>> vptx;
+};
+
+#endif  // P2P_BLOCKENCODINGS_H
@@ -11,7 +11,12 @@
 #include "node.h"
 #include "miner/pbftcontext.h"
 #include "miner/pbftmanager.h"
+#include "miner/miner.h"
+#include "chain/orphanpool.h"
+#include "sigcheckqueue.h"
+#include "txadmissionqueue.h"
 
+#include <algorithm>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -29,6 +34,52 @@ extern map<uint256, tuple<NodeId, list<uint256>::iterator, int64_t>> mapBlocksTo
 // them, if processing happens afterwards. Protected by cs_main.
 map<uint256, NodeId> mapBlockSource;  // Remember who we got this block from.
 
+// Headers-first sync: hashes of the best known header chain above the active tip, keyed by height.
+// Protected by cs_main.
+map<int32_t, uint256> mapHeaderChain;
+// The lowest height of the header chain whose block may still need to be scheduled for download, the blocks
+// below it are known, queued or in flight. Requires cs_mapNodeState.
+static int32_t nBlockScheduleHeight   = 0;
+static int64_t nBlockScheduleScanTime = 0;
+// The peer that extends the header chain, and whether it has more headers than we requested so far.
+// Protected by cs_main.
+NodeId nHeadersSyncPeer = -1;
+bool fHeadersSyncMore   = false;
+// The peers gone since the message handler last took cs_main. FinalizeNode() runs on the socket thread, which must
+// not wait for cs_main, so the header sync they held is released by ReleaseGonePeers() instead.
+static CCriticalSection cs_gonePeers;
+static vector<NodeId> vGonePeers;
+
+// Blocks that passed CheckBlock() in the message handler and wait for ThreadBlockConnect(), so that
+// deserializing and checking the next blocks overlaps with ConnectBlock() of the current one.
+struct CCheckedBlock {
+    std::shared_ptr<CBlock> pBlock;
+    CNode *pFrom;
+};
+static boost::mutex cs_checkedBlocks;
+static boost::condition_variable condCheckedBlocks;
+static deque<CCheckedBlock> queueCheckedBlocks;
+static set<uint256> setCheckedBlocks;  // blocks in queueCheckedBlocks or being connected
+
+// Compact blocks waiting for the transactions requested with "getblocktxn", keyed by block hash and the peer they
+// came from, so that a peer only ever displaces its own entries.
+typedef std::pair<uint256, NodeId> PartialBlockKey;
+static CCriticalSection cs_partialBlocks;
+static map<PartialBlockKey, std::shared_ptr<CPartiallyDownloadedBlock>> mapPartialBlocks;
+static deque<PartialBlockKey> queuePartialBlocks;  // keys of mapPartialBlocks in insertion order, oldest first
+static map<NodeId, uint32_t> mapPartialBlocksPerPeer;
+
+// Requires cs_partialBlocks.
+static void ErasePartialBlock(deque<PartialBlockKey>::iterator itQueue) {
+    AssertLockHeld(cs_partialBlocks);
+    mapPartialBlocks.erase(*itQueue);
+    auto itCount = mapPartialBlocksPerPeer.find(itQueue->second);
+    if (itCount != mapPartialBlocksPerPeer.end() && --itCount->second == 0)
+        mapPartialBlocksPerPeer.erase(itCount);
+
+    queuePartialBlocks.erase(itQueue);
+}
+
 // Requires cs_mapNodeState.
 void MarkBlockAsReceived(const uint256 &hash, NodeId nodeFrom/* = -1 */) {
     AssertLockHeld(cs_mapNodeState);
@@ -102,7 +153,8 @@ void ProcessGetData(CNode *pFrom) {
                         LogPrint(BCLog::NET, "send block[%u]: %s to peer %s\n", block.GetHeight(), block.GetHash().GetHex(),
                                  pFrom->addr.ToString());
 
-                        pFrom->PushMessage(NetMsgType::BLOCK, block);
+                        std::unique_ptr<CCompressedBlock> pCompressed;
+                        PushBlockMessage(pFrom, block, pCompressed);
 
                     } else  {// MSG_FILTERED_BLOCK)
                         LOCK(pFrom->cs_filter);
@@ -116,7 +168,7 @@ void ProcessGetData(CNode *pFrom) {
                             // protocol spec specified allows for us to provide duplicate txn here, however we MUST
                             // always provide at least what the remote peer needs
                             for (auto &pair : merkleBlock.vMatchedTxn)
-                                if (!pFrom->setInventoryKnown.count(CInv(MSG_TX, pair.second)))
+                                if (!pFrom->setInventoryKnown.count(pair.second))
                                     pFrom->PushMessage(NetMsgType::TX, block.vptx[pair.first]);
                         }
                         // else
@@ -183,11 +235,11 @@ void ProcessGetData(CNode *pFrom) {
 bool AlreadyHave(const CInv &inv) {
     switch (inv.type) {
         case MSG_TX: {
-            return mempool.Exists(inv.hash);
+            return mempool.Exists(inv.hash) || orphanTxs.Exists(inv.hash);
         }
 
         case MSG_BLOCK: {
-            return mapBlockIndex.count(inv.hash) || mapOrphanBlocks.count(inv.hash);
+            return mapBlockIndex.count(inv.hash) || orphanBlocks.Exists(inv.hash) || IsBlockPendingConnect(inv.hash);
         }
     }
 
@@ -238,6 +290,221 @@ bool AddBlockToQueue(const uint256 &hash, NodeId nodeId) {
     return true;
 }
 
+// Requires cs_main.
+void PushGetHeaders(CNode *pNode, const CBlockLocator &locator, const uint256 &hashEnd) {
+    AssertLockHeld(cs_main);
+    nHeadersSyncPeer = pNode->GetId();
+    pNode->PushMessage(NetMsgType::GETHEADERS, locator, hashEnd);
+    LogPrint(BCLog::NET, "getheaders from peer %s, hashEnd:%s\n", pNode->addr.ToString(), hashEnd.GetHex());
+}
+
+void PushBlockMessage(CNode *pNode, const CBlock &block, std::unique_ptr<CCompressedBlock> &pCompressed) {
+    if (pNode->nServices & NODE_COMPRESSED_BLOCKS) {
+        if (!pCompressed)
+            pCompressed.reset(new CCompressedBlock(block, SER_NETWORK, PROTOCOL_VERSION));
+
+        if (pCompressed->IsSmaller()) {
+            pNode->PushMessage(NetMsgType::ZBLOCK, *pCompressed);
+            return;
+        }
+    }
+
+    pNode->PushMessage(NetMsgType::BLOCK, block);
+}
+
+void PushCompactBlock(CNode *pNode, const CBlock &block, std::unique_ptr<CBlockHeaderAndShortTxIDs> &pCmpctBlock) {
+    CInv inv(MSG_BLOCK, block.GetHash());
+    {
+        LOCK(pNode->cs_inventory);
+        if (!pNode->setInventoryKnown.insert(inv.hash))
+            return;
+    }
+
+    if (!pCmpctBlock)
+        pCmpctBlock.reset(new CBlockHeaderAndShortTxIDs(block));
+
+    pNode->PushMessage(NetMsgType::CMPCTBLOCK, *pCmpctBlock);
+}
+
+// Requires cs_main.
+void ScheduleBlockDownload(CNode *pTo) {
+    AssertLockHeld(cs_main);
+    int32_t tipHeight = chainActive.Height();
+
+    // Drop the headers which the active chain has caught up with
+    mapHeaderChain.erase(mapHeaderChain.begin(), mapHeaderChain.upper_bound(tipHeight));
+    int32_t bestHeaderHeight = mapHeaderChain.empty() ? tipHeight : mapHeaderChain.rbegin()->first;
+
+    int32_t peerHeight = 0;
+    {
+        LOCK(cs_mapNodeState);
+        CNodeState *state = State(pTo->GetId());
+        if (state == nullptr)
+            return;
+
+        peerHeight = max(pTo->nStartingHeight, state->nBestHeaderHeight);
+    }
+
+    // Ask for the next batch of headers once the download window gets close to the end of the header chain.
+    // Without a sync peer, because it went away or its headers were dropped, a peer which is ahead takes the
+    // header sync over once the active chain has caught up with the header chain.
+    if (fHeadersSyncMore && pTo->GetId() == nHeadersSyncPeer && bestHeaderHeight - tipHeight < MAX_HEADERS_AHEAD / 2) {
+        fHeadersSyncMore = false;
+        PushGetHeaders(pTo, CBlockLocator({mapHeaderChain.rbegin()->second}), uint256());
+    } else if (nHeadersSyncPeer < 0 && mapHeaderChain.empty() && peerHeight > tipHeight) {
+        LogPrint(BCLog::NET, "take over header sync, peer_height=%d, tip_height=%d, peer=%s\n", peerHeight, tipHeight,
+                 pTo->addrName);
+        PushGetHeaders(pTo, chainActive.GetLocator(chainActive.Tip()), uint256());
+    }
+
+    if (mapHeaderChain.empty())
+        return;
+
+    LOCK(cs_mapNodeState);
+    CNodeState *state = State(pTo->GetId());
+    if (state == nullptr || state->nBlocksToDownload + state->nBlocksInFlight >= MAX_BLOCKS_IN_TRANSIT_PER_PEER)
+        return;
+
+    // Scan from the schedule cursor rather than from the tip on every call, and from the tip again now and
+    // then for the blocks which were given up on a path that did not move the cursor back.
+    int64_t now = GetTime();
+    if (now - nBlockScheduleScanTime >= BLOCK_SCHEDULE_RESCAN_INTERVAL) {
+        nBlockScheduleScanTime = now;
+        nBlockScheduleHeight   = 0;
+    }
+
+    bool fAdvance     = true;  // whether all the blocks from the cursor on are taken care of so far
+    int32_t endHeight = min(min(bestHeaderHeight, peerHeight), tipHeight + BLOCK_DOWNLOAD_WINDOW);
+    for (auto it = mapHeaderChain.lower_bound(max(nBlockScheduleHeight, tipHeight + 1));
+         it != mapHeaderChain.end() && it->first <= endHeight; ++it) {
+        const uint256 &hash = it->second;
+        if (!mapBlockIndex.count(hash) && !orphanBlocks.Exists(hash) && !mapBlocksToDownload.count(hash) &&
+            !mapBlocksInFlight.count(hash) && !IsBlockPendingConnect(hash)) {
+            if (state->nBlocksToDownload + state->nBlocksInFlight >= MAX_BLOCKS_IN_TRANSIT_PER_PEER)
+                break;
+
+            if (!AddBlockToQueue(hash, pTo->GetId()))
+                fAdvance = false;
+        }
+
+        if (fAdvance)
+            nBlockScheduleHeight = it->first + 1;
+    }
+}
+
+// Requires cs_mapNodeState.
+void RescheduleBlockDownload(int32_t height) {
+    AssertLockHeld(cs_mapNodeState);
+    nBlockScheduleHeight = min(nBlockScheduleHeight, height);
+}
+
+// Requires cs_main.
+bool IsBlockInHeaderChain(int32_t height, const uint256 &hash) {
+    AssertLockHeld(cs_main);
+    auto it = mapHeaderChain.find(height);
+    return it != mapHeaderChain.end() && it->second == hash;
+}
+
+void ReleaseHeadersSyncPeer(NodeId nodeId) {
+    LOCK(cs_gonePeers);
+    vGonePeers.push_back(nodeId);
+}
+
+// Requires cs_main.
+void ReleaseGonePeers() {
+    AssertLockHeld(cs_main);
+    vector<NodeId> vNodeIds;
+    {
+        LOCK(cs_gonePeers);
+        vNodeIds.swap(vGonePeers);
+    }
+
+    for (NodeId nodeId : vNodeIds) {
+        if (nHeadersSyncPeer == nodeId) {
+            nHeadersSyncPeer = -1;
+            fHeadersSyncMore = false;
+        }
+    }
+}
+
+void ReleasePartialBlocks(NodeId nodeId) {
+    LOCK(cs_partialBlocks);
+    if (!mapPartialBlocksPerPeer.count(nodeId))
+        return;
+
+    for (auto it = queuePartialBlocks.begin(); it != queuePartialBlocks.end();) {
+        if (it->second == nodeId) {
+            mapPartialBlocks.erase(*it);
+            it = queuePartialBlocks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    mapPartialBlocksPerPeer.erase(nodeId);
+}
+
+// A block failed its checks: punish the peer which sent it and, if the block belongs to the header chain, drop the
+// header chain from its height on. The headers are requested again once the active chain has caught up.
+static void RejectInvalidBlock(NodeId nodeId, const CBlock &block, const CValidationState &state) {
+    AssertLockHeld(cs_main);
+    int32_t nDoS = 0;
+    if (!state.IsInvalid(nDoS))
+        return;
+
+    if (nDoS > 0)
+        Misbehaving(nodeId, nDoS);
+
+    // a duplicate is not a reason to drop anything, it is rejected without a code
+    if (state.GetRejectCode() != 0 && IsBlockInHeaderChain(block.GetHeight(), block.GetHash())) {
+        LogPrint(BCLog::NET, "drop header chain from invalid block [%d]%s, reason=%s, peer=%d\n", block.GetHeight(),
+                 block.GetHash().ToString(), state.GetRejectReason(), nodeId);
+        mapHeaderChain.erase(mapHeaderChain.find(block.GetHeight()), mapHeaderChain.end());
+        nHeadersSyncPeer = -1;
+        fHeadersSyncMore = false;
+    }
+}
+
+bool IsBlockPendingConnect(const uint256 &hash) {
+    boost::unique_lock<boost::mutex> lock(cs_checkedBlocks);
+    return setCheckedBlocks.count(hash) > 0;
+}
+
+void ThreadBlockConnect() {
+    while (true) {
+        CCheckedBlock checkedBlock;
+        {
+            boost::unique_lock<boost::mutex> lock(cs_checkedBlocks);
+            while (queueCheckedBlocks.empty())
+                condCheckedBlocks.wait(lock);
+
+            checkedBlock = queueCheckedBlocks.front();
+            queueCheckedBlocks.pop_front();
+        }
+
+        CBlock &block = *checkedBlock.pBlock;
+        {
+            LOCK(cs_main);
+            CValidationState state;
+            if (!pbftMan.IsBlockReversible(block)) {
+                LogPrint(BCLog::NET, "this inbound block=%s is irrreversible, fin_block=%s\n", block.GetIdStr(),
+                         pbftMan.GetGlobalFinIndex()->GetIdString());
+            } else if (!ProcessBlock(state, checkedBlock.pFrom, &block, nullptr, true)) {
+                RejectInvalidBlock(checkedBlock.pFrom->GetId(), block, state);
+            }
+        }
+
+        {
+            boost::unique_lock<boost::mutex> lock(cs_checkedBlocks);
+            setCheckedBlocks.erase(block.GetHash());
+        }
+
+        {
+            LOCK(cs_vNodes);
+            checkedBlock.pFrom->Release();
+        }
+    }
+}
+
 int32_t ProcessVersionMessage(CNode *pFrom, string strCommand, CDataStream &vRecv) {
     // Each connection can only send one version message
     if (pFrom->nVersion != 0) {
@@ -302,6 +569,13 @@ int32_t ProcessVersionMessage(CNode *pFrom, string strCommand, CDataStream &vRec
     pFrom->PushMessage(NetMsgType::VERACK);
     pFrom->ssSend.SetVersion(min(pFrom->nVersion, PROTOCOL_VERSION));
 
+    // Ask for new blocks to be announced as compact blocks, older peers ignore it
+    pFrom->PushMessage(NetMsgType::SENDCMPCT, true, CMPCT_BLOCK_VERSION);
+
+    // Ask for the pbft messages of a block to be batched, older peers ignore it
+    if (SysCfg().GetBoolArg("-pbftbatch", DEFAULT_PBFT_BATCH))
+        pFrom->PushMessage(NetMsgType::SENDPBFTBATCH, PBFT_BATCH_VERSION);
+
     if (!pFrom->fInbound) {
         // Advertise our address
         if (!fNoListen && !IsInitialBlockDownload()) {
@@ -461,6 +735,47 @@ bool ProcessAddrMessage(CNode *pFrom, CDataStream &vRecv) {
     return true;
 }
 
+// the accept stage of a relayed tx, run in the order the txes came in
+static void AcceptRelayedTx(CNode *pFrom, const string &strCommand, const std::shared_ptr<CBaseTx> &pBaseTx,
+                            CValidationState &state, bool fPreChecked) {
+    CInv inv(MSG_TX, pBaseTx->GetHash());
+    int32_t nDoS = 0;
+    if (fPreChecked) {
+        LOCK(cs_main);
+        // hand the deserialized tx to the pool as is, it is only read from here on
+        if (AcceptToMemoryPool(mempool, state, pBaseTx, true)) {
+            RelayTransaction(pBaseTx.get(), inv.hash);
+            mapAlreadyAskedFor.erase(inv.hash);
+
+            LogPrint(BCLog::NET, "[%d]~ %s %s : accepted %s (poolsz %u)\n", pBaseTx->valid_height, pFrom->addr.ToString(),
+                     pFrom->cleanSubVer, pBaseTx->GetHash().ToString(), mempool.memPoolTxs.size());
+            return;
+        }
+
+        if (state.IsInvalid(nDoS) && state.GetRejectReason() == "account-not-exist" && pBaseTx->txUid.is<CRegID>() &&
+            (int32_t)pBaseTx->txUid.get<CRegID>().GetHeight() > chainActive.Height()) {
+            // signed by a regid registered in a block we do not have yet, wait for it
+            int32_t pendingHeight = pBaseTx->txUid.get<CRegID>().GetHeight();
+            bool fKept = orphanTxs.Add(pBaseTx, pendingHeight);
+            LogPrint(BCLog::NET, "%s orphan tx %s from %s, regid=%s, orphan txs=%u\n", fKept ? "keep" : "abandon",
+                     pBaseTx->GetHash().ToString(), pFrom->addr.ToString(), pBaseTx->txUid.ToString(), orphanTxs.Size());
+            return;
+        }
+    }
+
+    if (state.IsInvalid(nDoS)) {
+        LogPrint(BCLog::NET, "[%d]~ %s from %s %s not accepted into mempool: %s\n",
+                pBaseTx->GetHash().ToString(), pBaseTx->valid_height,
+                pFrom->addr.ToString(), pFrom->cleanSubVer, state.GetRejectReason());
+
+        pFrom->PushMessage(NetMsgType::REJECT, strCommand, state.GetRejectCode(), state.GetRejectReason(), inv.hash);
+        // if (nDoS > 0) {
+        //     LogPrint(BCLog::INFO, "Misebehaving, add to tx hash %s mempool error, Misbehavior add %d",
+        //     pBaseTx->GetHash().GetHex(), nDoS); Misbehaving(pFrom->GetId(), nDoS);
+        // }
+    }
+}
+
 bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv) {
     std::shared_ptr<CBaseTx> pBaseTx;
     try {
@@ -483,27 +798,32 @@ bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv) {
         return true;
     }
 
-    LOCK(cs_main);
-    CValidationState state;
-    if (AcceptToMemoryPool(mempool, state, pBaseTx.get(), true)) {
-        RelayTransaction(pBaseTx.get(), inv.hash);
-        mapAlreadyAskedFor.erase(inv);
-
-        LogPrint(BCLog::NET, "[%d]~ %s %s : accepted %s (poolsz %u)\n", pBaseTx->valid_height, pFrom->addr.ToString(),
-                 pFrom->cleanSubVer, pBaseTx->GetHash().ToString(), mempool.memPoolTxs.size());
+    // the stateless checks run on the tx admission workers, only accepting the tx into the pool takes cs_main
+    auto spState = std::make_shared<CValidationState>();
+    auto spPreChecked = std::make_shared<bool>(false);
+    CTxAdmissionQueue::Stage check = [pBaseTx, spState, spPreChecked]() {
+        *spPreChecked = PreCheckTxForMemPool(mempool, *spState, pBaseTx.get());
+    };
+    {
+        LOCK(cs_vNodes);
+        pFrom->AddRef();
     }
-
-    int32_t nDoS = 0;
-    if (state.IsInvalid(nDoS)) {
-        LogPrint(BCLog::NET, "[%d]~ %s from %s %s not accepted into mempool: %s\n",
-                pBaseTx->GetHash().ToString(), pBaseTx->valid_height,
-                pFrom->addr.ToString(), pFrom->cleanSubVer, state.GetRejectReason());
-
-        pFrom->PushMessage(NetMsgType::REJECT, strCommand, state.GetRejectCode(), state.GetRejectReason(), inv.hash);
-        // if (nDoS > 0) {
-        //     LogPrint(BCLog::INFO, "Misebehaving, add to tx hash %s mempool error, Misbehavior add %d",
-        //     pBaseTx->GetHash().GetHex(), nDoS); Misbehaving(pFrom->GetId(), nDoS);
-        // }
+    CTxAdmissionQueue::Stage accept = [pFrom, pBaseTx, strCommand, spState, spPreChecked]() {
+        AcceptRelayedTx(pFrom, strCommand, pBaseTx, *spState, *spPreChecked);
+        LOCK(cs_vNodes);
+        pFrom->Release();
+    };
+
+    if (txAdmissionQueue.GetWorkerCount() == 0) {
+        // no admission workers, so no tx is queued ahead of this one
+        check();
+        accept();
+    } else if (!txAdmissionQueue.Push(std::move(check), std::move(accept))) {
+        // accepting it here would jump ahead of the queued txes, drop it instead
+        LogPrint(BCLog::NET, "tx admission queue full, drop tx %s from peer %s\n", inv.hash.ToString(),
+                 pFrom->addr.ToString());
+        LOCK(cs_vNodes);
+        pFrom->Release();
     }
 
     return true;
@@ -519,7 +839,7 @@ bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
     CBlockIndex *pIndex = nullptr;
     if (locator.IsNull()) {
         // If locator is null, return the hashStop block
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hashStop);
+        CBlockIndexMap::iterator mi = mapBlockIndex.find(hashStop);
         if (mi == mapBlockIndex.end())
             return true;
 
@@ -533,7 +853,7 @@ bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
 
     // We must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
     vector<CBlock> vHeaders;
-    int32_t nLimit = 2000;
+    int32_t nLimit = MAX_HEADERS_RESULTS;
     LogPrint(BCLog::NET, "getheaders %d to %s from peer %s\n", (pIndex ? pIndex->height : -1), hashStop.ToString(),
              pFrom->addr.ToString());
 
@@ -551,6 +871,216 @@ bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
     return false;
 }
 
+bool ProcessHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
+    // Headers are sent as blocks without transactions, see ProcessGetHeadersMessage()
+    vector<CBlock> vHeaders;
+    vRecv >> vHeaders;
+    if (vHeaders.size() > (size_t)MAX_HEADERS_RESULTS) {
+        Misbehaving(pFrom->GetId(), 20);
+        return ERRORMSG("message headers size() = %u from peer %s", vHeaders.size(), pFrom->addrName);
+    }
+
+    if (vHeaders.empty()) {
+        LOCK(cs_main);
+        if (pFrom->GetId() == nHeadersSyncPeer)
+            fHeadersSyncMore = false;
+
+        return true;
+    }
+
+    for (size_t i = 0; i < vHeaders.size(); i++) {
+        const CBlock &header = vHeaders[i];
+        if (i > 0 && (header.GetPrevBlockHash() != vHeaders[i - 1].GetHash() ||
+                      header.GetHeight() != vHeaders[i - 1].GetHeight() + 1)) {
+            Misbehaving(pFrom->GetId(), 20);
+            return ERRORMSG("non-continuous headers sequence at height %d from peer %s", header.GetHeight(),
+                            pFrom->addrName);
+        }
+
+        if (header.GetBlockTime() > GetAdjustedTime() + ::GetBlockInterval(header.GetHeight()) + 2)
+            return ERRORMSG("header[%d] timestamp too far in the future from peer %s", header.GetHeight(),
+                            pFrom->addrName);
+    }
+
+    // The miner of a header is the delegate of its slot, taken from the delegates as of the active tip like
+    // VerifyRewardTx() does for blocks. They hold up to the next election only, the headers past a failing one
+    // are requested again once the active chain has caught up with them.
+    vector<CPubKey> ownerPubKeys, minerPubKeys;
+    int32_t delegatesHeight = 0;
+    uint256 delegatesTipHash;
+    {
+        LOCK(cs_main);
+        delegatesHeight  = chainActive.Height();
+        delegatesTipHash = chainActive.Tip()->GetBlockHash();
+
+        VoteDelegateVector activeDelegates;
+        if (!pCdMan->pDelegateCache->GetActiveDelegates(activeDelegates) || activeDelegates.empty())
+            return ERRORMSG("get active delegates failed");
+
+        for (const auto &header : vHeaders) {
+            VoteDelegateVector delegates = activeDelegates;
+            ShuffleDelegates(header.GetHeight(), header.GetTime(), delegates);
+
+            VoteDelegate delegate;
+            CAccount account;
+            if (!GetCurrentDelegate(header.GetTime(), header.GetHeight(), delegates, delegate) ||
+                !pCdMan->pAccountCache->GetAccount(delegate.regid, account))
+                break;
+
+            ownerPubKeys.push_back(account.owner_pubkey);
+            minerPubKeys.push_back(account.miner_pubkey);
+        }
+    }
+
+    // Verify the signatures without cs_main, mostly made with the owner keys, and keep the headers up to the
+    // first one failing
+    vector<uint256> hashes;
+    vector<CSignatureCheck> checks;
+    hashes.reserve(ownerPubKeys.size());
+    checks.reserve(ownerPubKeys.size());
+    for (size_t i = 0; i < ownerPubKeys.size(); i++) {
+        hashes.push_back(vHeaders[i].GetHash());
+        checks.emplace_back(hashes[i], vHeaders[i].GetSignature(), ownerPubKeys[i]);
+    }
+    vector<uint8_t> results;
+    VerifySignatures(checks, results);
+
+    size_t nVerified = 0;
+    for (; nVerified < checks.size(); nVerified++) {
+        const auto &signature = vHeaders[nVerified].GetSignature();
+        if (signature.empty() || signature.size() > MAX_SIGNATURE_SIZE)
+            break;
+
+        if (!results[nVerified] && !VerifySignature(hashes[nVerified], signature, minerPubKeys[nVerified]))
+            break;
+    }
+
+    LOCK(cs_main);
+
+    bool fTruncated = nVerified < vHeaders.size();
+    if (fTruncated) {
+        const CBlock &header = vHeaders[nVerified];
+        // the delegates are exact for the block on top of the tip they were read at
+        if ((int32_t)header.GetHeight() == delegatesHeight + 1 && header.GetPrevBlockHash() == delegatesTipHash) {
+            Misbehaving(pFrom->GetId(), 100);
+            return ERRORMSG("header[%d] %s has a bad miner signature, peer %s", header.GetHeight(),
+                            header.GetHash().ToString(), pFrom->addrName);
+        }
+
+        LogPrint(BCLog::NET, "header[%d] %s not verified with the delegates of tip[%d], peer=%s\n", header.GetHeight(),
+                 header.GetHash().ToString(), delegatesHeight, pFrom->addrName);
+        vHeaders.resize(nVerified);
+        if (pFrom->GetId() == nHeadersSyncPeer) {
+            nHeadersSyncPeer = -1;
+            fHeadersSyncMore = false;
+        }
+
+        if (vHeaders.empty())
+            return true;
+    }
+
+    // The first header must connect to the block index or to the header chain
+    uint256 prevHash   = vHeaders.front().GetPrevBlockHash();
+    int32_t prevHeight = -1;
+    auto mi            = mapBlockIndex.find(prevHash);
+    if (mi != mapBlockIndex.end())
+        prevHeight = mi->second->height;
+    else if (IsBlockInHeaderChain(vHeaders.front().GetHeight() - 1, prevHash))
+        prevHeight = vHeaders.front().GetHeight() - 1;
+
+    if (prevHeight < 0) {
+        LogPrint(BCLog::NET, "recv unconnected headers! first_height=%d, prev_hash=%s, peer=%s\n",
+                 vHeaders.front().GetHeight(), prevHash.ToString(), pFrom->addrName);
+        return true;
+    }
+
+    if ((int32_t)vHeaders.front().GetHeight() != prevHeight + 1) {
+        Misbehaving(pFrom->GetId(), 20);
+        return ERRORMSG("header[%d] does not follow its prev block[%d] from peer %s", vHeaders.front().GetHeight(),
+                        prevHeight, pFrom->addrName);
+    }
+
+    // The fork point of the headers with the active chain, a header chain forking off below the global fin block
+    // is rejected like such a block chain is in FindMostWorkChain()
+    int32_t tipHeight  = chainActive.Height();
+    int32_t forkHeight = tipHeight;
+    if (mi != mapBlockIndex.end()) {
+        CBlockIndex *pFork = mi->second;
+        while (pFork && !chainActive.Contains(pFork))
+            pFork = pFork->pprev;
+
+        forkHeight = pFork ? pFork->height : -1;
+        for (const auto &header : vHeaders) {
+            CBlockIndex *pIndex = chainActive[header.GetHeight()];
+            if (pIndex == nullptr || pIndex->GetBlockHash() != header.GetHash())
+                break;
+
+            forkHeight = header.GetHeight();
+        }
+    }
+
+    prevHash   = vHeaders.back().GetHash();
+    prevHeight = vHeaders.back().GetHeight();
+    if (forkHeight < pbftMan.GetGlobalFinIndex()->height) {
+        LogPrint(BCLog::NET, "recv headers forking off at [%d] below the global fin block! last_height=%d, peer=%s\n",
+                 forkHeight, prevHeight, pFrom->addrName);
+        return true;
+    }
+
+    // Same fork choice as for blocks: the higher chain wins and the first seen one keeps a tie. An extension of
+    // the header chain is higher too, a header at an occupied height replaces the entries from that height on.
+    int32_t bestHeaderHeight = mapHeaderChain.empty() ? tipHeight : mapHeaderChain.rbegin()->first;
+    bool fAccepted = prevHeight > bestHeaderHeight || IsBlockInHeaderChain(prevHeight, prevHash);
+    if (fAccepted) {
+        // below the first header the new chain is made of known blocks, which are not downloaded again
+        if (mi != mapBlockIndex.end())
+            mapHeaderChain.erase(mapHeaderChain.begin(), mapHeaderChain.lower_bound(vHeaders.front().GetHeight()));
+
+        for (const auto &header : vHeaders) {
+            int32_t height = header.GetHeight();
+            if (height <= tipHeight)
+                continue;
+
+            uint256 hash = header.GetHash();
+            auto it      = mapHeaderChain.find(height);
+            if (it != mapHeaderChain.end() && it->second != hash)
+                mapHeaderChain.erase(it, mapHeaderChain.end());
+
+            mapHeaderChain[height] = hash;
+        }
+
+        {
+            LOCK(cs_mapNodeState);
+            RescheduleBlockDownload(vHeaders.front().GetHeight());
+            CNodeState *state = State(pFrom->GetId());
+            if (state != nullptr && state->nBestHeaderHeight < prevHeight)
+                state->nBestHeaderHeight = prevHeight;
+        }
+
+        if (prevHeight > nSyncTipHeight)
+            nSyncTipHeight = prevHeight;
+    }
+
+    LogPrint(BCLog::NET, "recv headers! count=%u, last_height=%d, tip_height=%d, header_chain_size=%u, accepted=%d, "
+             "peer=%s\n", vHeaders.size(), prevHeight, tipHeight, mapHeaderChain.size(), fAccepted, pFrom->addrName);
+
+    if (fTruncated || !fAccepted)
+        return true;
+
+    // A full batch means the peer has more, keep requesting while the header chain is short enough
+    fHeadersSyncMore = false;
+    if (vHeaders.size() == (size_t)MAX_HEADERS_RESULTS) {
+        if (prevHeight - tipHeight < MAX_HEADERS_AHEAD) {
+            PushGetHeaders(pFrom, CBlockLocator({prevHash}), uint256());
+        } else {
+            nHeadersSyncPeer = pFrom->GetId();
+            fHeadersSyncMore = true;
+        }
+    }
+
+    return true;
+}
+
 void ProcessGetBlocksMessage(CNode *pFrom, CDataStream &vRecv) {
     CBlockLocator locator;
     uint256 hashStop;
@@ -636,18 +1166,22 @@ bool ProcessInvMessage(CNode *pFrom, CDataStream &vRecv) {
                 LogPrint(BCLog::NET, "recv inv old data! time_ms=%lld, i=%d, msg=%s, hash=%s, peer=%s, found_in=%s, height=%d\n",
                     GetTimeMillis(), i, msgName, inv.ToString(), pFrom->addrName, "BlockIndex", blockIndexIt->second->height);
                 fAlreadyHave = true;
+            } else if (IsBlockPendingConnect(inv.hash)) {
+                LogPrint(BCLog::NET, "recv inv old data! time_ms=%lld, i=%d, msg=%s, hash=%s, peer=%s, found_in=%s\n",
+                    GetTimeMillis(), i, msgName, inv.ToString(), pFrom->addrName, "CheckedBlocks");
+                fAlreadyHave = true;
             } else {
-                auto orphanBlockIt = mapOrphanBlocks.find(inv.hash);
-                if (orphanBlockIt != mapOrphanBlocks.end()) {
+                const COrphanBlock *pOrphanBlock = orphanBlocks.Get(inv.hash);
+                if (pOrphanBlock != nullptr) {
                     LogPrint(BCLog::NET, "recv inv old data! time_ms=%lld, i=%d, msg=%s, hash=%s, peer=%s, found_in=%s, height=%d\n",
-                        GetTimeMillis(), i, msgName, inv.ToString(), pFrom->addrName, "OrphanBlock", orphanBlockIt->second->height);
+                        GetTimeMillis(), i, msgName, inv.ToString(), pFrom->addrName, "OrphanBlock", pOrphanBlock->height);
                     fAlreadyHave = true;
 
                     LogPrint(BCLog::NET, "recv orphan block and lead to getblocks! height=%d, hash=%s, "
                              "tip_height=%d, tip_hash=%s, peer=%s\n",
-                             orphanBlockIt->second->height, inv.hash.GetHex(), chainActive.Height(),
+                             pOrphanBlock->height, inv.hash.GetHex(), chainActive.Height(),
                              chainActive.Tip()->GetBlockHash().GetHex(), pFrom->addrName);
-                    PushGetBlocksOnCondition(pFrom, chainActive.Tip(), GetOrphanRoot(inv.hash));
+                    PushGetBlocksOnCondition(pFrom, chainActive.Tip(), orphanBlocks.GetRoot(inv.hash));
                     // TODO: should get the headmost block of this fork from current peer
                 }
             }
@@ -694,15 +1228,14 @@ bool ProcessGetDataMessage(CNode *pFrom, CDataStream &vRecv) {
     return true;
 }
 
-void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
-    CBlock block;
-    vRecv >> block;
-
+// Check a block received from a peer and queue it for ThreadBlockConnect()
+static void ProcessNewBlock(CNode *pFrom, const std::shared_ptr<CBlock> &pBlock) {
+    uint256 blockHash = pBlock->GetHash();
     LogPrint(BCLog::NET, "recv block! time_ms=%lld, hash=%s, peer=%s\n", GetTimeMillis(),
-        block.GetHash().ToString(), pFrom->addr.ToString());
+        blockHash.ToString(), pFrom->addr.ToString());
     // block.Print();
 
-    CInv inv(MSG_BLOCK, block.GetHash());
+    CInv inv(MSG_BLOCK, blockHash);
     pFrom->AddInventoryKnown(inv);
 
     {
@@ -712,16 +1245,288 @@ void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
         MarkBlockAsReceived(inv.hash, pFrom->GetId());
     }
 
-    LOCK(cs_main);
+    // Context-free checks don't need cs_main, run them here so that they overlap with ThreadBlockConnect()
+    int64_t llBeginCheckBlockTime = GetTimeMillis();
+    CCacheWrapper cw(pCdMan);
     CValidationState state;
+    if (!CheckBlock(*pBlock, state, cw, false)) {
+        LogPrint(BCLog::INFO, "[%d] CheckBlock FAILED: block#%s, peer=%s, elapse time: %lld ms\n", pBlock->GetHeight(),
+                 blockHash.GetHex(), pFrom->addr.ToString(), GetTimeMillis() - llBeginCheckBlockTime);
+        LOCK(cs_main);
+        RejectInvalidBlock(pFrom->GetId(), *pBlock, state);
+        return;
+    }
 
-    if (!pbftMan.IsBlockReversible(block)) {
-        LogPrint(BCLog::NET,"this inbound block=%s is irrreversible, fin_block=%s\n",
-                            block.GetIdStr(), pbftMan.GetGlobalFinIndex()->GetIdString());
+    {
+        boost::unique_lock<boost::mutex> lock(cs_checkedBlocks);
+        if (setCheckedBlocks.count(blockHash))
+            return;
+
+        if (queueCheckedBlocks.size() < MAX_CHECKED_BLOCKS_QUEUE) {
+            setCheckedBlocks.insert(blockHash);
+            LOCK(cs_vNodes);
+            queueCheckedBlocks.push_back({pBlock, pFrom->AddRef()});
+            condCheckedBlocks.notify_all();
+            return;
+        }
+    }
+
+    // ThreadBlockConnect() is behind, drop the block rather than holding up the message handler. A block of the
+    // header chain is scheduled for download again, any other one comes back with the header sync.
+    LogPrint(BCLog::NET, "checked blocks queue full, drop block[%d] %s, peer=%s\n", pBlock->GetHeight(),
+             blockHash.ToString(), pFrom->addr.ToString());
+    LOCK(cs_main);
+    if (IsBlockInHeaderChain(pBlock->GetHeight(), blockHash)) {
+        LOCK(cs_mapNodeState);
+        RescheduleBlockDownload(pBlock->GetHeight());
+    }
+}
+
+void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv, bool fCompressed) {
+    auto pBlock = std::make_shared<CBlock>();
+    if (fCompressed) {
+        CCompressedBlock compressed;
+        vRecv >> compressed;
+        if (!compressed.Decompress(*pBlock, vRecv.GetType(), vRecv.GetVersion())) {
+            LogPrint(BCLog::INFO, "invalid compressed block from peer %s\n", pFrom->addr.ToString());
+            Misbehaving(pFrom->GetId(), 100);
+            return;
+        }
     } else {
-        ProcessBlock(state, pFrom, &block);
+        vRecv >> *pBlock;
     }
 
+    ProcessNewBlock(pFrom, pBlock);
+}
+
+void ProcessSendCmpctMessage(CNode *pFrom, CDataStream &vRecv) {
+    bool fAnnounce   = false;
+    uint64_t version = 0;
+    vRecv >> fAnnounce >> version;
+    if (version == CMPCT_BLOCK_VERSION)
+        pFrom->fPreferCompactBlocks = fAnnounce;
+}
+
+// Fall back to downloading the whole block
+static void RequestFullBlock(CNode *pFrom, const uint256 &blockHash) {
+    vector<CInv> vGetData = {CInv(MSG_BLOCK, blockHash)};
+    pFrom->PushMessage(NetMsgType::GETDATA, vGetData);
+}
+
+// Check a compact block against its parent and the delegate of its time slot before building it out of the mempool.
+// The delegates are exact on top of the active tip only, fVerified stays false for the other blocks.
+static bool CheckCmpctBlockHeader(CNode *pFrom, const CBlockHeader &header, bool &fVerified) {
+    fVerified = false;
+    uint256 blockHash = header.GetHash();
+    CPubKey ownerPubKey, minerPubKey;
+    {
+        LOCK(cs_main);
+        auto itPrev = mapBlockIndex.find(header.GetPrevBlockHash());
+        if (itPrev == mapBlockIndex.end())
+            return true;
+
+        CBlockIndex *pPrevIndex = itPrev->second;
+        if ((int32_t)header.GetHeight() != pPrevIndex->height + 1) {
+            Misbehaving(pFrom->GetId(), 100);
+            return ERRORMSG("cmpctblock[%u] %s is not on top of its parent[%d], peer %s", header.GetHeight(),
+                            blockHash.GetHex(), pPrevIndex->height, pFrom->addrName);
+        }
+
+        int64_t blockInterval = ::GetBlockInterval(header.GetHeight());
+        if (header.GetBlockTime() > GetAdjustedTime() + blockInterval + 2)
+            return ERRORMSG("cmpctblock[%u] timestamp too far in the future from peer %s", header.GetHeight(),
+                            pFrom->addrName);
+
+        // not banned for, as AcceptBlock() does not either
+        if (header.GetBlockTime() - pPrevIndex->GetBlockTime() < blockInterval)
+            return ERRORMSG("cmpctblock[%u] %s came in too early, peer %s", header.GetHeight(), blockHash.GetHex(),
+                            pFrom->addrName);
+
+        if (pPrevIndex != chainActive.Tip())
+            return true;
+
+        VoteDelegateVector delegates;
+        if (!pCdMan->pDelegateCache->GetActiveDelegates(delegates) || delegates.empty())
+            return ERRORMSG("get active delegates failed");
+
+        ShuffleDelegates(header.GetHeight(), header.GetTime(), delegates);
+        VoteDelegate delegate;
+        CAccount account;
+        if (!GetCurrentDelegate(header.GetTime(), header.GetHeight(), delegates, delegate) ||
+            !pCdMan->pAccountCache->GetAccount(delegate.regid, account)) {
+            Misbehaving(pFrom->GetId(), 100);
+            return ERRORMSG("cmpctblock[%u] %s has no delegate for its time slot, peer %s", header.GetHeight(),
+                            blockHash.GetHex(), pFrom->addrName);
+        }
+
+        ownerPubKey = account.owner_pubkey;
+        minerPubKey = account.miner_pubkey;
+    }
+
+    const auto &signature = header.GetSignature();
+    if (signature.empty() || signature.size() > MAX_SIGNATURE_SIZE ||
+        (!VerifySignature(blockHash, signature, ownerPubKey) && !VerifySignature(blockHash, signature, minerPubKey))) {
+        Misbehaving(pFrom->GetId(), 100);
+        return ERRORMSG("cmpctblock[%u] %s has a bad miner signature, peer %s", header.GetHeight(),
+                        blockHash.GetHex(), pFrom->addrName);
+    }
+
+    fVerified = true;
+    return true;
+}
+
+bool ProcessCmpctBlockMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockHeaderAndShortTxIDs cmpctBlock;
+    vRecv >> cmpctBlock;
+
+    uint256 blockHash = cmpctBlock.header.GetHash();
+    pFrom->AddInventoryKnown(CInv(MSG_BLOCK, blockHash));
+    LogPrint(BCLog::NET, "recv cmpctblock[%u]: %s, %u txs, peer=%s\n", cmpctBlock.header.GetHeight(),
+             blockHash.GetHex(), cmpctBlock.BlockTxCount(), pFrom->addr.ToString());
+
+    if (IsBlockPendingConnect(blockHash))
+        return true;
+
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(blockHash))
+            return true;
+
+        if (!mapBlockIndex.count(cmpctBlock.header.GetPrevBlockHash())) {
+            // Not connectable yet, let the orphan handling of the whole block ask for its parents
+            RequestFullBlock(pFrom, blockHash);
+            return true;
+        }
+    }
+
+    bool fVerified = false;
+    if (!CheckCmpctBlockHeader(pFrom, cmpctBlock.header, fVerified))
+        return false;
+
+    if (!fVerified) {
+        // Not on top of the active tip, leave it to the checks of the whole block
+        RequestFullBlock(pFrom, blockHash);
+        return true;
+    }
+
+    auto pPartialBlock = std::make_shared<CPartiallyDownloadedBlock>();
+    CPartiallyDownloadedBlock::ReadStatus status = pPartialBlock->InitData(cmpctBlock, mempool);
+    if (status == CPartiallyDownloadedBlock::READ_INVALID) {
+        Misbehaving(pFrom->GetId(), 100);
+        return ERRORMSG("invalid cmpctblock %s from peer %s", blockHash.GetHex(), pFrom->addr.ToString());
+    }
+
+    if (status == CPartiallyDownloadedBlock::READ_FAILED) {
+        RequestFullBlock(pFrom, blockHash);
+        return true;
+    }
+
+    CBlockTransactionsRequest req;
+    req.blockHash = blockHash;
+    req.indexes   = pPartialBlock->GetMissingIndexes();
+    if (req.indexes.empty()) {
+        auto pBlock = std::make_shared<CBlock>();
+        if (pPartialBlock->FillBlock(*pBlock, {}) != CPartiallyDownloadedBlock::READ_OK) {
+            RequestFullBlock(pFrom, blockHash);
+            return true;
+        }
+
+        ProcessNewBlock(pFrom, pBlock);
+        return true;
+    }
+
+    {
+        LOCK(cs_partialBlocks);
+        PartialBlockKey key(blockHash, pFrom->GetId());
+        if (!mapPartialBlocks.count(key)) {
+            if (mapPartialBlocksPerPeer[pFrom->GetId()] >= MAX_PARTIAL_BLOCKS_PER_PEER) {
+                // the peer makes room with its own oldest entry
+                auto itOldest = std::find_if(queuePartialBlocks.begin(), queuePartialBlocks.end(),
+                                             [&](const PartialBlockKey &k) { return k.second == pFrom->GetId(); });
+                if (itOldest != queuePartialBlocks.end())
+                    ErasePartialBlock(itOldest);
+            } else if (mapPartialBlocks.size() >= MAX_PARTIAL_BLOCKS) {
+                // full with the entries of other peers, which are not displaced
+                RequestFullBlock(pFrom, blockHash);
+                return true;
+            }
+
+            queuePartialBlocks.push_back(key);
+            mapPartialBlocksPerPeer[pFrom->GetId()]++;
+        }
+
+        mapPartialBlocks[key] = pPartialBlock;
+    }
+
+    LogPrint(BCLog::NET, "getblocktxn %u of %u txs of block %s from peer %s\n", req.indexes.size(),
+             cmpctBlock.BlockTxCount(), blockHash.GetHex(), pFrom->addr.ToString());
+    pFrom->PushMessage(NetMsgType::GETBLOCKTXN, req);
+    return true;
+}
+
+bool ProcessGetBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockTransactionsRequest req;
+    vRecv >> req;
+
+    CBlock block;
+    {
+        LOCK(cs_main);
+        auto it = mapBlockIndex.find(req.blockHash);
+        if (it == mapBlockIndex.end() || !ReadBlockFromDisk(it->second, block)) {
+            LogPrint(BCLog::NET, "getblocktxn for unknown block %s from peer %s\n", req.blockHash.GetHex(),
+                     pFrom->addr.ToString());
+            return true;
+        }
+    }
+
+    for (auto index : req.indexes) {
+        if (index >= block.vptx.size()) {
+            Misbehaving(pFrom->GetId(), 100);
+            return ERRORMSG("getblocktxn with out of range index %u from peer %s", index, pFrom->addr.ToString());
+        }
+    }
+
+    pFrom->PushMessage(NetMsgType::BLOCKTXN, CBlockTransactions(block, req));
+    return true;
+}
+
+bool ProcessBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockTransactions resp;
+    vRecv >> resp;
+
+    std::shared_ptr<CPartiallyDownloadedBlock> pPartialBlock;
+    {
+        LOCK(cs_partialBlocks);
+        PartialBlockKey key(resp.blockHash, pFrom->GetId());
+        auto it = mapPartialBlocks.find(key);
+        if (it == mapPartialBlocks.end()) {
+            // the compact block was evicted or never asked from this peer
+            if (!IsBlockPendingConnect(resp.blockHash)) {
+                LOCK(cs_main);
+                if (!mapBlockIndex.count(resp.blockHash))
+                    RequestFullBlock(pFrom, resp.blockHash);
+            }
+            return true;
+        }
+
+        pPartialBlock = it->second;
+        ErasePartialBlock(std::find(queuePartialBlocks.begin(), queuePartialBlocks.end(), key));
+    }
+
+    auto pBlock = std::make_shared<CBlock>();
+    CPartiallyDownloadedBlock::ReadStatus status = pPartialBlock->FillBlock(*pBlock, resp.vptx);
+    if (status == CPartiallyDownloadedBlock::READ_INVALID) {
+        Misbehaving(pFrom->GetId(), 100);
+        return ERRORMSG("invalid blocktxn for block %s from peer %s", resp.blockHash.GetHex(), pFrom->addr.ToString());
+    }
+
+    if (status == CPartiallyDownloadedBlock::READ_FAILED) {
+        RequestFullBlock(pFrom, resp.blockHash);
+        return true;
+    }
+
+    ProcessNewBlock(pFrom, pBlock);
+    return true;
 }
 
 void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv) {
@@ -826,6 +1631,9 @@ bool ProcessBlockConfirmMessage(CNode *pFrom, CDataStream &vRecv) {
 
     pFrom->AddBlockConfirmMessageKnown(message);
 
+    if (pbftMessageQueue.Push(pFrom->GetId(), message))
+        return true;
+
     return pbftMan.ProcessBlockConfirmMessage(pFrom, message);
 }
 
@@ -844,8 +1652,77 @@ bool ProcessBlockFinalityMessage(CNode *pFrom, CDataStream &vRecv) {
 
     pFrom->AddBlockFinalityMessageKnown(message);
 
+    if (pbftMessageQueue.Push(pFrom->GetId(), message))
+        return true;
+
     return pbftMan.ProcessBlockFinalityMessage(pFrom, message);
 }
+
+void ProcessSendPbftBatchMessage(CNode *pFrom, CDataStream &vRecv) {
+    uint64_t version = 0;
+    vRecv >> version;
+    if (version == PBFT_BATCH_VERSION)
+        pFrom->fPbftBatch = true;
+}
+
+// Read a batch message and expand it, returns false if the batch is malformed
+template <typename MsgType>
+static bool ReadPBFTMessageBatch(CNode *pFrom, CDataStream &vRecv, const int32_t msgType, vector<MsgType> &msgs) {
+    CPBFTMessageBatch batch;
+    vRecv >> batch;
+
+    if (batch.msgType != msgType || batch.signatures.empty() ||
+        batch.signatures.size() > MAX_PBFT_BATCH_SIGNATURES) {
+        LogPrint(BCLog::INFO, "Misbehaving: invalid pbft batch, msg_type=%d, signatures=%u, Misbehavior add 100\n",
+                 batch.msgType, batch.signatures.size());
+        Misbehaving(pFrom->GetId(), 100);
+        return false;
+    }
+
+    LogPrint(BCLog::NET, "received pbft batch: msg_type=%d, block=[%u]%s, signatures=%u, peer=%s\n", batch.msgType,
+             batch.height, batch.blockHash.GetHex(), batch.signatures.size(), pFrom->addr.ToString());
+
+    batch.GetMessages(msgs);
+    return true;
+}
+
+bool ProcessBlockConfirmBatchMessage(CNode *pFrom, CDataStream &vRecv) {
+    if (IsInitialBlockDownload()) {
+        LogPrint(BCLog::NET, "ignore the pbft confirm batch in IBD state\n");
+        return false;
+    }
+
+    vector<CBlockConfirmMessage> msgs;
+    if (!ReadPBFTMessageBatch(pFrom, vRecv, PBFTMsgType::CONFIRM_BLOCK, msgs))
+        return false;
+
+    PBFTConfirmList unqueuedMsgs;
+    for (const auto &msg : msgs) {
+        pFrom->AddBlockConfirmMessageKnown(msg);
+        if (!pbftMessageQueue.Push(pFrom->GetId(), msg))
+            unqueuedMsgs.emplace_back(pFrom->GetId(), msg);
+    }
+
+    return unqueuedMsgs.empty() || pbftMan.ProcessBlockConfirmMessages(unqueuedMsgs);
+}
+
+bool ProcessBlockFinalityBatchMessage(CNode *pFrom, CDataStream &vRecv) {
+    if (SysCfg().IsReindex() || GetTime() - chainActive.Tip()->GetBlockTime() > 600)
+        return false;
+
+    vector<CBlockFinalityMessage> msgs;
+    if (!ReadPBFTMessageBatch(pFrom, vRecv, PBFTMsgType::FINALITY_BLOCK, msgs))
+        return false;
+
+    PBFTFinalityList unqueuedMsgs;
+    for (const auto &msg : msgs) {
+        pFrom->AddBlockFinalityMessageKnown(msg);
+        if (!pbftMessageQueue.Push(pFrom->GetId(), msg))
+            unqueuedMsgs.emplace_back(pFrom->GetId(), msg);
+    }
+
+    return unqueuedMsgs.empty() || pbftMan.ProcessBlockFinalityMessages(unqueuedMsgs);
+}
 void ProcessRejectMessage(CNode *pFrom, CDataStream &vRecv) {
     if (SysCfg().IsDebug()) {
         string message;
@@ -10,10 +10,12 @@
 #include "commons/uint256.h"
 #include "commons/util/util.h"
 #include "main.h"
+#include "chain/orphanpool.h"
 #include "addrman.h"
 #include "net.h"
 #include "miner/pbftcontext.h"
 #include "miner/pbftmanager.h"
+#include "p2p/blockencodings.h"
 
 #include <string>
 #include <tuple>
@@ -29,12 +31,9 @@ static const int64_t WITNESS_NODE_BLOCKS_IN_FLIGHT_TIMEOUT   = 10;  // 10 second
 class CNode;
 class CDataStream;
 class CInv;
-class COrphanBlock;
 class CBlockConfirmMessage;
 
 extern CPBFTMan pbftMan;
-extern uint256 GetOrphanRoot(const uint256 &hash);
-extern map<uint256, COrphanBlock *> mapOrphanBlocks;
 
 // Requires cs_mapNodeState.
 void MarkBlockAsReceived(const uint256 &hash, NodeId nodeFrom = -1);
@@ -42,13 +41,6 @@ void MarkBlockAsReceived(const uint256 &hash, NodeId nodeFrom = -1);
 // Requires cs_mapNodeState.
 void MarkBlockAsInFlight(const uint256 &hash, NodeId nodeId);
 
-struct COrphanBlock {
-    uint256 blockHash;
-    uint256 prevBlockHash;
-    int32_t height;
-    vector<uint8_t> vchBlock;
-};
-
 static CMedianFilter<int32_t> cPeerBlockCounts(8, 0);
 
 void ProcessGetData(CNode *pFrom);
@@ -58,6 +50,41 @@ bool AlreadyHave(const CInv &inv);
 // Requires cs_main.
 bool AddBlockToQueue(const uint256 &hash, NodeId nodeId);
 
+// Requires cs_main.
+void PushGetHeaders(CNode *pNode, const CBlockLocator &locator, const uint256 &hashEnd);
+
+// Send a block, compressed to the peers advertising NODE_COMPRESSED_BLOCKS. pCompressed caches the compressed
+// block, pass the same one when sending a block to several peers.
+void PushBlockMessage(CNode *pNode, const CBlock &block, std::unique_ptr<CCompressedBlock> &pCompressed);
+
+// Announce a new block with a "cmpctblock" message, unless the peer already knows it. pCmpctBlock caches the
+// encoded block, pass the same one when announcing a block to several peers.
+void PushCompactBlock(CNode *pNode, const CBlock &block, std::unique_ptr<CBlockHeaderAndShortTxIDs> &pCmpctBlock);
+
+// Requires cs_main. Queue the blocks of the header chain inside the download window for this peer.
+void ScheduleBlockDownload(CNode *pTo);
+
+// Requires cs_mapNodeState. Scan the header chain from this height on again, its block downloads were given up.
+void RescheduleBlockDownload(int32_t height);
+
+// Stop syncing headers with this peer, it is going away. Only queues the peer, without taking cs_main.
+void ReleaseHeadersSyncPeer(NodeId nodeId);
+
+// Requires cs_main. Release the header sync of the peers queued by ReleaseHeadersSyncPeer().
+void ReleaseGonePeers();
+
+// Drop the compact blocks of this peer waiting for their missing transactions, it is going away.
+void ReleasePartialBlocks(NodeId nodeId);
+
+// Requires cs_main. Whether the block is part of the header chain being downloaded.
+bool IsBlockInHeaderChain(int32_t height, const uint256 &hash);
+
+// Whether the block passed CheckBlock() and waits to be connected.
+bool IsBlockPendingConnect(const uint256 &hash);
+
+// Connect the blocks pre-checked by ProcessBlockMessage().
+void ThreadBlockConnect();
+
 int32_t ProcessVersionMessage(CNode *pFrom, string strCommand, CDataStream &vRecv);
 
 void ProcessPongMessage(CNode *pFrom, CDataStream &vRecv);
@@ -68,13 +95,23 @@ bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv);
 
 bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv);
 
+bool ProcessHeadersMessage(CNode *pFrom, CDataStream &vRecv);
+
 void ProcessGetBlocksMessage(CNode *pFrom, CDataStream &vRecv);
 
 bool ProcessInvMessage(CNode *pFrom, CDataStream &vRecv);
 
 bool ProcessGetDataMessage(CNode *pFrom, CDataStream &vRecv);
 
-void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv);
+void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv, bool fCompressed = false);
+
+void ProcessSendCmpctMessage(CNode *pFrom, CDataStream &vRecv);
+
+bool ProcessCmpctBlockMessage(CNode *pFrom, CDataStream &vRecv);
+
+bool ProcessGetBlockTxnMessage(CNode *pFrom, CDataStream &vRecv);
+
+bool ProcessBlockTxnMessage(CNode *pFrom, CDataStream &vRecv);
 
 void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv);
 
@@ -89,6 +126,12 @@ bool ProcessBlockConfirmMessage(CNode *pFrom, CDataStream &vRecv);
 
 bool ProcessBlockFinalityMessage(CNode *pFrom, CDataStream &vRecv);
 
+void ProcessSendPbftBatchMessage(CNode *pFrom, CDataStream &vRecv);
+
+bool ProcessBlockConfirmBatchMessage(CNode *pFrom, CDataStream &vRecv);
+
+bool ProcessBlockFinalityBatchMessage(CNode *pFrom, CDataStream &vRecv);
+
 void ProcessRejectMessage(CNode *pFrom, CDataStream &vRecv);
 
 #endif  // CHAINMESSAGE_H
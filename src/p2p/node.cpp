@@ -13,15 +13,18 @@ uint64_t CNode::nTotalBytesSent = 0;
 CCriticalSection CNode::cs_totalBytesRecv;
 CCriticalSection CNode::cs_totalBytesSent;
 CCriticalSection cs_nLastNodeId;
-uint64_t nLocalServices = NODE_NETWORK;
+uint64_t nLocalServices = NODE_NETWORK | NODE_COMPRESSED_BLOCKS;
 uint64_t nLocalHostNonce         = 0;
 extern map<CNetAddr, LocalServiceInfo> mapLocalHost;
+extern void ReleaseHeadersSyncPeer(NodeId nodeId);
+extern void ReleasePartialBlocks(NodeId nodeId);
+extern void RescheduleBlockDownload(int32_t height);
 // Map maintaining per-node state. Requires cs_mapNodeState.
 map<NodeId, CNodeState> mapNodeState;
 CCriticalSection cs_mapNodeState;
 
 NodeId nLastNodeId = 0;
-limitedmap<CInv, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
+CBoundedHashMap<int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
 CNode* pnodeSync = nullptr;
 
 
@@ -35,6 +38,9 @@ void InitializeNode(NodeId nodeid, const CNode *pNode) {
 }
 
 void FinalizeNode(NodeId nodeid) {
+    ReleaseHeadersSyncPeer(nodeid);
+    ReleasePartialBlocks(nodeid);
+
     LOCK(cs_mapNodeState);
     CNodeState *state = State(nodeid);
 
@@ -44,6 +50,10 @@ void FinalizeNode(NodeId nodeid) {
     for (const auto &hash : state->vBlocksToDownload)
         mapBlocksToDownload.erase(hash);
 
+    // the blocks of this peer go to the others
+    if (!state->vBlocksInFlight.empty() || !state->vBlocksToDownload.empty())
+        RescheduleBlockDownload(0);
+
     mapNodeState.erase(nodeid);
 }
 
@@ -12,7 +12,7 @@
 #include "sync.h"
 #include "commons/compat/compat.h"
 #include "p2p/protocol.h"
-#include "commons/limitedmap.h"
+#include "commons/boundedhash.h"
 #include "commons/bloom.h"
 #include "commons/mruset.h"
 #include "commons/random.h"
@@ -39,7 +39,7 @@ static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
 /** The maximum number of new addresses to accumulate before announcing. */
 static const uint32_t MAX_ADDR_TO_SEND = 1000;
 
-extern limitedmap<CInv, int64_t> mapAlreadyAskedFor;
+extern CBoundedHashMap<int64_t> mapAlreadyAskedFor;  // inv hash -> time of the last request
 
 struct LocalServiceInfo {
     int32_t nScore;
@@ -100,6 +100,7 @@ struct CNodeState {
     int32_t nBlocksToDownload;        // blocks number to be downloaded
     int64_t nLastBlockReceive;        // the latest receiving blocks time
     int64_t nLastBlockProcess;        // the latest processing blocks time
+    int32_t nBestHeaderHeight;        // the highest header announced by this peer
 
     CNodeState() {
         nMisbehavior      = 0;
@@ -108,6 +109,7 @@ struct CNodeState {
         nBlocksInFlight   = 0;
         nLastBlockReceive = 0;
         nLastBlockProcess = 0;
+        nBestHeaderHeight = 0;
     }
 };
 
@@ -157,6 +159,10 @@ public:
     // b) the peer may tell us in their version message that we should not relay tx invs
     //    until they have initialized their bloom filter.
     bool fRelayTxes;
+    // The peer asked for new blocks to be announced with "cmpctblock" messages
+    bool fPreferCompactBlocks;
+    // The peer asked for pbft messages to be batched with "sendpbftbatch"
+    bool fPbftBatch;
     CSemaphoreGrant grantOutbound;
     CCriticalSection cs_filter;
     CBloomFilter* pFilter;
@@ -186,7 +192,7 @@ public:
     set<uint256> setKnown;  // alertHash
 
     // inventory based relay
-    mruset<CInv> setInventoryKnown;  //存放已收到的inv
+    CBoundedHashSet setInventoryKnown;  //存放已收到的inv hash
     vector<CInv> vInventoryToSend;   //待发送的inv
     std::set<CInv> setForceToSend;   //强制发送的inv
 
@@ -194,10 +200,12 @@ public:
     multimap<int64_t, CInv> mapAskFor;  //向网络请求交易的时间, a priority queue
 
 
-    mruset<CBlockConfirmMessage> setBlockConfirmMsgKnown;
+    CBoundedHashSet setBlockConfirmMsgKnown;  // msg hashes
+    vector<CBlockConfirmMessage> vBlockConfirmToSend;   // batched on the next SendMessages if fPbftBatch
     CCriticalSection cs_blockConfirm;
 
-    mruset<CBlockFinalityMessage> setBlockFinalityMsgKnown;
+    CBoundedHashSet setBlockFinalityMsgKnown;
+    vector<CBlockFinalityMessage> vBlockFinalityToSend;
     CCriticalSection cs_blockFinality;
 
     // Ping time measurement
@@ -207,7 +215,8 @@ public:
     bool fPingQueued;
 
     CNode(SOCKET hSocketIn, CAddress addrIn, string addrNameIn = "", bool fInboundIn = false)
-            : ssSend(SER_NETWORK, INIT_PROTO_VERSION), setAddrKnown(5000) {
+            : ssSend(SER_NETWORK, INIT_PROTO_VERSION), setAddrKnown(5000),
+              setInventoryKnown(SendBufferSize() / 1000, CBoundedHashSet::Eviction::CLOCK) {
         nServices                = 0;
         hSocket                  = hSocketIn;
         nRecvVersion             = INIT_PROTO_VERSION;
@@ -237,7 +246,8 @@ public:
         fStartSync               = false;
         fGetAddr                 = false;
         fRelayTxes               = false;
-        setInventoryKnown.max_size(SendBufferSize() / 1000);
+        fPreferCompactBlocks     = false;
+        fPbftBatch               = false;
         auto maxPbftMsgSize = MaxPbftMsgSize();
         setBlockConfirmMsgKnown.max_size(maxPbftMsgSize);
         setBlockFinalityMsgKnown.max_size(maxPbftMsgSize);
@@ -321,8 +331,8 @@ public:
 
     void AddAddressKnown(const CAddress& addr) { setAddrKnown.insert(addr); }
 
-    void AddBlockConfirmMessageKnown(const CBlockConfirmMessage msg){ setBlockConfirmMsgKnown.insert(msg); }
-    void AddBlockFinalityMessageKnown(const CBlockFinalityMessage msg){ setBlockFinalityMsgKnown.insert(msg); }
+    void AddBlockConfirmMessageKnown(const CBlockConfirmMessage msg){ setBlockConfirmMsgKnown.insert(msg.GetHash()); }
+    void AddBlockFinalityMessageKnown(const CBlockFinalityMessage msg){ setBlockFinalityMsgKnown.insert(msg.GetHash()); }
 
     void PushAddress(const CAddress& addr) {
         // Known checking here is only to save space from duplicates.
@@ -339,7 +349,7 @@ public:
 
     void AddInventoryKnown(const CInv& inv) {
         LOCK(cs_inventory);
-        setInventoryKnown.insert(inv);
+        setInventoryKnown.insert(inv.hash);
     }
 
     void PushInventory(const CInv& inv, bool forced = false) {
@@ -348,26 +358,51 @@ public:
         if (forced)
             setForceToSend.insert(inv);
 
-        if (forced || !setInventoryKnown.count(inv))
+        if (forced || !setInventoryKnown.count(inv.hash))
             vInventoryToSend.push_back(inv);
     }
 
     void PushBlockConfirmMessage(const CBlockConfirmMessage& msg) {
         LOCK(cs_blockConfirm);
-        if(!setBlockConfirmMsgKnown.count(msg)){
-            PushMessage(NetMsgType::CONFIRMBLOCK, msg);
-            setBlockConfirmMsgKnown.insert(msg);
+        if (setBlockConfirmMsgKnown.insert(msg.GetHash())) {
+            if (fPbftBatch)
+                vBlockConfirmToSend.push_back(msg);
+            else
+                PushMessage(NetMsgType::CONFIRMBLOCK, msg);
         }
     }
 
     void PushBlockFinalityMessage(const CBlockFinalityMessage& msg) {
         LOCK(cs_blockFinality);
-        if(!setBlockFinalityMsgKnown.count(msg)){
-            PushMessage(NetMsgType::FINALITYBLOCK, msg);
-            setBlockFinalityMsgKnown.insert(msg);
+        if (setBlockFinalityMsgKnown.insert(msg.GetHash())) {
+            if (fPbftBatch)
+                vBlockFinalityToSend.push_back(msg);
+            else
+                PushMessage(NetMsgType::FINALITYBLOCK, msg);
         }
     }
 
+    // Send the queued pbft messages, one "confirmblocks" or "finblocks" message per block
+    void PushPbftMessageBatches() {
+        vector<CPBFTMessageBatch> batches;
+        {
+            LOCK(cs_blockConfirm);
+            MakePBFTMessageBatches(vBlockConfirmToSend, batches);
+            vBlockConfirmToSend.clear();
+        }
+        for (const auto& batch : batches)
+            PushMessage(NetMsgType::CONFIRMBLOCKS, batch);
+
+        batches.clear();
+        {
+            LOCK(cs_blockFinality);
+            MakePBFTMessageBatches(vBlockFinalityToSend, batches);
+            vBlockFinalityToSend.clear();
+        }
+        for (const auto& batch : batches)
+            PushMessage(NetMsgType::FINALITYBLOCKS, batch);
+    }
+
     void AskFor(const CInv& inv) {
         if (mapAskFor.size() > MAPASKFOR_MAX_SZ) {
             return;
@@ -375,12 +410,8 @@ public:
 
         // We're using mapAskFor as a priority queue,
         // the key is the earliest time the request can be sent
-        int64_t nRequestTime;
-        limitedmap<CInv, int64_t>::const_iterator it = mapAlreadyAskedFor.find(inv);
-        if (it != mapAlreadyAskedFor.end())
-            nRequestTime = it->second;
-        else
-            nRequestTime = 0;
+        int64_t *pAlreadyAskedFor = mapAlreadyAskedFor.find(inv.hash);
+        int64_t nRequestTime      = pAlreadyAskedFor != nullptr ? *pAlreadyAskedFor : 0;
         LogPrint(BCLog::NET, "ask for %s %d (%s)\n", inv.ToString().c_str(), nRequestTime,
                  DateTimeStrFormat("%H:%M:%S", nRequestTime / 1000000).c_str());
 
@@ -393,10 +424,10 @@ public:
 
         // Each retry is 2 minutes after the last
         nRequestTime = max(nRequestTime + 2 * 60 * 1000000, nNow);
-        if (it != mapAlreadyAskedFor.end())
-            mapAlreadyAskedFor.update(it, nRequestTime);
+        if (pAlreadyAskedFor != nullptr)
+            *pAlreadyAskedFor = nRequestTime;
         else
-            mapAlreadyAskedFor.insert(make_pair(inv, nRequestTime));
+            mapAlreadyAskedFor.insert(inv.hash, nRequestTime);
         mapAskFor.insert(make_pair(nRequestTime, inv));
     }
 
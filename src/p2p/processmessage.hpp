@@ -58,15 +58,45 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
             return true;
     }
 
+    else if (strCommand == NetMsgType::HEADERS &&
+            !SysCfg().IsImporting() && !SysCfg().IsReindex())  // Ignore headers received while importing
+    {
+        if (!ProcessHeadersMessage(pFrom, vRecv))
+            return false;
+    }
+
     else if (strCommand == NetMsgType::TX) {
         if (!ProcessTxMessage(pFrom, strCommand, vRecv))
             return false;
     }
 
-    else if (strCommand == NetMsgType::BLOCK &&
+    else if ((strCommand == NetMsgType::BLOCK || strCommand == NetMsgType::ZBLOCK) &&
             !SysCfg().IsImporting() && !SysCfg().IsReindex())  // Ignore blocks received while importing
     {
-        ProcessBlockMessage(pFrom, vRecv);
+        ProcessBlockMessage(pFrom, vRecv, strCommand == NetMsgType::ZBLOCK);
+    }
+
+    else if (strCommand == NetMsgType::SENDCMPCT) {
+        ProcessSendCmpctMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::CMPCTBLOCK &&
+            !SysCfg().IsImporting() && !SysCfg().IsReindex())  // Ignore blocks received while importing
+    {
+        if (!ProcessCmpctBlockMessage(pFrom, vRecv))
+            return false;
+    }
+
+    else if (strCommand == NetMsgType::GETBLOCKTXN) {
+        if (!ProcessGetBlockTxnMessage(pFrom, vRecv))
+            return false;
+    }
+
+    else if (strCommand == NetMsgType::BLOCKTXN &&
+            !SysCfg().IsImporting() && !SysCfg().IsReindex())
+    {
+        if (!ProcessBlockTxnMessage(pFrom, vRecv))
+            return false;
     }
 
     else if (strCommand == NetMsgType::GETADDR) {
@@ -132,6 +162,15 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
     } else if (strCommand == NetMsgType::FINALITYBLOCK) {
         ProcessBlockFinalityMessage(pFrom, vRecv);
 
+    } else if (strCommand == NetMsgType::SENDPBFTBATCH) {
+        ProcessSendPbftBatchMessage(pFrom, vRecv);
+
+    } else if (strCommand == NetMsgType::CONFIRMBLOCKS) {
+        ProcessBlockConfirmBatchMessage(pFrom, vRecv);
+
+    } else if (strCommand == NetMsgType::FINALITYBLOCKS) {
+        ProcessBlockFinalityBatchMessage(pFrom, vRecv);
+
     } else {
         // Ignore unknown commands for extensibility
     }
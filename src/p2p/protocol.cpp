@@ -22,8 +22,9 @@ namespace NetMsgType {
     const char *GETBLOCKS="getblocks";
     const char *GETHEADERS="getheaders";
     const char *TX="tx";
-    // const char *HEADERS="headers";
+    const char *HEADERS="headers";
     const char *BLOCK="block";
+    const char *ZBLOCK="zblock";
     const char *GETADDR="getaddr";
     const char *MEMPOOL="mempool";
     const char *PING="ping";
@@ -36,12 +37,15 @@ namespace NetMsgType {
     const char *REJECT="reject";
     const char *CONFIRMBLOCK = "confirmblock";
     const char *FINALITYBLOCK = "finblock";
+    const char *SENDPBFTBATCH = "sendpbftbatch";
+    const char *CONFIRMBLOCKS = "confirmblocks";
+    const char *FINALITYBLOCKS = "finblocks";
     // const char *SENDHEADERS="sendheaders";
     // const char *FEEFILTER="feefilter";
-    // const char *SENDCMPCT="sendcmpct";
-    // const char *CMPCTBLOCK="cmpctblock";
-    // const char *GETBLOCKTXN="getblocktxn";
-    // const char *BLOCKTXN="blocktxn";
+    const char *SENDCMPCT="sendcmpct";
+    const char *CMPCTBLOCK="cmpctblock";
+    const char *GETBLOCKTXN="getblocktxn";
+    const char *BLOCKTXN="blocktxn";
 } // namespace NetMsgType
 
 static const char* ppszTypeName[] =
@@ -16,6 +16,7 @@
 #include "commons/uint256.h"
 
 #include <stdint.h>
+#include <algorithm>
 #include <string>
 
 /** Message header.
@@ -62,6 +63,8 @@ class CMessageHeader
 enum
 {
     NODE_NETWORK = (1 << 0),
+    // the node accepts blocks in "zblock" messages
+    NODE_COMPRESSED_BLOCKS = (1 << 1),
 };
 
 
@@ -131,12 +134,17 @@ extern const char *TX;
  * @since protocol version 31800.
  * @see https://bitcoin.org/en/developer-reference#headers
  */
-// extern const char *HEADERS;
+extern const char *HEADERS;
 /**
  * The block message transmits a single serialized block.
  * @see https://bitcoin.org/en/developer-reference#block
  */
 extern const char *BLOCK;
+/**
+ * The zblock message transmits a single block compressed as a CCompressedBlock.
+ * Only sent to peers advertising service bit NODE_COMPRESSED_BLOCKS.
+ */
+extern const char *ZBLOCK;
 /**
  * The getaddr message requests an addr message from the receiving node,
  * preferably one with lots of IP addresses of other receiving nodes.
@@ -253,6 +261,20 @@ extern const char *BLOCKTXN;
 extern const char *CONFIRMBLOCK;
 
 extern const char *FINALITYBLOCK;
+/**
+ * Contains a 8-byte LE version number.
+ * Indicates that a node wants the confirm and finality messages of a block
+ * batched into "confirmblocks" and "finblocks" messages.
+ */
+extern const char *SENDPBFTBATCH;
+/**
+ * Contains a CPBFTMessageBatch of confirm messages for one block.
+ */
+extern const char *CONFIRMBLOCKS;
+/**
+ * Contains a CPBFTMessageBatch of finality messages for one block.
+ */
+extern const char *FINALITYBLOCKS;
 };
 
 enum PBFTMsgType {
@@ -381,6 +403,67 @@ public:
     }
 };
 
+static const uint64_t PBFT_BATCH_VERSION = 1;
+
+/**
+ * The confirm or finality messages of several BPs for the same block, with the block fields carried once
+ * and one (miner, signature) pair per BP. Sent in place of the single messages to the peers which asked
+ * for it with "sendpbftbatch".
+ */
+class CPBFTMessageBatch {
+public:
+    int32_t msgType = 0;
+    uint32_t height = 0;
+    uint256 blockHash;
+    uint256 preBlockHash;
+    vector<pair<CRegID, vector<unsigned char>>> signatures;
+
+    IMPLEMENT_SERIALIZE
+    (
+            READWRITE(msgType);
+            READWRITE(height);
+            READWRITE(blockHash);
+            READWRITE(preBlockHash);
+            READWRITE(signatures);
+    )
+
+    bool Matches(const CPBFTMessage& msg) const {
+        return msg.msgType == msgType && msg.height == height && msg.blockHash == blockHash &&
+               msg.preBlockHash == preBlockHash;
+    }
+
+    // expand the batch back into one message per signature
+    template <typename MsgType>
+    void GetMessages(vector<MsgType>& msgs) const {
+        MsgType msg(height, blockHash, preBlockHash);
+        msg.msgType = msgType;
+        for (const auto& item : signatures) {
+            msg.miner      = item.first;
+            msg.vSignature = item.second;
+            msgs.push_back(msg);
+        }
+    }
+};
+
+// group the messages of the same block into batches of at most MAX_PBFT_BATCH_SIGNATURES
+template <typename MsgType>
+void MakePBFTMessageBatches(const vector<MsgType>& msgs, vector<CPBFTMessageBatch>& batches) {
+    for (const auto& msg : msgs) {
+        auto it = std::find_if(batches.begin(), batches.end(), [&](const CPBFTMessageBatch& batch) {
+            return batch.Matches(msg) && batch.signatures.size() < MAX_PBFT_BATCH_SIGNATURES;
+        });
+        if (it == batches.end()) {
+            batches.emplace_back();
+            it               = batches.end() - 1;
+            it->msgType      = msg.msgType;
+            it->height       = msg.height;
+            it->blockHash    = msg.blockHash;
+            it->preBlockHash = msg.preBlockHash;
+        }
+        it->signatures.emplace_back(msg.miner, msg.vSignature);
+    }
+}
+
 enum
 {
     MSG_TX = 1,
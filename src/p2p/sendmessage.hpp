@@ -67,6 +67,10 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
             //LogPrint(BCLog::NET, "send ping: %s\n", DateTimeStrFormat("YYYY-MM-DDTHH-MM-SS", pTo->nPingUsecStart).c_str());
         }
 
+        // The pbft messages queued since the last round, batched per block
+        if (pTo->fPbftBatch)
+            pTo->PushPbftMessageBatches();
+
         {
             TRY_LOCK(cs_main, lockMain);  // Acquire cs_main for IsInitialBlockDownload() and CNodeState()
             if (!lockMain)
@@ -115,14 +119,20 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                     pTo->PushMessage(NetMsgType::ADDR, vAddr);
             }
 
+            ReleaseGonePeers();
+
             // Start block sync
             if (pTo->fStartSync && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
                 pTo->fStartSync = false;
                 nSyncTipHeight  = pTo->nStartingHeight;
-                LogPrint(BCLog::NET, "start block sync lead to getblocks\n");
-                PushGetBlocks(pTo, chainActive.Tip(), uint256());
+                LogPrint(BCLog::NET, "start block sync lead to getheaders\n");
+                PushGetHeaders(pTo, chainActive.GetLocator(chainActive.Tip()), uint256());
             }
 
+            // Spread the blocks of the header chain over all peers which have them
+            if (!SysCfg().IsImporting() && !SysCfg().IsReindex())
+                ScheduleBlockDownload(pTo);
+
             // Resend wallet transactions that haven't gotten in a block yet
             // Except during reindex, importing and IBD, when old wallet
             // transactions become unconfirmed and spams other nodes.
@@ -161,13 +171,13 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
             for (const auto &inv : pTo->vInventoryToSend) {
 
                 if(pTo->setForceToSend.count(inv)){
-                    pTo->setInventoryKnown.insert(inv);
+                    pTo->setInventoryKnown.insert(inv.hash);
                     vInv.push_back(inv);
                     pTo->setForceToSend.erase(inv);
                     continue;
                 }
 
-                if (pTo->setInventoryKnown.count(inv))
+                if (pTo->setInventoryKnown.count(inv.hash))
                     continue;
 
                 // trickle out tx inv to protect privacy
@@ -187,7 +197,7 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                 }
 
                 // returns true if wasn't already contained in the set
-                if (pTo->setInventoryKnown.insert(inv).second) {
+                if (pTo->setInventoryKnown.insert(inv.hash)) {
                     vInv.push_back(inv);
                     if (vInv.size() >= 1000) {
                         pTo->PushMessage(NetMsgType::INV, vInv);
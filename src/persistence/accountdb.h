@@ -94,6 +94,11 @@ public:
         regId2KeyIdCache.RegisterUndoFunc(undoDataFuncMap);
         accountCache.RegisterUndoFunc(undoDataFuncMap);
     }
+
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        regId2KeyIdCache.RegisterForgetFunc(forgetDataFuncMap);
+        accountCache.RegisterForgetFunc(forgetDataFuncMap);
+    }
 public:
 /*  CCompositeKVCache     prefixType            key              value           variable           */
 /*  -------------------- --------------------   --------------  -------------   --------------------- */
@@ -133,6 +133,12 @@ public:
         axc_swap_coin_ps_cache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        asset_cache.RegisterForgetFunc(forgetDataFuncMap);
+        axc_swap_coin_sp_cache.RegisterForgetFunc(forgetDataFuncMap);
+        axc_swap_coin_ps_cache.RegisterForgetFunc(forgetDataFuncMap);
+    }
+
     shared_ptr<CUserAssetsIterator> CreateUserAssetsIterator() {
         return make_shared<CUserAssetsIterator>(asset_cache);
     }
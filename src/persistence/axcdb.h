@@ -63,6 +63,10 @@ public:
         axc_swapin_cache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        axc_swapin_cache.RegisterForgetFunc(forgetDataFuncMap);
+    }
+
 
 public:
 /*  CSimpleKVCache          prefixType             value           variable           */
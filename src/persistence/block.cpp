@@ -5,6 +5,7 @@
 
 #include "block.h"
 
+#include "commons/compress.h"
 #include "entities/account.h"
 #include "tx/blockpricemediantx.h"
 #include "main.h"
@@ -141,42 +142,187 @@ std::tuple<bool, int> CBlock::GetTxIndex(const uint256& txid) const {
 //////////////////////////////////////////////////////////////////////////////
 // global functions
 
-bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos) {
+CCompressedBlock::CCompressedBlock(const CBlock &block, int32_t nType, int32_t nVersion) {
+    CDataStream ss(nType, nVersion);
+    ss << block;
+    nRawSize = ss.size();
+    CompressZstd((const uint8_t *)&ss[0], ss.size(), vData);
+}
+
+bool CCompressedBlock::Decompress(vector<char> &vchBlock) const {
+    if (nRawSize > MAX_BLOCK_SIZE)
+        return ERRORMSG("compressed block too large, raw size=%u", nRawSize);
+
+    vector<uint8_t> vRaw;
+    if (!DecompressZstd(vData.data(), vData.size(), nRawSize, vRaw))
+        return ERRORMSG("malformed compressed block, raw size=%u", nRawSize);
+
+    vchBlock.assign(vRaw.begin(), vRaw.end());
+    return true;
+}
+
+bool CCompressedBlock::Decompress(CBlock &block, int32_t nType, int32_t nVersion) const {
+    vector<char> vchBlock;
+    if (!Decompress(vchBlock))
+        return false;
+
+    try {
+        CDataStream ss(vchBlock, nType, nVersion);
+        ss >> block;
+    } catch (std::exception &e) {
+        return ERRORMSG("Deserialize compressed block error - %s", e.what());
+    }
+
+    return true;
+}
+
+CBlockFileRecord::CBlockFileRecord(const CBlock &block) : ssData(SER_DISK, CLIENT_VERSION) {
+    if (SysCfg().IsCompressBlocks()) {
+        CCompressedBlock compressed(block, SER_DISK, CLIENT_VERSION);
+        if (compressed.IsSmaller()) {
+            ssData << compressed;
+            nSize = ssData.size() | BLOCK_FILE_COMPRESSED;
+            return;
+        }
+    }
+
+    ssData << block;
+    nSize = ssData.size();
+}
+
+// Open a block file at the size field in front of the block at pos
+static FILE *OpenBlockRecord(const CDiskBlockPos &pos) {
+    if (pos.nPos < sizeof(uint32_t))
+        return nullptr;
+
+    return OpenBlockFile(CDiskBlockPos(pos.nFile, pos.nPos - sizeof(uint32_t)), true);
+}
+
+bool WriteBlockToDisk(const CBlockFileRecord &record, CDiskBlockPos &pos) {
     // Open history file to append
     CAutoFile fileout = CAutoFile(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
     if (!fileout)
         return ERRORMSG("WriteBlockToDisk : OpenBlockFile failed");
 
     // Write index header
-    uint32_t nSize = fileout.GetSerializeSize(block);
-    fileout << FLATDATA(SysCfg().MessageStart()) << nSize;
+    fileout << FLATDATA(SysCfg().MessageStart()) << record.nSize;
 
     // Write block
     int32_t fileOutPos = ftell(fileout);
     if (fileOutPos < 0)
         return ERRORMSG("WriteBlockToDisk : ftell failed");
     pos.nPos = (uint32_t)fileOutPos;
-    fileout << block;
+    fileout.write(&record.ssData[0], record.ssData.size());
 
-    // Flush stdio buffers and commit to disk before returning
+    // Flush stdio buffers, the file is committed by FlushBlockFile()
     fflush(fileout);
-    if (!IsInitialBlockDownload())
-        FileCommit(fileout);
 
     return true;
 }
 
+bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos) {
+    return WriteBlockToDisk(CBlockFileRecord(block), pos);
+}
+
 bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block) {
     block.SetNull();
 
     // Open history file to read
-    CAutoFile filein = CAutoFile(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    CAutoFile filein = CAutoFile(OpenBlockRecord(pos), SER_DISK, CLIENT_VERSION);
     if (!filein)
         return ERRORMSG("ReadBlockFromDisk : OpenBlockFile failed");
 
     // Read block
     try {
-        filein >> block;
+        uint32_t nSize = 0;
+        filein >> nSize;
+        if (nSize & BLOCK_FILE_COMPRESSED) {
+            CCompressedBlock compressed;
+            filein >> compressed;
+            if (!compressed.Decompress(block, SER_DISK, CLIENT_VERSION))
+                return ERRORMSG("ReadBlockFromDisk : decompress block failed, %s", pos.ToString());
+        } else {
+            filein >> block;
+        }
+    } catch (std::exception &e) {
+        return ERRORMSG("Deserialize or I/O error - %s", e.what());
+    }
+
+    return true;
+}
+
+bool ReadBlockDiskSize(const CDiskBlockPos &pos, uint32_t &nDiskSize) {
+    CAutoFile filein = CAutoFile(OpenBlockRecord(pos), SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("ReadBlockDiskSize : OpenBlockFile failed");
+
+    try {
+        uint32_t nSize = 0;
+        filein >> nSize;
+        nDiskSize = (nSize & ~BLOCK_FILE_COMPRESSED) + MESSAGE_START_SIZE + sizeof(nSize);
+    } catch (std::exception &e) {
+        return ERRORMSG("Deserialize or I/O error - %s", e.what());
+    }
+
+    return true;
+}
+
+bool ReadBlockHeader(CAutoFile &filein, CBlockHeader &header) {
+    try {
+        uint32_t nSize = 0;
+        filein >> nSize;
+        if (nSize & BLOCK_FILE_COMPRESSED) {
+            CCompressedBlock compressed;
+            filein >> compressed;
+            vector<char> vchBlock;
+            if (!compressed.Decompress(vchBlock))
+                return ERRORMSG("ReadBlockHeader : decompress block failed");
+
+            CDataStream ss(vchBlock, SER_DISK, CLIENT_VERSION);
+            ss >> header;
+        } else {
+            filein >> header;
+        }
+    } catch (std::exception &e) {
+        return ERRORMSG("Deserialize or I/O error - %s", e.what());
+    }
+
+    return true;
+}
+
+bool ReadBlockHeaderFromDisk(const CDiskBlockPos &pos, CBlockHeader &header) {
+    CAutoFile filein = CAutoFile(OpenBlockRecord(pos), SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("ReadBlockHeaderFromDisk : OpenBlockFile failed");
+
+    return ReadBlockHeader(filein, header);
+}
+
+bool ReadTxFromBlockFile(const CDiskTxPos &pos, CBlockHeader &header, std::shared_ptr<CBaseTx> &pTx) {
+    CAutoFile filein = CAutoFile(OpenBlockRecord(pos), SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("ReadTxFromBlockFile : OpenBlockFile failed");
+
+    try {
+        uint32_t nSize = 0;
+        filein >> nSize;
+        if (nSize & BLOCK_FILE_COMPRESSED) {
+            // nTxOffset is an offset into the raw block, so the whole block has to be decompressed
+            CCompressedBlock compressed;
+            filein >> compressed;
+            vector<char> vchBlock;
+            if (!compressed.Decompress(vchBlock))
+                return ERRORMSG("ReadTxFromBlockFile : decompress block failed, %s", pos.ToString());
+
+            CDataStream ss(vchBlock, SER_DISK, CLIENT_VERSION);
+            ss >> header;
+            ss.ignore(pos.nTxOffset);
+            ss >> pTx;
+        } else {
+            filein >> header;
+            fseek(filein, pos.nTxOffset, SEEK_CUR);
+            filein >> pTx;
+        }
     } catch (std::exception &e) {
         return ERRORMSG("Deserialize or I/O error - %s", e.what());
     }
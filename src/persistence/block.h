@@ -185,6 +185,41 @@ public:
     void Print() const;
 };
 
+/** A serialized block compressed with CompressZstd(), as stored in block files (-compressblocks) and
+ *  sent in "zblock" messages */
+class CCompressedBlock {
+public:
+    uint32_t nRawSize;          // size of the serialized block
+    vector<uint8_t> vData;
+
+    CCompressedBlock() : nRawSize(0) {}
+    CCompressedBlock(const CBlock &block, int32_t nType, int32_t nVersion);
+
+    // Compression is only worth it when it actually saves space, and vData is empty if it failed
+    bool IsSmaller() const { return !vData.empty() && vData.size() + sizeof(nRawSize) + 5 < nRawSize; }
+
+    bool Decompress(vector<char> &vchBlock) const;
+    bool Decompress(CBlock &block, int32_t nType, int32_t nVersion) const;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(nRawSize);
+        READWRITE(vData);
+    )
+};
+
+/** A block serialized the way it is written to a block file: compressed with -compressblocks when it
+ *  saves space, raw otherwise. The size field in front of it has BLOCK_FILE_COMPRESSED set when compressed. */
+class CBlockFileRecord {
+public:
+    uint32_t nSize;             // size field, with the compressed flag
+    CDataStream ssData;
+
+    explicit CBlockFileRecord(const CBlock &block);
+
+    // Bytes taken in the block file, including the message start and the size field
+    uint32_t GetDiskSize() const { return ssData.size() + MESSAGE_START_SIZE + sizeof(nSize); }
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -449,9 +484,17 @@ struct CBlockLocator {
 };
 
 /** Functions for disk access for blocks */
+bool WriteBlockToDisk(const CBlockFileRecord &record, CDiskBlockPos &pos);
 bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos);
 bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block);
 bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block);
+// Size of the record of an already stored block, including its header
+bool ReadBlockDiskSize(const CDiskBlockPos &pos, uint32_t &nDiskSize);
+// Read the header of a block record, the file must be positioned at the size field of the record
+bool ReadBlockHeader(CAutoFile &filein, CBlockHeader &header);
+bool ReadBlockHeaderFromDisk(const CDiskBlockPos &pos, CBlockHeader &header);
+// Read a transaction and the header of its block through the tx index position
+bool ReadTxFromBlockFile(const CDiskTxPos &pos, CBlockHeader &header, std::shared_ptr<CBaseTx> &pTx);
 
 
 bool ReadBaseTxFromDisk(const CTxCord txCord, std::shared_ptr<CBaseTx> &pTx);
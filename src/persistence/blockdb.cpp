@@ -84,19 +84,8 @@ CBlockIndex *InsertBlockIndex(uint256 hash) {
     if (hash.IsNull())
         return nullptr;
 
-    // Return existing
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hash);
-    if (mi != mapBlockIndex.end())
-        return (*mi).second;
-
-    // Create new
-    CBlockIndex *pIndexNew = new CBlockIndex();
-    if (!pIndexNew)
-        throw runtime_error("new CBlockIndex failed");
-    mi                    = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
-    pIndexNew->pBlockHash = &((*mi).first);
-
-    return pIndexNew;
+    // Return existing or create new
+    return mapBlockIndex.emplace(hash).first->second;
 }
 
 
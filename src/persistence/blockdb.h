@@ -94,6 +94,15 @@ public:
         finality_block_cache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        tx_diskpos_cache.RegisterForgetFunc(forgetDataFuncMap);
+        flag_cache.RegisterForgetFunc(forgetDataFuncMap);
+        best_block_hash_cache.RegisterForgetFunc(forgetDataFuncMap);
+        last_block_file_cache.RegisterForgetFunc(forgetDataFuncMap);
+        reindex_cache.RegisterForgetFunc(forgetDataFuncMap);
+        finality_block_cache.RegisterForgetFunc(forgetDataFuncMap);
+    }
+
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool SetTxIndex(const uint256 &txid, const CDiskTxPos &pos);
     bool WriteTxIndexes(const vector<pair<uint256, CDiskTxPos> > &list);
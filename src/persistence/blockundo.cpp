@@ -6,6 +6,8 @@
 #include "blockundo.h"
 #include "main.h"
 
+CBlockUndoWriter undoWriter;
+
 /** Open an undo file (rev?????.dat) */
 FILE *OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly) {
     return OpenDiskFile(pos, "rev", fReadOnly);
@@ -63,15 +65,17 @@ bool CBlockUndo::WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash) {
 
     fileout << hasher.GetHash();
 
-    // Flush stdio buffers and commit to disk before returning
+    // Flush stdio buffers, the file is committed by FlushBlockFile()
     fflush(fileout);
-    if (!IsInitialBlockDownload())
-        FileCommit(fileout);
 
     return true;
 }
 
 bool CBlockUndo::ReadFromDisk(const CDiskBlockPos &pos, const uint256 &blockHash) {
+    // The requested undo data may still be queued
+    if (!undoWriter.Flush())
+        return ERRORMSG("CBlockUndo::ReadFromDisk : flush undo writer failed");
+
     // Open history file to read
     CAutoFile filein = CAutoFile(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (!filein)
@@ -106,6 +110,96 @@ string CBlockUndo::ToString() const {
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// class CBlockUndoWriter
+
+void CBlockUndoWriter::Push(const CDiskBlockPos &pos, const uint256 &prevBlockHash, CBlockUndo &&blockUndo,
+                            const CDiskBlockIndex &blockIndex) {
+    boost::unique_lock<boost::mutex> lock(cs_queue);
+    // Don't let the writer fall too far behind
+    while (queueRecords.size() >= MAX_UNDO_WRITE_QUEUE && !fFailed)
+        condQueue.wait(lock);
+
+    queueRecords.push_back({pos, prevBlockHash, std::move(blockUndo), blockIndex});
+    condQueue.notify_all();
+}
+
+bool CBlockUndoWriter::Flush() {
+    boost::unique_lock<boost::mutex> writeLock(cs_write);
+    std::deque<CUndoRecord> records;
+    {
+        boost::unique_lock<boost::mutex> lock(cs_queue);
+        records.swap(queueRecords);
+        condQueue.notify_all();
+    }
+
+    return WriteRecords(records) && !fFailed;
+}
+
+void CBlockUndoWriter::ThreadWrite() {
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> lock(cs_queue);
+            while (queueRecords.empty())
+                condQueue.wait(lock);
+        }
+
+        boost::unique_lock<boost::mutex> writeLock(cs_write);
+        std::deque<CUndoRecord> records;
+        {
+            boost::unique_lock<boost::mutex> lock(cs_queue);
+            records.swap(queueRecords);
+            condQueue.notify_all();
+        }
+
+        if (!WriteRecords(records)) {
+            LogPrint(BCLog::ERROR, "%s(), write undo data failed\n", __FUNCTION__);
+            AbortNode(_("Error: failed to write undo data"));
+            return;
+        }
+    }
+}
+
+bool CBlockUndoWriter::WriteBlockIndexes() {
+    boost::unique_lock<boost::mutex> writeLock(cs_write);
+    if (fFailed)
+        return false;
+
+    for (const auto &blockIndex : vPendingIndexes) {
+        if (!pCdMan->pBlockIndexDb->WriteBlockIndex(blockIndex)) {
+            fFailed = true;
+            return ERRORMSG("%s(), write index of block=%s failed", __FUNCTION__, blockIndex.GetBlockHash().GetHex());
+        }
+    }
+    vPendingIndexes.clear();
+
+    return true;
+}
+
+// Requires cs_write.
+bool CBlockUndoWriter::WriteRecords(std::deque<CUndoRecord> &records) {
+    if (records.empty() || fFailed)
+        return !fFailed;
+
+    int64_t beginTime = GetTimeMicros();
+    for (auto &record : records) {
+        CDiskBlockPos pos = record.pos;
+        if (!record.blockUndo.WriteToDisk(pos, record.prevBlockHash) || pos.nPos != GetUndoDataPos(record.pos)) {
+            fFailed = true;
+            return ERRORMSG("%s(), write undo data of block=%s to rev%05u.dat failed", __FUNCTION__,
+                            record.blockIndex.GetBlockHash().GetHex(), record.pos.nFile);
+        }
+
+        // The index may reference the undo data only once it is committed
+        vPendingIndexes.push_back(record.blockIndex);
+    }
+
+    LogPrint(BCLog::BENCHMARK, "write %u undo records, elapse time: %lld us\n", records.size(),
+             GetTimeMicros() - beginTime);
+
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // class CBlockUndoExecutor
 
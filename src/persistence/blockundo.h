@@ -11,10 +11,15 @@
 #include "cachewrapper.h"
 #include "leveldbwrapper.h"
 #include "disk.h"
+#include "block.h"
 
 #include <stdint.h>
+#include <atomic>
+#include <deque>
 #include <memory>
 
+#include <boost/thread.hpp>
+
 class CTxUndo {
 public:
     uint256     txid;
@@ -86,6 +91,48 @@ public:
     bool Execute();
 };
 
+/**
+ * Writes block undo data on a background thread, without committing it. The block indexes carrying
+ * BLOCK_HAVE_UNDO are held back until FlushBlockFile() has committed the block and undo files, so the index
+ * on disk never points to missing undo data. FlushBlockFile() must run before the chain state referencing
+ * the blocks is flushed.
+ */
+class CBlockUndoWriter {
+public:
+    CBlockUndoWriter() : fFailed(false) {}
+
+    // Queue the undo data for the space reserved at pos, and the block index to write once it is committed.
+    void Push(const CDiskBlockPos &pos, const uint256 &prevBlockHash, CBlockUndo &&blockUndo,
+              const CDiskBlockIndex &blockIndex);
+    // Write all queued undo data in the calling thread, without committing it.
+    bool Flush();
+    // Write the block indexes of the undo data written so far. The caller has committed the undo files.
+    bool WriteBlockIndexes();
+    // Position of the undo data written for the space reserved at pos.
+    static uint32_t GetUndoDataPos(const CDiskBlockPos &pos) { return pos.nPos + MESSAGE_START_SIZE + sizeof(uint32_t); }
+
+    void ThreadWrite();
+
+private:
+    struct CUndoRecord {
+        CDiskBlockPos pos;
+        uint256 prevBlockHash;
+        CBlockUndo blockUndo;
+        CDiskBlockIndex blockIndex;
+    };
+
+    bool WriteRecords(std::deque<CUndoRecord> &records);
+
+    boost::mutex cs_queue;
+    boost::condition_variable condQueue;
+    std::deque<CUndoRecord> queueRecords;
+    boost::mutex cs_write;  // held while records are written, so Flush() also waits for the writer thread
+    std::vector<CDiskBlockIndex> vPendingIndexes;  // indexes of the written, not yet committed undo data
+    std::atomic<bool> fFailed;
+};
+
+extern CBlockUndoWriter undoWriter;
+
 /** Open an undo file (rev?????.dat) */
 FILE *OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 
@@ -161,6 +161,25 @@ UndoDataFuncMap CCacheWrapper::GetUndoDataFuncMap() {
     return undoDataFuncMap;
 }
 
+ForgetDataFuncMap CCacheWrapper::GetForgetDataFuncMap() {
+    ForgetDataFuncMap forgetDataFuncMap;
+    sysParamCache.RegisterForgetFunc(forgetDataFuncMap);
+    blockCache.RegisterForgetFunc(forgetDataFuncMap);
+    accountCache.RegisterForgetFunc(forgetDataFuncMap);
+    assetCache.RegisterForgetFunc(forgetDataFuncMap);
+    contractCache.RegisterForgetFunc(forgetDataFuncMap);
+    delegateCache.RegisterForgetFunc(forgetDataFuncMap);
+    cdpCache.RegisterForgetFunc(forgetDataFuncMap);
+    closedCdpCache.RegisterForgetFunc(forgetDataFuncMap);
+    dexCache.RegisterForgetFunc(forgetDataFuncMap);
+    txReceiptCache.RegisterForgetFunc(forgetDataFuncMap);
+    txUtxoCache.RegisterForgetFunc(forgetDataFuncMap);
+    axcCache.RegisterForgetFunc(forgetDataFuncMap);
+    sysGovernCache.RegisterForgetFunc(forgetDataFuncMap);
+    priceFeedCache.RegisterForgetFunc(forgetDataFuncMap);
+    return forgetDataFuncMap;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // class CCacheDBManager
 
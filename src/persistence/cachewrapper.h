@@ -61,6 +61,7 @@ public:
     void Flush();
 
     UndoDataFuncMap GetUndoDataFuncMap();
+    ForgetDataFuncMap GetForgetDataFuncMap();
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMap);
 
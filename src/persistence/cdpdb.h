@@ -83,6 +83,15 @@ public:
         cdp_height_index_cache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        cdp_global_data_cache.RegisterForgetFunc(forgetDataFuncMap);
+        cdp_cache.RegisterForgetFunc(forgetDataFuncMap);
+        cdp_bcoin_cache.RegisterForgetFunc(forgetDataFuncMap);
+        user_cdp_cache.RegisterForgetFunc(forgetDataFuncMap);
+        cdp_ratio_index_cache.RegisterForgetFunc(forgetDataFuncMap);
+        cdp_height_index_cache.RegisterForgetFunc(forgetDataFuncMap);
+    }
+
     uint32_t GetCacheSize() const;
     bool Flush();
 private:
@@ -165,6 +174,11 @@ public:
         closedCdpTxCache.RegisterUndoFunc(undoDataFuncMap);
         closedTxCdpCache.RegisterUndoFunc(undoDataFuncMap);
     }
+
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        closedCdpTxCache.RegisterForgetFunc(forgetDataFuncMap);
+        closedTxCdpCache.RegisterForgetFunc(forgetDataFuncMap);
+    }
 public:
     /*  CCompositeKVCache     prefixType     key               value             variable  */
     /*  ----------------   --------------   ------------   --------------    ----- --------*/
@@ -125,6 +125,14 @@ public:
         contractLogsCache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        contractCache.RegisterForgetFunc(forgetDataFuncMap);
+        contractDataCache.RegisterForgetFunc(forgetDataFuncMap);
+        contractAccountCache.RegisterForgetFunc(forgetDataFuncMap);
+        contractTracesCache.RegisterForgetFunc(forgetDataFuncMap);
+        contractLogsCache.RegisterForgetFunc(forgetDataFuncMap);
+    }
+
     shared_ptr<CDBContractDataIterator> CreateContractDataIterator(const CRegID &contractRegid,
         const string &contractKeyPrefix);
 
@@ -8,6 +8,7 @@
 
 #include "dbconf.h"
 #include "dbaccess.h"
+#include "commons/arena.h"
 
 #include <map>
 #include <memory>
@@ -15,6 +16,9 @@
 typedef void(UndoDataFunc)(const CDbOpLogs &pDbOpLogs);
 typedef std::map<dbk::PrefixType, std::function<UndoDataFunc>> UndoDataFuncMap;
 
+typedef void(ForgetDataFunc)(const std::vector<std::string> &keys);
+typedef std::map<dbk::PrefixType, std::function<ForgetDataFunc>> ForgetDataFuncMap;
+
 template<typename ValueType>
 struct __CacheValue {
     std::shared_ptr<ValueType> value = std::make_shared<ValueType>();
@@ -57,8 +61,9 @@ public:
 
     using CacheValue = __CacheValue<ValueType>;
 
-    typedef typename std::map<KeyType, CacheValue> Map;
-    typedef typename std::map<KeyType, CacheValue>::iterator Iterator;
+    // nodes come from the arena of the scope the cache is constructed in, see CArenaScope
+    typedef std::map<KeyType, CacheValue, std::less<KeyType>, CArenaAllocator<std::pair<const KeyType, CacheValue>>> Map;
+    typedef typename Map::iterator Iterator;
 public:
     /**
      * Default constructor, must use set base to initialize before using.
@@ -221,6 +226,24 @@ public:
         undoDataFuncMap[GetPrefixType()] = std::bind(&CCompositeKVCache::UndoDataList, this, std::placeholders::_1);
     }
 
+    // drop the entries of the serialized keys, they are fetched from the base again on next access
+    void ForgetDataList(const std::vector<std::string> &keys) {
+        for (const auto &keyStr : keys) {
+            KeyType key;
+            CDataStream ssKey(keyStr, SER_DISK, CLIENT_VERSION);
+            ssKey >> key;
+            auto it = mapData.find(key);
+            if (it != mapData.end()) {
+                DecDataSize(GetValueBy(it));
+                mapData.erase(it);
+            }
+        }
+    }
+
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        forgetDataFuncMap[GetPrefixType()] = std::bind(&CCompositeKVCache::ForgetDataList, this, std::placeholders::_1);
+    }
+
     dbk::PrefixType GetPrefixType() const { return PREFIX_TYPE; }
 
     CDBAccess* GetDbAccessPtr() {
@@ -239,7 +262,12 @@ private:
         Iterator it = mapData.find(key);
         if (it != mapData.end()) {
             return it;
-        } else if (pBase != nullptr) {
+        }
+
+        if (pDbOpLogMap != nullptr && pDbOpLogMap->IsReadLogEnabled())
+            pDbOpLogMap->AddReadKey(PREFIX_TYPE, key);
+
+        if (pBase != nullptr) {
             // find key-value at base cache
             auto baseIt = pBase->GetDataIt(key);
             if (baseIt != pBase->mapData.end()) {
@@ -490,6 +518,15 @@ public:
         undoDataFuncMap[GetPrefixType()] = std::bind(&CSimpleKVCache::UndoDataList, this, std::placeholders::_1);
     }
 
+    // drop the value, it is fetched from the base again on next access
+    void ForgetDataList(const std::vector<std::string> &keys) {
+        cache_value = nullptr;
+    }
+
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        forgetDataFuncMap[GetPrefixType()] = std::bind(&CSimpleKVCache::ForgetDataList, this, std::placeholders::_1);
+    }
+
     dbk::PrefixType GetPrefixType() const { return PREFIX_TYPE; }
 
     std::shared_ptr<ValueType> GetDataPtr() {
@@ -501,6 +538,9 @@ private:
     void FetchData() const {
 
         if (!cache_value) {
+            if (pDbOpLogMap != nullptr && pDbOpLogMap->IsReadLogEnabled())
+                pDbOpLogMap->AddReadKey(PREFIX_TYPE);
+
             if (pBase != nullptr){
                 pBase->FetchData();
                 if (pBase->cache_value) {
@@ -186,6 +186,14 @@ public:
         }
         return spIt;
     }
+
+    // same as Create(cache), but spBottomIt is used in place of the db iterator of the bottom cache
+    static shared_ptr<CDBCacheIteratorImpl> Create(CacheType &cache, shared_ptr<Base> spBottomIt) {
+        if (cache.GetBasePtr() != nullptr)
+            return make_shared<CDBCacheIteratorImpl>(cache, Create(*cache.GetBasePtr(), spBottomIt));
+
+        return make_shared<CDBCacheIteratorImpl>(cache, spBottomIt);
+    }
 public:
     CDBCacheIteratorImpl(CacheType &dbCacheIn, shared_ptr<Base> spBaseItIn)
         : Base(dbCacheIn), sp_map_it(make_shared<CacheMapIt>(dbCacheIn)), sp_base_it(spBaseItIn) {}
@@ -304,6 +312,9 @@ public:
     CDbIterator(CacheType &dbCacheIn): sp_it_Impl(IteratorImpl::Create(dbCacheIn)){
 
     }
+
+    CDbIterator(CacheType &dbCacheIn, shared_ptr<CDBBaseIterator<CacheType>> spBottomIt)
+        : sp_it_Impl(IteratorImpl::Create(dbCacheIn, spBottomIt)) {}
     virtual bool First() {
         return sp_it_Impl->First();
     }
@@ -28,6 +28,26 @@ CRegID CTopDelegatesIterator::GetRegId() const {
     return CRegID(GetKey().second);
 }
 
+void CTopDelegatesIndex::Load(CVoteRegIdCache &dbCache) {
+    keys.clear();
+    CDBAccessIterator<CVoteRegIdCache> dbIt(dbCache);
+    for (dbIt.First(); dbIt.IsValid(); dbIt.Next()) {
+        keys.insert(dbIt.GetKey());
+    }
+}
+
+void CTopDelegatesIndex::Update(const CVoteRegIdCache::Map &mapData) {
+    for (const auto &item : mapData) {
+        if (!item.second.is_modified)
+            continue;
+
+        if (item.second.IsValueEmpty())
+            keys.erase(item.first);
+        else
+            keys.insert(item.first);
+    }
+}
+
 bool CDelegateDBCache::GetTopVoteDelegates(uint32_t delegateNum, uint64_t BpMinVote,
                                            VoteDelegateVector &topVoteDelegates, bool isR3Fork) {
 
@@ -168,6 +188,10 @@ bool CDelegateDBCache::GetVoterList(map<CRegIDKey, vector<CCandidateReceivedVote
 }
 
 bool CDelegateDBCache::Flush() {
+    // votes about to be written to the db
+    if (spTopDelegates && voteRegIdCache.GetBasePtr() == nullptr)
+        spTopDelegates->Update(voteRegIdCache.GetMapData());
+
     voteRegIdCache.Flush();
     regId2VoteCache.Flush();
     last_vote_height_cache.Flush();
@@ -194,5 +218,9 @@ void CDelegateDBCache::Clear() {
 }
 
 shared_ptr<CTopDelegatesIterator> CDelegateDBCache::CreateTopDelegateIterator() {
+    if (spTopDelegates)
+        return make_shared<CTopDelegatesIterator>(
+            voteRegIdCache, make_shared<CTopDelegatesIndexIterator>(voteRegIdCache, *spTopDelegates));
+
     return make_shared<CTopDelegatesIterator>(voteRegIdCache);
 }
\ No newline at end of file
@@ -37,6 +37,72 @@ public:
     CRegID GetRegId() const;
 };
 
+/**
+ * In-memory copy of the vote keys stored in the db, ordered like the VOTE index (votes from big to
+ * small). It is loaded once at startup and kept up to date when CDelegateDBCache::Flush() writes
+ * votes to the db, so that finding the top delegates costs O(K) instead of a db scan. Guarded by
+ * cs_main like the rest of the chain state.
+ */
+class CTopDelegatesIndex {
+public:
+    typedef CVoteRegIdCache::KeyType KeyType;
+
+    void Load(CVoteRegIdCache &dbCache);
+    void Update(const CVoteRegIdCache::Map &mapData);
+
+    const std::set<KeyType> &GetKeys() const { return keys; }
+
+private:
+    std::set<KeyType> keys;
+};
+
+// Iterates a CTopDelegatesIndex in place of the db iterator of CVoteRegIdCache
+class CTopDelegatesIndexIterator: public CDBBaseIterator<CVoteRegIdCache> {
+public:
+    typedef CDBBaseIterator<CVoteRegIdCache> Base;
+
+    CTopDelegatesIndexIterator(CVoteRegIdCache &dbCache, const CTopDelegatesIndex &index)
+        : Base(dbCache), keys(index.GetKeys()), it(keys.end()) {}
+
+    bool First() {
+        it = keys.begin();
+        return ProcessData();
+    }
+
+    bool Seek(const KeyType *pKey) {
+        if (pKey == nullptr || db_util::IsEmpty(*pKey))
+            return First();
+        it = keys.lower_bound(*pKey);
+        return ProcessData();
+    }
+
+    bool SeekUpper(const KeyType *pKey) {
+        if (pKey == nullptr || db_util::IsEmpty(*pKey))
+            return First();
+        it = keys.upper_bound(*pKey);
+        return ProcessData();
+    }
+
+    bool Next() {
+        assert(this->IsValid());
+        it++;
+        return ProcessData();
+    }
+
+private:
+    const std::set<KeyType> &keys;
+    std::set<KeyType>::const_iterator it;
+
+    bool ProcessData() {
+        this->is_valid = (it != keys.end());
+        if (this->is_valid) {
+            *this->sp_key   = *it;
+            *this->sp_value = 1;
+        }
+        return this->is_valid;
+    }
+};
+
 class CDelegateDBCache {
 public:
     CDelegateDBCache() {}
@@ -45,14 +111,18 @@ public:
           regId2VoteCache(pDbAccess),
           last_vote_height_cache(pDbAccess),
           pending_delegates_cache(pDbAccess),
-          active_delegates_cache(pDbAccess) {}
+          active_delegates_cache(pDbAccess),
+          spTopDelegates(make_shared<CTopDelegatesIndex>()) {
+        spTopDelegates->Load(voteRegIdCache);
+    }
 
     CDelegateDBCache(CDelegateDBCache *pBaseIn)
         : voteRegIdCache(pBaseIn->voteRegIdCache),
         regId2VoteCache(pBaseIn->regId2VoteCache),
         last_vote_height_cache(pBaseIn->last_vote_height_cache),
         pending_delegates_cache(pBaseIn->pending_delegates_cache),
-        active_delegates_cache(pBaseIn->active_delegates_cache) {}
+        active_delegates_cache(pBaseIn->active_delegates_cache),
+        spTopDelegates(pBaseIn->spTopDelegates) {}
 
     bool GetTopVoteDelegates(uint32_t delegateNum, uint64_t delegateVoteMin,
                              VoteDelegateVector &topVoteDelegates, bool isR3Fork);
@@ -89,6 +159,7 @@ public:
         last_vote_height_cache.SetBase(&pBaseIn->last_vote_height_cache);
         pending_delegates_cache.SetBase(&pBaseIn->pending_delegates_cache);
         active_delegates_cache.SetBase(&pBaseIn->active_delegates_cache);
+        spTopDelegates = pBaseIn->spTopDelegates;
     }
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
@@ -107,6 +178,14 @@ public:
         active_delegates_cache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        voteRegIdCache.RegisterForgetFunc(forgetDataFuncMap);
+        regId2VoteCache.RegisterForgetFunc(forgetDataFuncMap);
+        last_vote_height_cache.RegisterForgetFunc(forgetDataFuncMap);
+        pending_delegates_cache.RegisterForgetFunc(forgetDataFuncMap);
+        active_delegates_cache.RegisterForgetFunc(forgetDataFuncMap);
+    }
+
     shared_ptr<CTopDelegatesIterator> CreateTopDelegateIterator();
 public:
 /*  CCompositeKVCache  prefixType     key                              value                   variable       */
@@ -123,6 +202,9 @@ public:
     CSimpleKVCache<dbk::ACTIVE_DELEGATES, ActiveDelegatesStore> active_delegates_cache;
 
     vector<CRegID> delegateRegIds;
+
+    // shared by all the caches layered on the same db
+    shared_ptr<CTopDelegatesIndex> spTopDelegates;
 };
 
 #endif // PERSIST_DELEGATEDB_H
\ No newline at end of file
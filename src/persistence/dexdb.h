@@ -120,6 +120,14 @@ public:
         operator_last_id_cache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        activeOrderCache.RegisterForgetFunc(forgetDataFuncMap);
+        blockOrdersCache.RegisterForgetFunc(forgetDataFuncMap);
+        operator_detail_cache.RegisterForgetFunc(forgetDataFuncMap);
+        operator_owner_map_cache.RegisterForgetFunc(forgetDataFuncMap);
+        operator_last_id_cache.RegisterForgetFunc(forgetDataFuncMap);
+    }
+
 private:
     DEXBlockOrdersCache::KeyType MakeBlockOrderKey(const uint256 &orderid, const dex::CDEXOrderDetail &activeOrder) {
         return make_tuple(CFixedUInt32(activeOrder.tx_cord.GetHeight()), (uint8_t)activeOrder.generate_type, orderid);
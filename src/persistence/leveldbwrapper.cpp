@@ -41,6 +41,23 @@ std::string CDBOpLogMap::ToString() const {
     return str;
 }
 
+void CDBOpLogMap::GetWrittenKeys(set<CDbKey> &keys) const {
+    for (const auto &itemOpLogs : mapDbOpLogs) {
+        dbk::PrefixType prefixType = dbk::ParseKeyPrefixType(itemOpLogs.first);
+        for (const auto &dbOpLog : itemOpLogs.second)
+            keys.emplace(prefixType, dbOpLog.GetKey());
+    }
+}
+
+uint64_t CDBOpLogMap::GetDataSize() const {
+    uint64_t size = 0;
+    for (const auto &itemOpLogs : mapDbOpLogs) {
+        for (const auto &dbOpLog : itemOpLogs.second)
+            size += dbOpLog.GetKey().size() + dbOpLog.GetValue().size();
+    }
+    return size;
+}
+
 static leveldb::Options GetOptions(size_t nCacheSize) {
     leveldb::Options options;
     options.block_cache       = leveldb::NewLRUCache(nCacheSize / 2);
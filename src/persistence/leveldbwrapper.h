@@ -15,6 +15,7 @@
 #include <boost/filesystem/path.hpp>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
+#include <set>
 
 using namespace json_spirit;
 
@@ -84,6 +85,9 @@ public:
 
 typedef vector<CDbOpLog> CDbOpLogs;
 
+// key prefix type and SER_DISK serialized key of a cache entry
+typedef std::pair<dbk::PrefixType, string> CDbKey;
+
 class CDBOpLogMap {
 public:
     map<string, CDbOpLogs>& GetMap() { return mapDbOpLogs; }
@@ -104,7 +108,30 @@ public:
         mapDbOpLogs[prefix].push_back(dbOpLogIn);
     }
 
-    void Clear() { mapDbOpLogs.clear(); }
+    // besides the writes, record the keys fetched from the base caches, they are not serialized
+    void EnableReadLog() { fLogReads = true; }
+    bool IsReadLogEnabled() const { return fLogReads; }
+
+    template<typename K>
+    void AddReadKey(dbk::PrefixType prefixType, const K &key) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << key;
+        setReadKeys.emplace(prefixType, ssKey.str());
+    }
+
+    void AddReadKey(dbk::PrefixType prefixType) { setReadKeys.emplace(prefixType, string()); }
+
+    const set<CDbKey>& GetReadKeys() const { return setReadKeys; }
+
+    // keys of the op logs
+    void GetWrittenKeys(set<CDbKey> &keys) const;
+    // bytes of the keys and values of the op logs
+    uint64_t GetDataSize() const;
+
+    void Clear() {
+        mapDbOpLogs.clear();
+        setReadKeys.clear();
+    }
 
     std::string ToString() const;
 public:
@@ -113,6 +140,8 @@ public:
 	)
 private:
     mutable map<string, CDbOpLogs> mapDbOpLogs; // dbName -> dbOpLogs
+    set<CDbKey> setReadKeys;
+    bool fLogReads = false;
 };
 
 class leveldb_error : public runtime_error
@@ -41,6 +41,10 @@ public:
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         executeFailCache.RegisterUndoFunc(undoDataFuncMap);
     }
+
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        executeFailCache.RegisterForgetFunc(forgetDataFuncMap);
+    }
 public:
 /*  CCompositeKVCache    prefixType             key                 value                        variable      */
 /*  -------------------- --------------------- ------------------  ---------------------------  -------------- */
@@ -116,6 +116,11 @@ public:
         median_price_cache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        price_feed_coin_pairs_cache.RegisterForgetFunc(forgetDataFuncMap);
+        median_price_cache.RegisterForgetFunc(forgetDataFuncMap);
+    }
+
     bool AddFeedCoinPair(const PriceCoinPair &coinPair);
     bool EraseFeedCoinPair(const PriceCoinPair &coinPair);
     bool HasFeedCoinPair(const PriceCoinPair &coinPair);
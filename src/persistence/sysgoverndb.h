@@ -139,6 +139,12 @@ public:
         approvals_cache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        governors_cache.RegisterForgetFunc(forgetDataFuncMap);
+        proposals_cache.RegisterForgetFunc(forgetDataFuncMap);
+        approvals_cache.RegisterForgetFunc(forgetDataFuncMap);
+    }
+
 public:
 /*  CSimpleKVCache          prefixType             value           variable           */
 /*  -------------------- --------------------   -------------   --------------------- */
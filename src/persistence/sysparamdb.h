@@ -131,6 +131,15 @@ public:
         current_total_bps_size_cache.RegisterUndoFunc(undoDataFuncMap);
         new_total_bps_size_cache.RegisterUndoFunc(undoDataFuncMap);
     }
+
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        sys_param_chache.RegisterForgetFunc(forgetDataFuncMap);
+        miner_fee_cache.RegisterForgetFunc(forgetDataFuncMap);
+        cdp_param_cache.RegisterForgetFunc(forgetDataFuncMap);
+        cdp_interest_param_changes_cache.RegisterForgetFunc(forgetDataFuncMap);
+        current_total_bps_size_cache.RegisterForgetFunc(forgetDataFuncMap);
+        new_total_bps_size_cache.RegisterForgetFunc(forgetDataFuncMap);
+    }
     bool SetParam(const SysParamType& key, const uint64_t& value){
         return sys_param_chache.SetData(key, CVarIntValue(value));
     }
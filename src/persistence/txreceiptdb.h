@@ -49,6 +49,11 @@ public:
         tx_receipt_cache.RegisterUndoFunc(undoDataFuncMap);
         block_receipt_cache.RegisterUndoFunc(undoDataFuncMap);
     }
+
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        tx_receipt_cache.RegisterForgetFunc(forgetDataFuncMap);
+        block_receipt_cache.RegisterForgetFunc(forgetDataFuncMap);
+    }
 public:
 /*       type               prefixType               key                     value                 variable               */
 /*  ----------------   -------------------------   -----------------------  ------------------   ------------------------ */
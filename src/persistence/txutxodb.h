@@ -57,6 +57,11 @@ public:
         tx_utxo_password_proof_cache.RegisterUndoFunc(undoDataFuncMap);
     }
 
+    void RegisterForgetFunc(ForgetDataFuncMap &forgetDataFuncMap) {
+        tx_utxo_cache.RegisterForgetFunc(forgetDataFuncMap);
+        tx_utxo_password_proof_cache.RegisterForgetFunc(forgetDataFuncMap);
+    }
+
 public:
 /*       type               prefixType               key                     value                 variable               */
 /*  ----------------   -------------------------   -----------------------  ------------------   ------------------------ */
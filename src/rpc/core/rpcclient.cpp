@@ -170,6 +170,7 @@ Array RPCConvertValues(const string &strMethod, const vector<string> &strParams)
 
     /** for mining */
     if (strMethod == "getminedblocks"           && n > 0) ConvertTo<int64_t>(params[0]);
+    if (strMethod == "getminedblocks"           && n > 1) ConvertTo<bool>(params[1]);
     if (strMethod == "getminerbyblocktime"      && n > 0) ConvertTo<int64_t>(params[0]);
     if (strMethod == "getminerbyblocktime"      && n > 1) ConvertTo<int64_t>(params[1]);
 
@@ -209,6 +210,7 @@ Array RPCConvertValues(const string &strMethod, const vector<string> &strParams)
     if (strMethod == "startcontracttpstest"     && n > 1)    ConvertTo<int64_t>(params[1]);
     if (strMethod == "startcontracttpstest"     && n > 2)    ConvertTo<int64_t>(params[2]);
     if (strMethod == "getblockfailures"         && n > 0)    ConvertTo<int32_t>(params[0]);
+    if (strMethod == "getreorgstats"            && n > 0)    ConvertTo<int32_t>(params[0]);
 
     /* for cdp */
     if (strMethod == "submitpricefeedtx"        && n > 1) ConvertTo<Array>(params[1]);
@@ -149,6 +149,7 @@ extern Value getcontractassets(const  Array& params, bool fHelp);
 extern Value getfcoingenesistxinfo(const Array& params, bool fHelp);
 extern Value getblockcount(const Array& params, bool fHelp);
 extern Value getrawmempool(const Array& params, bool fHelp);
+extern Value getmempoolinfo(const Array& params, bool fHelp);
 extern Value getblock(const Array& params, bool fHelp);
 extern Value verifychain(const Array& params, bool fHelp);
 extern Value getcontractregid(const Array& params, bool fHelp);
@@ -158,6 +159,7 @@ extern Value reconsiderblock(const Array& params, bool fHelp);
 extern Value getblockfailures(const Array& params, bool fHelp);
 extern Value getblockundo(const Array& params, bool fHelp);
 extern Value getpbftinfo(const Array& params, bool fHelp);
+extern Value getreorgstats(const Array& params, bool fHelp);
 
 /******************************  Lua VM *********************************/
 extern Value luavm_executescript(const Array& params, bool fHelp);
@@ -38,10 +38,12 @@ static const CRPCCommand vRPCCommands[] =
     { "getblockcount",                  &getblockcount,                     true,      true,        false   },
     { "getblock",                       &getblock,                          true,      false,       false   },
     { "getrawmempool",                  &getrawmempool,                     true,      false,       false   },
+    { "getmempoolinfo",                 &getmempoolinfo,                    true,      false,       false   },
     { "verifychain",                    &verifychain,                       true,      false,       false   },
     { "getblockundo",                   &getblockundo,                      true,      false,       false   },
     { "getswapcoindetail",              &getswapcoindetail,                 true,      false,       false   },
     { "getpbftinfo",                    &getpbftinfo,                       true,      false,       false   },
+    { "getreorgstats",                  &getreorgstats,                     true,      false,       false   },
 
     { "gettotalcoins",                  &gettotalcoins,                     true,      false,       false   },
     { "invalidateblock",                &invalidateblock,                   true,      true,        false   },
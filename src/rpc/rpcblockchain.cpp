@@ -18,6 +18,8 @@
 #include "tx/tx.h"
 #include "tx/coinminttx.h"
 #include "miner/pbftmanager.h"
+#include "chain/reorgstats.h"
+#include "commons/histogram.h"
 
 using namespace json_spirit;
 using namespace std;
@@ -171,6 +173,37 @@ Value getrawmempool(const Array& params, bool fHelp)
     }
 }
 
+Value getmempoolinfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getmempoolinfo\n"
+            "\nReturns the size and the limits of the memory pool.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\" : n,                 (numeric) number of transactions\n"
+            "  \"bytes\" : n,                (numeric) serialized size of the transactions\n"
+            "  \"usage\" : n,                (numeric) bytes of the transactions, their cache overlay and indexes\n"
+            "  \"max_mempool\" : n,          (numeric) -maxmempool in bytes\n"
+            "  \"max_sender_txes\" : n,      (numeric) -maxmempoolsender, 0 for no limit\n"
+            "  \"min_fee_per_kb\" : n,       (numeric) fee per KB in sawi a new transaction must pay\n"
+            "  \"evicted\" : n               (numeric) transactions evicted since startup\n"
+            "}\n"
+            "\nExamples\n" +
+            HelpExampleCli("getmempoolinfo", "") + "\nAs json rpc\n" + HelpExampleRpc("getmempoolinfo", ""));
+
+    LOCK(mempool.cs);
+    Object obj;
+    obj.push_back(Pair("size",              (int64_t)mempool.memPoolTxs.size()));
+    obj.push_back(Pair("bytes",             mempool.GetTxBytes()));
+    obj.push_back(Pair("usage",             mempool.GetUsageBytes()));
+    obj.push_back(Pair("max_mempool",       mempool.GetMaxBytes()));
+    obj.push_back(Pair("max_sender_txes",   (int64_t)mempool.GetMaxSenderTxs()));
+    obj.push_back(Pair("min_fee_per_kb",    mempool.GetMinFeePerKb()));
+    obj.push_back(Pair("evicted",           mempool.GetEvictedCount()));
+    return obj;
+}
+
 Value getblock(const Array& params, bool fHelp) {
     if (fHelp || params.size() < 1 || params.size() > 3) {
         throw runtime_error(
@@ -495,3 +528,75 @@ Value getpbftinfo(const Array& params, bool fHelp) {
     return obj;
 }
 
+Value getreorgstats(const Array& params, bool fHelp) {
+    if (fHelp || params.size() > 1) {
+        throw runtime_error(
+            "getreorgstats (\"count\")\n"
+            "\nGet the cost of the latest reorgs of the active chain, and the latency histograms of fork choice,\n"
+            "reorgs and block connection. Times are in microseconds.\n"
+            "\nArguments:\n"
+            "1.\"count\"   (numeric, optional) number of latest reorgs to list, default is 10\n"
+            "\nResult:\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getreorgstats", "20") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("getreorgstats", "20"));
+    }
+
+    int32_t count = params.size() > 0 ? params[0].get_int() : 10;
+    if (count < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "count must not be negative");
+
+    Array reorgs;
+    for (const auto &record : reorgStats.GetRecent(count)) {
+        Object reorg;
+        reorg.push_back(Pair("time",                record.nTime));
+        reorg.push_back(Pair("old_tip_height",      record.nOldTipHeight));
+        reorg.push_back(Pair("old_tip_hash",        record.oldTipHash.GetHex()));
+        reorg.push_back(Pair("new_tip_height",      record.nNewTipHeight));
+        reorg.push_back(Pair("new_tip_hash",        record.newTipHash.GetHex()));
+        reorg.push_back(Pair("fork_height",         record.nForkHeight));
+        reorg.push_back(Pair("global_fin_height",   record.nGlobalFinHeight));
+        reorg.push_back(Pair("depth",               (int64_t)record.GetDepth()));
+        reorg.push_back(Pair("disconnected",        (int64_t)record.nDisconnected));
+        reorg.push_back(Pair("connected",           (int64_t)record.nConnected));
+        reorg.push_back(Pair("total_time",          record.nTotalTime));
+        reorg.push_back(Pair("disconnect_time",     record.nDisconnectTime));
+        reorg.push_back(Pair("connect_time",        record.nConnectTime));
+        reorg.push_back(Pair("undo_read_time",      record.nUndoReadTime));
+        reorg.push_back(Pair("cache_flush_time",    record.nCacheFlushTime));
+        reorg.push_back(Pair("mempool_resurrect_time", record.nResurrectTime));
+        reorgs.push_back(reorg);
+    }
+
+    Object histograms;
+    for (const auto &item : histogramRegistry.GetAll()) {
+        const CHistogram &histogram = *item.second;
+        Object histObj;
+        histObj.push_back(Pair("count", histogram.GetCount()));
+        histObj.push_back(Pair("sum",   histogram.GetSum()));
+        histObj.push_back(Pair("max",   histogram.GetMax()));
+        histObj.push_back(Pair("p50",   histogram.GetPercentile(0.5)));
+        histObj.push_back(Pair("p90",   histogram.GetPercentile(0.9)));
+        histObj.push_back(Pair("p99",   histogram.GetPercentile(0.99)));
+
+        // bucket upper bound (exclusive) -> count
+        Object buckets;
+        vector<uint64_t> counts = histogram.GetBuckets();
+        for (size_t i = 0; i < counts.size(); i++) {
+            if (counts[i] > 0)
+                buckets.push_back(Pair(strprintf("%llu", CHistogram::GetBucketLimit(i)), counts[i]));
+        }
+        histObj.push_back(Pair("buckets", buckets));
+
+        histograms.push_back(Pair(item.first, histObj));
+    }
+
+    Object obj;
+    obj.push_back(Pair("reorg_count",   reorgStats.GetCount()));
+    obj.push_back(Pair("reorgs",        reorgs));
+    obj.push_back(Pair("histograms",    histograms));
+
+    return obj;
+}
+
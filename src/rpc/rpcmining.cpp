@@ -175,13 +175,16 @@ Value submitblock(const Array& params, bool fHelp) {
 
 
 Value getminedblocks(const Array& params, bool fHelp) {
-    if (fHelp || params.size() > 1) {
+    if (fHelp || params.size() > 2) {
         throw runtime_error(
-            "getminedblocks\n"
+            "getminedblocks (count verbose)\n"
             "\nReturns a json array containing the blocks mined by this node."
             "\nArguments:\n"
             "1. count         (numeric, optional) If provided, get the specified count blocks,\n"
             "                                     otherwise get all nodes.\n"
+            "2. verbose       (bool, optional) If true, add how the txes of each block were packed, default is false.\n"
+            "                                  Times are in microseconds, the histograms of all the packed blocks\n"
+            "                                  are listed by getreorgstats under the miner. prefix.\n"
             "\nResult:\n"
             "[\n"
             "  {\n"
@@ -196,16 +199,20 @@ Value getminedblocks(const Array& params, bool fHelp) {
             "    \"blocksize\": n          (numeric) block size (bytes)\n"
             "    \"hash\": xxx             (string) block hash\n"
             "    \"preblockhash\": xxx     (string) pre block hash\n"
+            "    \"pack_stats\": {...}     (object) verbose only, txes tried, included and rejected by reason,\n"
+            "                              execution time by tx type, packing time cut-off, median price and\n"
+            "                              cdp force settle times\n"
             "  }\n"
             "]\n"
             "\nExamples:\n" +
-            HelpExampleCli("getminedblocks", "") + "\nAs json rpc call\n" + HelpExampleRpc("getminedblocks", ""));
+            HelpExampleCli("getminedblocks", "10 true") + "\nAs json rpc call\n" + HelpExampleRpc("getminedblocks", "10, true"));
     }
 
     unsigned int count = (unsigned int)-1;
-    if (params.size() == 1) {
+    if (params.size() > 0) {
         count = params[0].get_uint64();
     }
+    bool fVerbose = params.size() > 1 && params[1].get_bool();
 
     Array ret;
 
@@ -221,6 +228,36 @@ Value getminedblocks(const Array& params, bool fHelp) {
         obj.push_back(Pair("block_size",    blockInfo.totalBlockSize));
         obj.push_back(Pair("txid",          blockInfo.hash.ToString()));
         obj.push_back(Pair("preblockhash",  blockInfo.hashPrevBlock.ToString()));
+        if (fVerbose) {
+            const BlockPackStats &stats = blockInfo.packStats;
+            Object statsObj;
+            statsObj.push_back(Pair("tried_tx_count",       (int64_t)stats.triedTxCount));
+            statsObj.push_back(Pair("included_tx_count",    (int64_t)stats.includedTxCount));
+            statsObj.push_back(Pair("rejected_tx_count",    (int64_t)stats.rejectedTxCount));
+            statsObj.push_back(Pair("template_tx_count",    (int64_t)stats.templateTxCount));
+            statsObj.push_back(Pair("cutoff_tx_count",      (int64_t)stats.cutOffTxCount));
+            statsObj.push_back(Pair("cutoff_time",          stats.cutOffTime));
+            statsObj.push_back(Pair("pack_time",            stats.packTime));
+            statsObj.push_back(Pair("exec_time",            stats.execTime));
+            statsObj.push_back(Pair("median_price_time",    stats.medianPriceTime));
+            statsObj.push_back(Pair("force_settle_time",    stats.forceSettleTime));
+
+            Object reasons;
+            for (const auto &item : stats.rejectReasons)
+                reasons.push_back(Pair(item.first, (int64_t)item.second));
+            statsObj.push_back(Pair("reject_reasons", reasons));
+
+            Object txTypes;
+            for (const auto &item : stats.txTypes) {
+                Object typeObj;
+                typeObj.push_back(Pair("count",     (int64_t)item.second.count));
+                typeObj.push_back(Pair("exec_time", item.second.execTime));
+                txTypes.push_back(Pair(item.first, typeObj));
+            }
+            statsObj.push_back(Pair("tx_types", txTypes));
+
+            obj.push_back(Pair("pack_stats", statsObj));
+        }
         ret.push_back(obj);
     }
 
@@ -16,8 +16,12 @@
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #include "persistence/blockundo.h"
+#include "chain/orphanpool.h"
 
 #include <stdint.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 #include <boost/assign/list_of.hpp>
 #include "commons/json/json_spirit_utils.h"
@@ -660,14 +664,12 @@ Value getmemstat(const Array& params, bool fHelp) {
     {
         Object statObj;
         statObj.push_back(Pair("count", (int64_t)mapBlockIndex.size()));
-        uint64_t totalSz = 0;
-        if (mapBlockIndex.size() > 0) {
-            const auto &idx = *mapBlockIndex.rbegin()->second;
-            // need to calc size for each idx?
-            totalSz = sizeof(mapBlockIndex) + mapBlockIndex.size() * (sizeof(idx));
-        }
+        uint64_t totalSz = mapBlockIndex.GetMemoryUsage();
         statObj.push_back(Pair("size", SizeToString(totalSz)));
         statObj.push_back(Pair("size_bytes", totalSz));
+        uint64_t millionSz = mapBlockIndex.GetMemoryUsagePerMillion();
+        statObj.push_back(Pair("size_per_1m_blocks", SizeToString(millionSz)));
+        statObj.push_back(Pair("size_per_1m_blocks_bytes", millionSz));
 
         obj.push_back(Pair("block_index_map", statObj));
     }
@@ -736,11 +738,7 @@ Value getmemstat(const Array& params, bool fHelp) {
         {
             LOCK(mempool.cs);
             statObj.push_back(Pair("count", (int64_t)mempool.memPoolTxs.size()));
-            if (mempool.memPoolTxs.size() > 0) {
-                const auto &item = *mempool.memPoolTxs.rbegin();
-                // need to calc size for each idx?
-                totalSz = sizeof(mempool.memPoolTxs) + mempool.memPoolTxs.size() * (sizeof(item));
-            }
+            totalSz = sizeof(mempool.memPoolTxs) + mempool.GetUsageBytes();
         }
         statObj.push_back(Pair("size", SizeToString(totalSz)));
         statObj.push_back(Pair("size_bytes", totalSz));
@@ -749,6 +747,54 @@ Value getmemstat(const Array& params, bool fHelp) {
 
     }
 
+    // orphan blocks and txes
+    {
+        LOCK(cs_main);
+        Object blockObj;
+        blockObj.push_back(Pair("count", (uint64_t)orphanBlocks.Size()));
+        blockObj.push_back(Pair("mem_size", SizeToString(orphanBlocks.GetMemBytes())));
+        blockObj.push_back(Pair("mem_size_bytes", orphanBlocks.GetMemBytes()));
+        blockObj.push_back(Pair("disk_size", SizeToString(orphanBlocks.GetDiskBytes())));
+        blockObj.push_back(Pair("disk_size_bytes", orphanBlocks.GetDiskBytes()));
+        blockObj.push_back(Pair("spilled", orphanBlocks.GetSpilledCount()));
+        obj.push_back(Pair("orphan_blocks", blockObj));
+
+        Object txObj;
+        txObj.push_back(Pair("count", (uint64_t)orphanTxs.Size()));
+        txObj.push_back(Pair("size", SizeToString(orphanTxs.GetBytes())));
+        txObj.push_back(Pair("size_bytes", orphanTxs.GetBytes()));
+        obj.push_back(Pair("orphan_txs", txObj));
+    }
+
+    // arena of the caches of the block being connected
+    {
+        Object statObj;
+        statObj.push_back(Pair("blocks", connectBlockArena.GetReleaseCount()));
+        statObj.push_back(Pair("allocs", connectBlockArena.GetAllocCount()));
+        statObj.push_back(Pair("last_block_bytes", (uint64_t)connectBlockArena.GetLastUsedBytes()));
+        statObj.push_back(Pair("peak_block_bytes", (uint64_t)connectBlockArena.GetPeakUsedBytes()));
+        uint64_t reservedSz = connectBlockArena.GetReservedBytes();
+        statObj.push_back(Pair("size", SizeToString(reservedSz)));
+        statObj.push_back(Pair("size_bytes", reservedSz));
+
+        obj.push_back(Pair("block_arena", statObj));
+    }
+
+#ifdef __GLIBC__
+    // what the heap looks like to glibc malloc, to weigh the arena against
+    {
+        struct mallinfo mi = mallinfo();
+        Object statObj;
+        statObj.push_back(Pair("heap_bytes", (uint64_t)(uint32_t)mi.arena));
+        statObj.push_back(Pair("mmap_bytes", (uint64_t)(uint32_t)mi.hblkhd));
+        statObj.push_back(Pair("in_use_bytes", (uint64_t)(uint32_t)mi.uordblks));
+        statObj.push_back(Pair("free_bytes", (uint64_t)(uint32_t)mi.fordblks));
+        statObj.push_back(Pair("free_chunks", (int64_t)mi.ordblks));
+
+        obj.push_back(Pair("malloc", statObj));
+    }
+#endif
+
     return obj;
 }
 
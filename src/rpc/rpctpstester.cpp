@@ -62,7 +62,7 @@ public:
 
             if (generationQueue->Pop(&tx)) {
                 LOCK(cs_main);
-                if (!::AcceptToMemoryPool(mempool, state, tx.get(), true)) {
+                if (!::AcceptToMemoryPool(mempool, state, tx, true)) {
                     LogPrint(BCLog::ERROR, "TpsTester::SendTx, accept to mempool failed: %s\n", state.GetRejectReason());
                     throw boost::thread_interrupted();
                 }
@@ -0,0 +1,97 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sigcheckqueue.h"
+
+#include <algorithm>
+
+#include <boost/thread.hpp>
+
+#include "main.h"
+
+CSigCheckQueue sigCheckQueue;
+
+void CSigCheckQueue::RunChecks(const std::vector<CSignatureCheck> &checks, std::vector<uint8_t> &results) {
+    size_t i;
+    while ((i = nNext.fetch_add(1, std::memory_order_relaxed)) < checks.size()) {
+        const CSignatureCheck &check = checks[i];
+        results[i] = ::VerifySignature(check.sigHash, *check.pSignature, check.pubKey) ? 1 : 0;
+    }
+}
+
+bool CSigCheckQueue::Verify(const std::vector<CSignatureCheck> &checks, std::vector<uint8_t> &results) {
+    results.assign(checks.size(), 0);
+
+    boost::unique_lock<boost::mutex> batchLock(csBatch, boost::defer_lock);
+    if (checks.size() >= MIN_PARALLEL_CHECKS && GetWorkerCount() > 0)
+        batchLock.try_lock();
+
+    if (!batchLock.owns_lock()) {
+        for (size_t i = 0; i < checks.size(); i++)
+            results[i] = ::VerifySignature(checks[i].sigHash, *checks[i].pSignature, checks[i].pubKey) ? 1 : 0;
+    } else {
+        // the workers hold pointers to checks and results until nActive drops to 0, do not leave before
+        boost::this_thread::disable_interruption noInterruption;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            nNext.store(0, std::memory_order_relaxed);
+            pChecks  = &checks;
+            pResults = &results;
+            nBatch++;
+        }
+        condWork.notify_all();
+
+        RunChecks(checks, results);
+
+        boost::unique_lock<boost::mutex> lock(cs);
+        while (nActive > 0)
+            condDone.wait(lock);
+        pChecks  = nullptr;
+        pResults = nullptr;
+    }
+
+    return std::all_of(results.begin(), results.end(), [](uint8_t result) { return result != 0; });
+}
+
+void CSigCheckQueue::ThreadCheck() {
+    uint64_t nLastBatch;
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        nLastBatch = nBatch;
+    }
+    nWorkers++;
+
+    try {
+        while (true) {
+            const std::vector<CSignatureCheck> *pBatchChecks;
+            std::vector<uint8_t> *pBatchResults;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                while (nBatch == nLastBatch)
+                    condWork.wait(lock);
+
+                nLastBatch = nBatch;
+                if (pChecks == nullptr)  // the batch is over already
+                    continue;
+
+                pBatchChecks  = pChecks;
+                pBatchResults = pResults;
+                nActive++;
+            }
+
+            RunChecks(*pBatchChecks, *pBatchResults);
+
+            boost::unique_lock<boost::mutex> lock(cs);
+            if (--nActive == 0)
+                condDone.notify_all();
+        }
+    } catch (const boost::thread_interrupted &) {
+        nWorkers--;
+        throw;
+    }
+}
+
+bool VerifySignatures(const std::vector<CSignatureCheck> &checks, std::vector<uint8_t> &results) {
+    return sigCheckQueue.Verify(checks, results);
+}
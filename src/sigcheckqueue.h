@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_SIGCHECKQUEUE_H
+#define COIN_SIGCHECKQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "commons/uint256.h"
+#include "entities/key.h"
+
+/** One (hash, signature, pubkey) tuple of a batch, the signature must outlive the batch. */
+struct CSignatureCheck {
+    uint256 sigHash;
+    const std::vector<uint8_t> *pSignature;
+    CPubKey pubKey;
+
+    CSignatureCheck(const uint256 &sigHashIn, const std::vector<uint8_t> &signatureIn, const CPubKey &pubKeyIn)
+        : sigHash(sigHashIn), pSignature(&signatureIn), pubKey(pubKeyIn) {}
+};
+
+/**
+ * Shares the checks of a signature batch between the calling thread and the -sigcheckthreads workers.
+ * Checks are handed out one at a time, so a slow one does not hold up the rest. One batch runs at a
+ * time: a caller finding the workers busy, or with a batch too small to be worth waking them, verifies
+ * its batch alone.
+ */
+class CSigCheckQueue {
+public:
+    static const size_t MIN_PARALLEL_CHECKS = 8;
+
+    CSigCheckQueue() : nNext(0), nWorkers(0) {}
+
+    /** results[i] is set to 1 if checks[i] verifies, 0 otherwise. Returns true if all of them verify. */
+    bool Verify(const std::vector<CSignatureCheck> &checks, std::vector<uint8_t> &results);
+
+    /** Worker thread body. */
+    void ThreadCheck();
+
+    int32_t GetWorkerCount() const { return nWorkers.load(std::memory_order_relaxed); }
+
+private:
+    void RunChecks(const std::vector<CSignatureCheck> &checks, std::vector<uint8_t> &results);
+
+    boost::mutex csBatch;  // held by the caller whose batch is being run
+    boost::mutex cs;       // guards the fields below
+    boost::condition_variable condWork;
+    boost::condition_variable condDone;
+    const std::vector<CSignatureCheck> *pChecks = nullptr;
+    std::vector<uint8_t> *pResults = nullptr;
+    uint64_t nBatch = 0;   // bumped for every batch handed to the workers
+    int32_t nActive = 0;   // workers running checks of the current batch
+
+    std::atomic<size_t> nNext;  // next check of the current batch to run
+    std::atomic<int32_t> nWorkers;
+};
+
+extern CSigCheckQueue sigCheckQueue;
+
+/** Verify a batch of signatures with the signature cache and the sigcheck workers. */
+bool VerifySignatures(const std::vector<CSignatureCheck> &checks, std::vector<uint8_t> &results);
+
+#endif  // COIN_SIGCHECKQUEUE_H
@@ -0,0 +1,78 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "commons/arena.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(arena_tests)
+
+typedef map<uint32_t, string, less<uint32_t>, CArenaAllocator<pair<const uint32_t, string>>> ArenaMap;
+
+BOOST_AUTO_TEST_CASE(arena_scope_test)
+{
+    CArena arena;
+    BOOST_CHECK(CArena::Current() == nullptr);
+
+    ArenaMap heapMap;
+    {
+        CArenaReleaser arenaReleaser(arena);
+        unique_ptr<ArenaMap> pArenaMap;
+        {
+            CArenaScope arenaScope(arena);
+            BOOST_CHECK(CArena::Current() == &arena);
+            pArenaMap.reset(new ArenaMap());
+        }
+        BOOST_CHECK(CArena::Current() == nullptr);
+
+        // the map keeps to the arena it was constructed with
+        for (uint32_t n = 0; n < 10000; n++)
+            pArenaMap->emplace(n, to_string(n));
+        uint64_t nAllocs = arena.GetAllocCount();
+        BOOST_CHECK(nAllocs >= 10000);
+        BOOST_CHECK(arena.GetUsedBytes() >= 10000 * sizeof(pair<const uint32_t, string>));
+
+        // maps constructed and copied outside of any scope take the heap
+        for (const auto &item : *pArenaMap)
+            heapMap.insert(item);
+        ArenaMap copyMap(*pArenaMap);
+        BOOST_CHECK_EQUAL(arena.GetAllocCount(), nAllocs);
+        BOOST_CHECK(copyMap == *pArenaMap);
+
+        pArenaMap.reset();
+    }
+
+    BOOST_CHECK_EQUAL(arena.GetUsedBytes(), 0U);
+    BOOST_CHECK_EQUAL(arena.GetReleaseCount(), 1U);
+    BOOST_CHECK(arena.GetLastUsedBytes() > 0);
+    BOOST_CHECK_EQUAL(heapMap.size(), 10000U);
+    BOOST_CHECK_EQUAL(heapMap[9999], "9999");
+}
+
+BOOST_AUTO_TEST_CASE(arena_reuse_test)
+{
+    CArena arena;
+    size_t nChunkSize = CArena::CHUNK_SIZE;
+    for (int32_t round = 0; round < 3; round++) {
+        CArenaReleaser arenaReleaser(arena);
+        for (uint32_t n = 0; n < 1000; n++) {
+            void *p = arena.Allocate(24, 8);
+            BOOST_CHECK(((uintptr_t)p & 7) == 0);
+        }
+        // large allocations take their own memory
+        arena.Allocate(nChunkSize, 16);
+    }
+
+    // the chunks are kept from one round to the next
+    BOOST_CHECK_EQUAL(arena.GetReservedBytes(), nChunkSize);
+    BOOST_CHECK_EQUAL(arena.GetReleaseCount(), 3U);
+    BOOST_CHECK_EQUAL(arena.GetPeakUsedBytes(), 1000 * 24 + nChunkSize);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
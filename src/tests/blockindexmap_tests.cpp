@@ -0,0 +1,98 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain/blockindexmap.h"
+
+#include <cstring>
+#include <map>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(blockindexmap_tests)
+
+static uint256 MakeHash(uint32_t n) {
+    uint256 hash;
+    memcpy(hash.begin(), &n, sizeof(n));
+    return hash;
+}
+
+BOOST_AUTO_TEST_CASE(insert_find_erase_test)
+{
+    CBlockIndexMap blockIndexMap;
+    map<uint256, int32_t> expected;
+
+    BOOST_CHECK(blockIndexMap.empty());
+    BOOST_CHECK(blockIndexMap.find(MakeHash(1)) == blockIndexMap.end());
+    BOOST_CHECK(blockIndexMap[MakeHash(1)] == nullptr);
+
+    for (uint32_t n = 0; n < 20000; n++) {
+        uint256 hash = MakeHash(n);
+        auto ret     = blockIndexMap.emplace(hash);
+        BOOST_CHECK(ret.second);
+        ret.first->second->height = n;
+        BOOST_CHECK(ret.first->second->GetBlockHash() == hash);
+        expected[hash] = n;
+    }
+    BOOST_CHECK(!blockIndexMap.emplace(MakeHash(7)).second);
+    BOOST_CHECK_EQUAL(blockIndexMap.size(), expected.size());
+
+    // erase every third entry, the others must stay reachable through the shifted probe runs
+    for (uint32_t n = 0; n < 20000; n += 3) {
+        BOOST_CHECK_EQUAL(blockIndexMap.erase(MakeHash(n)), 1U);
+        expected.erase(MakeHash(n));
+    }
+    BOOST_CHECK_EQUAL(blockIndexMap.erase(MakeHash(0)), 0U);
+    BOOST_CHECK_EQUAL(blockIndexMap.size(), expected.size());
+
+    for (const auto &item : expected) {
+        CBlockIndex *pIndex = blockIndexMap[item.first];
+        BOOST_CHECK(pIndex != nullptr && pIndex->height == item.second);
+    }
+    BOOST_CHECK(blockIndexMap.count(MakeHash(3)) == 0);
+
+    size_t nCount = 0;
+    for (const auto &item : blockIndexMap) {
+        BOOST_CHECK(expected.count(item.first));
+        BOOST_CHECK(item.second->GetBlockHash() == item.first);
+        nCount++;
+    }
+    BOOST_CHECK_EQUAL(nCount, expected.size());
+
+    for (uint32_t n = 0; n < 20000; n += 3)
+        blockIndexMap.emplace(MakeHash(n));
+    BOOST_CHECK_EQUAL(blockIndexMap.size(), 20000U);
+
+    blockIndexMap.clear();
+    BOOST_CHECK(blockIndexMap.empty());
+    BOOST_CHECK(blockIndexMap.begin() == blockIndexMap.end());
+    BOOST_CHECK(blockIndexMap.GetMemoryUsagePerMillion() > 1000000 * sizeof(CBlockIndex));
+}
+
+BOOST_AUTO_TEST_CASE(erased_entry_not_reused_test)
+{
+    CBlockIndexMap blockIndexMap;
+    CBlockIndex *pOld = blockIndexMap.emplace(MakeHash(1)).first->second;
+    pOld->height      = 1;
+    CBlockIndex *pNext = blockIndexMap.emplace(MakeHash(2)).first->second;
+    pNext->pprev       = pOld;
+
+    // a pointer kept after erase still sees the erased block, a new entry never takes its place
+    BOOST_CHECK_EQUAL(blockIndexMap.erase(MakeHash(1)), 1U);
+    CBlockIndex *pNew = blockIndexMap.emplace(MakeHash(3)).first->second;
+    pNew->height      = 3;
+
+    BOOST_CHECK(pNew != pOld);
+    BOOST_CHECK(blockIndexMap[MakeHash(1)] == nullptr);
+    BOOST_CHECK(pNext->pprev->GetBlockHash() == MakeHash(1));
+    BOOST_CHECK_EQUAL(pNext->pprev->height, 1);
+
+    // and the same hash indexed again gets a fresh entry
+    CBlockIndex *pAgain = blockIndexMap.emplace(MakeHash(1)).first->second;
+    BOOST_CHECK(pAgain != pOld);
+    BOOST_CHECK_EQUAL(pOld->height, 1);
+    BOOST_CHECK_EQUAL(blockIndexMap.size(), 3U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
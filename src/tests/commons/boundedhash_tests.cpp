@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "commons/boundedhash.h"
+
+#include <cstring>
+#include <deque>
+#include <set>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(commons_boundedhash_tests)
+
+static uint256 MakeKey(uint32_t n) {
+    uint256 key;
+    memcpy(key.begin(), &n, sizeof(n));
+    return key;
+}
+
+// Test that a FIFO set keeps the last max_size() keys, with a ring slot lost for each erased key until the
+// eviction gets to it
+BOOST_AUTO_TEST_CASE(boundedhash_fifo_like_window)
+{
+    const size_t MAX_SIZE = 100;
+    CBoundedHashSet set(MAX_SIZE);
+    deque<pair<uint256, bool>> ring;  // inserted keys in order, second is false once erased
+    std::set<uint256> live;
+
+    for (int i = 0; i < 20000; i++) {
+        uint256 key = MakeKey(GetRand(4 * MAX_SIZE));
+        bool fNew   = live.insert(key).second;
+        BOOST_CHECK_EQUAL(set.insert(key), fNew);
+        if (fNew) {
+            ring.emplace_back(key, true);
+            if (ring.size() > MAX_SIZE) {
+                if (ring.front().second)
+                    live.erase(ring.front().first);
+                ring.pop_front();
+            }
+        }
+
+        // an erased key may be back in a newer slot, only erase through the live one
+        auto &entry = ring[GetRand(ring.size())];
+        if (GetRand(3) == 0 && entry.second) {
+            BOOST_CHECK(set.erase(entry.first));
+            BOOST_CHECK(!set.erase(entry.first));
+            live.erase(entry.first);
+            entry.second = false;
+        }
+
+        BOOST_CHECK_EQUAL(set.size(), live.size());
+    }
+
+    for (const auto &key : live)
+        BOOST_CHECK(set.count(key));
+}
+
+// Test that the clock eviction keeps a key which is looked up all along, and the map keeps the values
+BOOST_AUTO_TEST_CASE(boundedhash_clock_map)
+{
+    CBoundedHashMap<int64_t> map(64, CBoundedHashMap<int64_t>::CLOCK);
+    BOOST_CHECK(map.insert(MakeKey(0), -1));
+    BOOST_CHECK(!map.insert(MakeKey(0), -2));
+
+    for (uint32_t n = 1; n < 1000; n++) {
+        BOOST_CHECK(map.insert(MakeKey(n), n));
+        BOOST_CHECK(map.count(MakeKey(0)));
+        BOOST_CHECK(map.size() <= 64);
+    }
+    BOOST_CHECK_EQUAL(*map.find(MakeKey(0)), -1);
+    BOOST_CHECK_EQUAL(*map.find(MakeKey(999)), 999);
+    BOOST_CHECK(map.find(MakeKey(1)) == nullptr);
+
+    *map.find(MakeKey(999)) = 5;
+    BOOST_CHECK_EQUAL(*map.find(MakeKey(999)), 5);
+
+    // shrinking keeps the newest entries
+    map.max_size(8);
+    BOOST_CHECK_EQUAL(map.size(), 8U);
+    BOOST_CHECK(map.count(MakeKey(999)));
+    BOOST_CHECK(!map.count(MakeKey(990)));
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(!map.count(MakeKey(999)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,184 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "commons/compress.h"
+#include "commons/util/util.h"
+#include "persistence/block.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(commons_compress_tests)
+
+static void CheckRoundTrip(const vector<uint8_t> &data, const string &msg) {
+    vector<uint8_t> compressed, decompressed;
+    CompressZstd(data.data(), data.size(), compressed);
+    BOOST_CHECK_MESSAGE(DecompressZstd(compressed.data(), compressed.size(), data.size(), decompressed),
+                        msg + " decompress failed");
+    BOOST_CHECK_MESSAGE(decompressed == data, msg + " content error");
+}
+
+BOOST_AUTO_TEST_CASE(zstd_round_trip_test)
+{
+    CheckRoundTrip({}, "empty");
+    CheckRoundTrip({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}, "short");
+
+    vector<uint8_t> repeated(100000, 'a');
+    CheckRoundTrip(repeated, "repeated");
+
+    vector<uint8_t> random(100000);
+    uint32_t seed = 1;
+    for (auto &b : random) {
+        seed = seed * 1103515245 + 12345;
+        b    = seed >> 24;
+    }
+    CheckRoundTrip(random, "random");
+
+    // short distance overlapping matches and a long literal run
+    vector<uint8_t> mixed(random.begin(), random.begin() + 5000);
+    for (size_t i = 0; i < 70000; i++)
+        mixed.push_back(mixed[mixed.size() - 3]);
+    CheckRoundTrip(mixed, "mixed");
+
+    vector<uint8_t> compressed;
+    CompressZstd(repeated.data(), repeated.size(), compressed);
+    BOOST_CHECK(compressed.size() < repeated.size() / 100);
+}
+
+BOOST_AUTO_TEST_CASE(zstd_malformed_test)
+{
+    vector<uint8_t> data(10000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (i % 97) ^ (i / 251);
+
+    vector<uint8_t> compressed, decompressed;
+    CompressZstd(data.data(), data.size(), compressed);
+
+    // the raw size must match exactly
+    BOOST_CHECK(!DecompressZstd(compressed.data(), compressed.size(), data.size() - 1, decompressed));
+    BOOST_CHECK(!DecompressZstd(compressed.data(), compressed.size(), data.size() + 1, decompressed));
+    // truncated input
+    BOOST_CHECK(!DecompressZstd(compressed.data(), compressed.size() / 2, data.size(), decompressed));
+    // not a zstd frame
+    BOOST_CHECK(!DecompressZstd(data.data(), data.size(), data.size(), decompressed));
+    BOOST_CHECK(decompressed.empty());
+}
+
+// Frames written by the reference zstd 1.5.6 command line tool, which the vendored zstd must decompress
+BOOST_AUTO_TEST_CASE(zstd_reference_vectors_test)
+{
+    vector<uint8_t> decompressed;
+
+    // zstd -19, with a content checksum: "WaykiChain" 30 times
+    vector<uint8_t> frame1 = ParseHex("28b52ffd642c008d0000505761796b69436861696e01001f550b12a250d1b2");
+    string text;
+    for (int i = 0; i < 30; i++)
+        text += "WaykiChain";
+    BOOST_CHECK(DecompressZstd(frame1.data(), frame1.size(), text.size(), decompressed));
+    BOOST_CHECK(decompressed == vector<uint8_t>(text.begin(), text.end()));
+
+    // zstd -1 --no-check: (i % 17) * 3 for i in [0, 1000)
+    vector<uint8_t> frame2 = ParseHex("28b52ffd60e802c5000088000306090c0f1215181b1e2124272a2d300100a9533597");
+    vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (i % 17) * 3;
+    BOOST_CHECK(DecompressZstd(frame2.data(), frame2.size(), data.size(), decompressed));
+    BOOST_CHECK(decompressed == data);
+
+    // a corrupted content checksum is rejected
+    frame1.back() ^= 0x01;
+    BOOST_CHECK(!DecompressZstd(frame1.data(), frame1.size(), text.size(), decompressed));
+}
+
+BOOST_AUTO_TEST_CASE(zstd_mutated_input_test)
+{
+    vector<uint8_t> data(20000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (i % 13 == 0) ? (uint8_t)(i * 7) : (uint8_t)(i / 64);
+
+    vector<uint8_t> compressed, decompressed;
+    CompressZstd(data.data(), data.size(), compressed);
+
+    // corrupted payloads come from peers, they must be rejected or decompress to exactly rawSize bytes
+    uint32_t seed = 7;
+    for (int i = 0; i < 5000; i++) {
+        vector<uint8_t> mutated = compressed;
+        for (int n = 0; n < 1 + i % 4; n++) {
+            seed = seed * 1103515245 + 12345;
+            mutated[(seed >> 8) % mutated.size()] = seed >> 24;
+        }
+        if (DecompressZstd(mutated.data(), mutated.size(), data.size(), decompressed))
+            BOOST_CHECK_EQUAL(decompressed.size(), data.size());
+        else
+            BOOST_CHECK(decompressed.empty());
+    }
+}
+
+static void CheckBlockHeaderRecord(const CBlock &block, bool fCompressed) {
+    CBlockFileRecord record(block);
+    BOOST_CHECK_EQUAL((record.nSize & BLOCK_FILE_COMPRESSED) != 0, fCompressed);
+
+    // the same layout as a block file from the size field on, which is where GetTxConfirmHeight reads it
+    CAutoFile file(tmpfile(), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!!file);
+    file << record.nSize;
+    file.write(&record.ssData[0], record.ssData.size());
+    rewind(file);
+
+    CBlockHeader header;
+    BOOST_CHECK(ReadBlockHeader(file, header));
+    BOOST_CHECK_EQUAL(header.GetHeight(), block.GetHeight());
+    BOOST_CHECK(header.GetHash() == block.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(compressed_block_header_test)
+{
+    CBlock block;
+    block.SetHeight(12345);
+    block.SetPrevBlockHash(uint256S("0x01"));
+    block.SetSignature(vector<unsigned char>(3000, 0x5a));
+
+    bool fCompressBlocks = SysCfg().IsCompressBlocks();
+    SysCfg().SetCompressBlocks(true);
+    CheckBlockHeaderRecord(block, true);
+    SysCfg().SetCompressBlocks(false);
+    CheckBlockHeaderRecord(block, false);
+    SysCfg().SetCompressBlocks(fCompressBlocks);
+
+    // a failed compression is never taken for a smaller block
+    CCompressedBlock failed;
+    failed.nRawSize = 3000;
+    BOOST_CHECK(!failed.IsSmaller());
+}
+
+BOOST_AUTO_TEST_CASE(compressed_genesis_block_test)
+{
+    // real block data: the reward and delegate txes of the genesis block
+    const CBlock &genesis = SysCfg().GenesisBlock();
+    CDataStream ssGenesis(SER_NETWORK, PROTOCOL_VERSION);
+    ssGenesis << genesis;
+
+    CCompressedBlock compressed(genesis, SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK_EQUAL(compressed.nRawSize, ssGenesis.size());
+    BOOST_REQUIRE(!compressed.vData.empty());
+
+    CBlock block;
+    BOOST_REQUIRE(compressed.Decompress(block, SER_NETWORK, PROTOCOL_VERSION));
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << block;
+    BOOST_CHECK(ssBlock.str() == ssGenesis.str());
+    BOOST_CHECK(block.GetHash() == genesis.GetHash());
+
+    // and through a block file record, the way ReadBlockFromDisk and GetTxConfirmHeight read it
+    bool fCompressBlocks = SysCfg().IsCompressBlocks();
+    SysCfg().SetCompressBlocks(true);
+    CheckBlockHeaderRecord(genesis, compressed.IsSmaller());
+    SysCfg().SetCompressBlocks(fCompressBlocks);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
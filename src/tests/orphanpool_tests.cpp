@@ -0,0 +1,136 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain/orphanpool.h"
+#include "commons/util/util.h"
+#include "persistence/block.h"
+
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(orphanpool_tests)
+
+static CBlock MakeBlock(uint32_t height, const uint256 &prevHash, size_t nSigSize) {
+    CBlock block;
+    block.SetHeight(height);
+    block.SetNonce(height);
+    block.SetPrevBlockHash(prevHash);
+    block.SetSignature(vector<unsigned char>(nSigSize, (unsigned char)height));
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(orphanpool_spill_test)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+                                   boost::filesystem::unique_path("orphanblocks-%%%%%%%%.tmp");
+    COrphanBlockPool pool;
+    pool.Init(path, 8 * 1024, 1024 * 1024);
+
+    // a chain of orphans on top of a missing parent, the large ones and the ones past 8KB are spilled
+    uint256 rootPrevHash = uint256S("0x01");
+    uint256 prevHash     = rootPrevHash;
+    vector<uint256> hashes;
+    for (uint32_t height = 10; height < 16; height++) {
+        CBlock block = MakeBlock(height, prevHash, height % 2 == 0 ? 3000 : COrphanBlockPool::SPILL_BLOCK_SIZE);
+        prevHash = block.GetHash();
+        hashes.push_back(prevHash);
+        BOOST_CHECK(pool.Add(block, prevHash));
+    }
+    BOOST_CHECK_EQUAL(pool.Size(), 6U);
+    BOOST_CHECK(pool.GetMemBytes() <= 8 * 1024);
+    BOOST_CHECK(pool.GetSpilledCount() >= 3);
+    BOOST_CHECK(boost::filesystem::exists(path));
+    BOOST_CHECK(pool.GetRoot(hashes.back()) == hashes.front());
+
+    // the blocks come back whole, in memory or not, and the spill file goes away with the last of them
+    prevHash = rootPrevHash;
+    for (uint32_t height = 10; height < 16; height++) {
+        vector<CBlock> blocks;
+        pool.TakeChildren(prevHash, blocks);
+        BOOST_CHECK_EQUAL(blocks.size(), 1U);
+        BOOST_CHECK_EQUAL(blocks[0].GetHeight(), height);
+        BOOST_CHECK(blocks[0].GetHash() == hashes[height - 10]);
+        prevHash = blocks[0].GetHash();
+    }
+    BOOST_CHECK_EQUAL(pool.Size(), 0U);
+    BOOST_CHECK_EQUAL(pool.GetDiskBytes(), 0U);
+    BOOST_CHECK(!boost::filesystem::exists(path));
+}
+
+BOOST_AUTO_TEST_CASE(orphanpool_budget_test)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+                                   boost::filesystem::unique_path("orphanblocks-%%%%%%%%.tmp");
+    COrphanBlockPool pool;
+    pool.Init(path, 8 * 1024, 8 * 1024);
+
+    // both budgets together hold four of these blocks, the lower ones push the higher ones out
+    for (uint32_t height = 107; height >= 100; height--) {
+        CBlock block = MakeBlock(height, uint256S("0x02"), 3000);
+        BOOST_CHECK(pool.Add(block, block.GetHash()));
+    }
+    BOOST_CHECK_EQUAL(pool.Size(), 4U);
+
+    // a higher block does not get in, a lower one takes the place of the highest
+    CBlock highBlock = MakeBlock(200, uint256S("0x02"), 3000);
+    BOOST_CHECK(!pool.Add(highBlock, highBlock.GetHash()));
+    size_t nSize = pool.Size();
+    CBlock lowBlock = MakeBlock(50, uint256S("0x02"), 3000);
+    BOOST_CHECK(pool.Add(lowBlock, lowBlock.GetHash()));
+    BOOST_CHECK_EQUAL(pool.Size(), nSize);
+    BOOST_CHECK(pool.Exists(lowBlock.GetHash()));
+    BOOST_CHECK(pool.GetMemBytes() <= 8 * 1024);
+    BOOST_CHECK(pool.GetDiskBytes() <= 8 * 1024);
+
+    pool.Clear();
+    BOOST_CHECK(!boost::filesystem::exists(path));
+}
+
+BOOST_AUTO_TEST_CASE(orphanpool_compact_test)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+                                   boost::filesystem::unique_path("orphanblocks-%%%%%%%%.tmp");
+    boost::filesystem::path pathTmp = path;
+    pathTmp += ".new";
+
+    // blocks of this size are always spilled, the disk budget holds four and a half of them
+    vector<CBlock> blocks;
+    for (uint32_t height = 10; height < 16; height++)
+        blocks.push_back(MakeBlock(height, uint256S(strprintf("0x%x", height)), COrphanBlockPool::SPILL_BLOCK_SIZE));
+    uint64_t nBlockSize = blocks[0].GetSerializeSize(SER_DISK, CLIENT_VERSION);
+
+    COrphanBlockPool pool;
+    pool.Init(path, 8 * 1024, nBlockSize * 9 / 2);
+    for (size_t i = 0; i < 4; i++)
+        BOOST_CHECK(pool.Add(blocks[i], blocks[i].GetHash()));
+    BOOST_CHECK_EQUAL(pool.GetSpilledCount(), 4U);
+
+    // the space of the two taken blocks is reclaimed by compacting the file when the next ones are spilled
+    vector<CBlock> taken;
+    pool.TakeChildren(blocks[1].GetPrevBlockHash(), taken);
+    pool.TakeChildren(blocks[2].GetPrevBlockHash(), taken);
+    BOOST_CHECK_EQUAL(taken.size(), 2U);
+    BOOST_CHECK_EQUAL(pool.GetDiskBytes(), nBlockSize * 2);
+    BOOST_CHECK(pool.Add(blocks[4], blocks[4].GetHash()));
+    BOOST_CHECK(pool.Add(blocks[5], blocks[5].GetHash()));
+    BOOST_CHECK_EQUAL(pool.Size(), 4U);
+    BOOST_CHECK_EQUAL(pool.GetDiskBytes(), nBlockSize * 4);
+    BOOST_CHECK(boost::filesystem::exists(path));
+    BOOST_CHECK(!boost::filesystem::exists(pathTmp));
+
+    // the blocks moved by the compaction and the ones written after it come back whole
+    for (size_t i : {0, 3, 4, 5}) {
+        vector<CBlock> children;
+        pool.TakeChildren(blocks[i].GetPrevBlockHash(), children);
+        BOOST_CHECK_EQUAL(children.size(), 1U);
+        BOOST_CHECK(children.size() == 1 && children[0].GetHash() == blocks[i].GetHash());
+    }
+    BOOST_CHECK_EQUAL(pool.Size(), 0U);
+    BOOST_CHECK(!boost::filesystem::exists(path));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,57 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txadmissionqueue.h"
+
+#include <atomic>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(txadmissionqueue_tests)
+
+BOOST_AUTO_TEST_CASE(txadmissionqueue_order_test)
+{
+    CTxAdmissionQueue queue;
+    // no worker yet, the caller runs the stages itself
+    BOOST_CHECK(!queue.Push([]() {}, []() {}));
+
+    boost::thread_group workers;
+    for (int32_t i = 0; i < 4; i++)
+        workers.create_thread(boost::bind(&CTxAdmissionQueue::ThreadAdmit, &queue));
+    while (queue.GetWorkerCount() < 4)
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+
+    // the checks of the early jobs take longer, the accept stages still run in the push order
+    const int32_t nJobs = 64;
+    vector<int32_t> accepted;
+    atomic<int32_t> nChecked(0), nAccepted(0);
+    for (int32_t i = 0; i < nJobs; i++) {
+        BOOST_CHECK(queue.Push(
+            [i, &nChecked]() {
+                boost::this_thread::sleep_for(boost::chrono::microseconds((nJobs - i) % 8 * 500));
+                nChecked++;
+            },
+            [i, &accepted, &nAccepted]() {
+                accepted.push_back(i);
+                nAccepted++;
+            }));
+    }
+
+    for (int32_t n = 0; n < 10000 && nAccepted < nJobs; n++)
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+
+    workers.interrupt_all();
+    workers.join_all();
+
+    BOOST_CHECK_EQUAL(nChecked.load(), nJobs);
+    BOOST_CHECK_EQUAL(accepted.size(), (size_t)nJobs);
+    for (size_t i = 0; i < accepted.size(); i++)
+        BOOST_CHECK_EQUAL(accepted[i], (int32_t)i);
+    BOOST_CHECK_EQUAL(queue.GetWorkerCount(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,212 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "commons/util/util.h"
+#include "persistence/blockundo.h"
+#include "persistence/cachewrapper.h"
+#include "tx/cointransfertx.h"
+#include "tx/txmempool.h"
+
+#include <functional>
+#include <limits>
+#include <set>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(txmempool_tests)
+
+static const uint64_t TEST_TX_FEES = 10000;
+
+static CKeyID MakeKeyId(uint8_t tag, uint32_t index) {
+    uint160 hash;
+    hash.begin()[0] = 0x3c;
+    hash.begin()[1] = tag;
+    memcpy(hash.begin() + 2, &index, sizeof(index));
+    return CKeyID(hash);
+}
+
+// Writes to the chain state, as a block connected on top of the tip would, logged in blockUndo
+static void ConnectWrites(CBlockUndo &blockUndo, const function<void(CCacheWrapper &)> &writes) {
+    CCacheWrapper cw(pCdMan);
+    {
+        CTxUndoOpLogger opLogger(cw, uint256(), blockUndo);
+        writes(cw);
+    }
+    cw.Flush();
+}
+
+static void DisconnectWrites(CBlockUndo &blockUndo) {
+    CCacheWrapper cw(pCdMan);
+    BOOST_REQUIRE(CBlockUndoExecutor(cw, blockUndo).Execute());
+    cw.Flush();
+}
+
+static void SetFreeBalance(CCacheWrapper &cw, const CKeyID &keyId, uint64_t amount) {
+    CAccount account;
+    BOOST_REQUIRE(cw.accountCache.GetAccount(keyId, account));
+    CAccountToken token = account.GetToken(SYMB::WICC);
+    token.free_amount   = amount;
+    account.SetToken(SYMB::WICC, token);
+    BOOST_REQUIRE(cw.accountCache.SaveAccount(account));
+}
+
+static void AddTransfer(vector<CTxMemPool *> pools, const CRegID &from, const CKeyID &to, uint64_t amount) {
+    CBaseCoinTransferTx tx(from, to, chainActive.Height() + 1, amount, TEST_TX_FEES, "");
+    for (auto pPool : pools) {
+        CValidationState state;
+        BOOST_CHECK(pPool->AddUnchecked(tx.GetHash(), CTxMemPoolEntry(&tx, GetTime(), chainActive.Height()), state));
+    }
+}
+
+static set<uint256> GetTxids(CTxMemPool &pool) {
+    vector<uint256> txids;
+    pool.QueryHash(txids);
+    return set<uint256>(txids.begin(), txids.end());
+}
+
+// the incremental rescan of poolInc keeps the same txes as the full rescan of poolFull, which it must leave
+// on the same account states in the pool caches
+static void CheckSameRescan(CTxMemPool &poolInc, CTxMemPool &poolFull, const vector<CKeyID> &keyIds) {
+    poolInc.ReScanMemPoolTx();
+    poolFull.SetFullRescan();
+    poolFull.ReScanMemPoolTx();
+
+    BOOST_CHECK(GetTxids(poolInc) == GetTxids(poolFull));
+    BOOST_CHECK_EQUAL(poolInc.GetTxPriorities().size(), poolFull.GetTxPriorities().size());
+    BOOST_CHECK_EQUAL(poolInc.GetTxBytes(), poolFull.GetTxBytes());
+    for (const auto &keyId : keyIds) {
+        CAccount accountInc, accountFull;
+        poolInc.cw->accountCache.GetAccount(keyId, accountInc);
+        poolFull.cw->accountCache.GetAccount(keyId, accountFull);
+        BOOST_CHECK_MESSAGE(accountInc.GetToken(SYMB::WICC).free_amount ==
+                            accountFull.GetToken(SYMB::WICC).free_amount, keyId.ToAddress());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(txmempool_incremental_rescan_test)
+{
+    LOCK(cs_main);
+    vector<CBlockUndo> blockUndos(6);
+
+    // alice, bob, carol and dave have registered accounts, the txes pay to new ones
+    vector<CKeyID> keyIds;
+    vector<CRegID> regIds;
+    ConnectWrites(blockUndos[0], [&](CCacheWrapper &cw) {
+        vector<uint64_t> balances = {10, 3, 5, 1};
+        for (uint32_t i = 0; i < balances.size(); i++) {
+            CAccount account(MakeKeyId(1, i));
+            account.regid = CRegID(900100, i);
+            BOOST_REQUIRE(cw.accountCache.SaveAccount(account));
+            SetFreeBalance(cw, account.keyid, balances[i] * COIN);
+            keyIds.push_back(account.keyid);
+            regIds.push_back(account.regid);
+        }
+    });
+    const CKeyID &alice = keyIds[0], &bob = keyIds[1], &dave = keyIds[3];
+    for (uint32_t i = 0; i < 4; i++)
+        keyIds.push_back(MakeKeyId(2, i));
+
+    CTxMemPool poolInc, poolFull;
+    poolInc.SetMemPoolCache();
+    poolFull.SetMemPoolCache();
+    vector<CTxMemPool *> pools = {&poolInc, &poolFull};
+    AddTransfer(pools, regIds[0], keyIds[4], 4 * COIN);
+    AddTransfer(pools, regIds[0], keyIds[5], 4 * COIN);
+    AddTransfer(pools, regIds[1], alice, 2 * COIN);
+    AddTransfer(pools, regIds[2], keyIds[6], 1 * COIN);
+    BOOST_REQUIRE_EQUAL(poolInc.Size(), 4u);
+
+    // a key none of the txes touched, nothing to execute again
+    ConnectWrites(blockUndos[1], [&](CCacheWrapper &cw) { SetFreeBalance(cw, dave, 2 * COIN); });
+    poolInc.AddBlockWrites(blockUndos[1]);
+    CheckSameRescan(poolInc, poolFull, keyIds);
+    BOOST_CHECK_EQUAL(poolInc.Size(), 4u);
+
+    // bob can no longer pay alice, which is dirty in turn; alice still covers both of her txes
+    ConnectWrites(blockUndos[2], [&](CCacheWrapper &cw) { SetFreeBalance(cw, bob, 1 * COIN); });
+    poolInc.AddBlockWrites(blockUndos[2]);
+    CheckSameRescan(poolInc, poolFull, keyIds);
+    BOOST_CHECK_EQUAL(poolInc.Size(), 3u);
+
+    // alice covers one of her txes only, the value forgotten from the pool cache is read again
+    ConnectWrites(blockUndos[3], [&](CCacheWrapper &cw) { SetFreeBalance(cw, alice, 5 * COIN); });
+    poolInc.AddBlockWrites(blockUndos[3]);
+    CheckSameRescan(poolInc, poolFull, keyIds);
+    BOOST_CHECK_EQUAL(poolInc.Size(), 2u);
+
+    // a reorg: the last block is disconnected and another one connected instead
+    DisconnectWrites(blockUndos[3]);
+    poolInc.SetFullRescan();
+    ConnectWrites(blockUndos[4], [&](CCacheWrapper &cw) { SetFreeBalance(cw, alice, 9 * COIN); });
+    poolInc.AddBlockWrites(blockUndos[4]);
+    CheckSameRescan(poolInc, poolFull, keyIds);
+
+    // and the incremental rescans go on from the full one
+    AddTransfer(pools, regIds[0], keyIds[7], 1 * COIN);
+    ConnectWrites(blockUndos[5], [&](CCacheWrapper &cw) { SetFreeBalance(cw, alice, 1 * COIN); });
+    poolInc.AddBlockWrites(blockUndos[5]);
+    CheckSameRescan(poolInc, poolFull, keyIds);
+    BOOST_CHECK_EQUAL(poolInc.Size(), 1u);
+
+    for (auto it = blockUndos.rbegin(); it != blockUndos.rend(); ++it) {
+        if (it != blockUndos.rbegin() + 2)  // already disconnected
+            DisconnectWrites(*it);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(txmempool_dump_load_test)
+{
+    boost::filesystem::path path = GetDataDir() / "mempool_tests.dat";
+    vector<std::shared_ptr<CBaseTx>> txs, txsRead;
+    BOOST_CHECK(WriteMempool(path, txs));
+    BOOST_CHECK(ReadMempool(path, txsRead));
+    BOOST_CHECK(txsRead.empty());
+
+    for (uint32_t i = 0; i < 3; i++)
+        txs.push_back(std::make_shared<CBaseCoinTransferTx>(CRegID(900100, i), MakeKeyId(2, i), 100 + i,
+                                                            (i + 1) * COIN, TEST_TX_FEES, strprintf("memo %u", i)));
+    BOOST_CHECK(WriteMempool(path, txs));
+    BOOST_CHECK(!boost::filesystem::exists(path.string() + ".new"));
+    BOOST_CHECK(ReadMempool(path, txsRead));
+    BOOST_REQUIRE_EQUAL(txsRead.size(), txs.size());
+    for (size_t i = 0; i < txs.size(); i++) {
+        BOOST_CHECK_EQUAL(txsRead[i]->nTxType, txs[i]->nTxType);
+        BOOST_CHECK(txsRead[i]->GetHash() == txs[i]->GetHash());
+    }
+
+    // a flipped bit fails the checksum
+    vector<char> data(boost::filesystem::file_size(path));
+    FILE *file = fopen(path.string().c_str(), "rb+");
+    BOOST_REQUIRE(file != nullptr && fread(data.data(), 1, data.size(), file) == data.size());
+    data[data.size() / 2] ^= 1;
+    BOOST_REQUIRE(fseek(file, 0, SEEK_SET) == 0 && fwrite(data.data(), 1, data.size(), file) == data.size());
+    fclose(file);
+    txsRead.clear();
+    BOOST_CHECK(!ReadMempool(path, txsRead));
+
+    // a count larger than the file, with a valid checksum, is rejected before reading any tx
+    CDataStream ssMempool(SER_DISK, CLIENT_VERSION);
+    ssMempool << FLATDATA(SysCfg().MessageStart()) << MEMPOOL_DUMP_VERSION;
+    uint32_t nCount = std::numeric_limits<uint32_t>::max();
+    ssMempool << VARINT(nCount);
+    ssMempool << txs[0];
+    uint256 hash = Hash(ssMempool.begin(), ssMempool.end());
+    ssMempool << hash;
+    {
+        CAutoFile fileout(fopen(path.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(fileout);
+        fileout << ssMempool;
+    }
+    txsRead.clear();
+    BOOST_CHECK(!ReadMempool(path, txsRead));
+    BOOST_CHECK(txsRead.empty());
+
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
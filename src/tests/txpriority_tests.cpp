@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "commons/util/util.h"
+#include "config/scoin.h"
+#include "tx/cointransfertx.h"
+#include "tx/txmempool.h"
+
+#include <set>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(txpriority_tests)
+
+static std::shared_ptr<CBaseTx> MakeTx(uint32_t n) {
+    return std::make_shared<CBaseCoinTransferTx>(CRegID(1, 1), CRegID(1, 2), 1, COIN, 10000, strprintf("tx %u", n));
+}
+
+BOOST_AUTO_TEST_CASE(txpriority_order_test)
+{
+    vector<std::shared_ptr<CBaseTx>> txes;
+    for (uint32_t i = 0; i < 2; i++)
+        txes.push_back(MakeTx(i));
+    const auto &pTxLow  = txes[0]->GetHash() < txes[1]->GetHash() ? txes[0] : txes[1];
+    const auto &pTxHigh = txes[0]->GetHash() < txes[1]->GetHash() ? txes[1] : txes[0];
+
+    // in the order the block producer packs them, from the last element of the set on
+    vector<TxPriority> expected = {
+        TxPriority(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, pTxHigh),       // producer txes first, by fee then priority
+        TxPriority(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, pTxLow),        // equal keys by txid
+        TxPriority(TRANSACTION_PRIORITY_CEILING, 0, pTxLow),
+        TxPriority(1.0, 1000000.0, pTxLow),                              // then by fee per KB
+        TxPriority(999.0, 1000.5, pTxLow),
+        TxPriority(1.0, 1000.0, pTxLow),                                 // no tolerance on the fee
+        TxPriority(0.0, 1000.0, pTxHigh),                                // then by priority, exactly too
+        TxPriority(0.0, 1000.0, pTxLow),
+        TxPriority(999.0, 0.0, pTxLow),
+    };
+
+    set<TxPriority> setTxPriorities;
+    for (auto it = expected.rbegin(); it != expected.rend(); ++it)
+        BOOST_CHECK(setTxPriorities.insert(*it).second);
+
+    // inserting in another order gives the same set, the order is strict and transitive
+    set<TxPriority> setShuffled(expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL(setShuffled.size(), expected.size());
+
+    size_t i = 0;
+    for (auto it = setTxPriorities.rbegin(); it != setTxPriorities.rend(); ++it, ++i) {
+        BOOST_CHECK_EQUAL(it->priority, expected[i].priority);
+        BOOST_CHECK_EQUAL(it->feePerKb, expected[i].feePerKb);
+        BOOST_CHECK(it->baseTx == expected[i].baseTx);
+    }
+
+    i = 0;
+    for (auto it = setShuffled.rbegin(); it != setShuffled.rend(); ++it, ++i)
+        BOOST_CHECK(!(*it < expected[i]) && !(expected[i] < *it));
+
+    for (size_t a = 0; a < expected.size(); a++) {
+        BOOST_CHECK(!(expected[a] < expected[a]));
+        for (size_t b = a + 1; b < expected.size(); b++)
+            BOOST_CHECK(expected[b] < expected[a] && !(expected[a] < expected[b]));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
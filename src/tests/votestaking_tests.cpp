@@ -0,0 +1,300 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "commons/util/util.h"
+#include "config/scoin.h"
+#include "entities/key.h"
+#include "persistence/cachewrapper.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(votestaking_tests)
+
+// ComputeVoteStakingInterestAndRevokeVotes() as it was before the revoked votes were summed per delegate,
+// each revoked vote updates the delegate account and its VOTE index entry right away
+static bool ComputeVoteStakingInterestAndRevokeVotesV1(const uint256 &blockHash, const int32_t currHeight,
+                                                       const uint32_t currBlockTime, CCacheWrapper &cw,
+                                                       CValidationState &state) {
+    map<CRegIDKey, vector<CCandidateReceivedVote>> regId2ReceivedVotes;
+    if (!cw.delegateCache.GetVoterList(regId2ReceivedVotes))
+        return state.DoS(100, ERRORMSG("failed to get vote list"), REJECT_INVALID, "bad-get-vote-list");
+
+    map<CRegID, vector<CCandidateVote>> regId2CandidateVotes;
+    for (auto &item : regId2ReceivedVotes) {
+        const CRegID &regId          = item.first.regid;
+        auto &candidateReceivedVotes = item.second;
+        vector<CCandidateVote> candidateVotes;
+        if (candidateReceivedVotes.size() == 1) {
+            regId2CandidateVotes.emplace(regId, candidateVotes);
+            continue;
+        }
+
+        auto it = candidateReceivedVotes.begin();
+        ++it;
+        for (; it < candidateReceivedVotes.end(); ++it)
+            candidateVotes.emplace_back(VoteType::MINUS_BCOIN, it->GetCandidateUid(), it->GetVotedBcoins());
+
+        regId2CandidateVotes.emplace(regId, candidateVotes);
+    }
+
+    vector<CReceipt> receipts;
+    for (const auto &item : regId2CandidateVotes) {
+        const auto &regId          = item.first;
+        const auto &candidateVotes = item.second;
+
+        vector<CCandidateReceivedVote> candidateVotesInOut;
+        cw.delegateCache.GetCandidateVotes(regId, candidateVotesInOut);
+        CAccount account;
+        cw.accountCache.GetAccount(regId, account);
+
+        if (!account.ProcessCandidateVotes(candidateVotes, candidateVotesInOut, currHeight, currBlockTime,
+                                           cw.accountCache, receipts))
+            return state.DoS(100, ERRORMSG("operate candidate votes failed"), UPDATE_ACCOUNT_FAIL,
+                             "operate-candidate-votes-failed");
+        if (!cw.delegateCache.SetCandidateVotes(regId, candidateVotesInOut))
+            return state.DoS(100, ERRORMSG("write candidate votes failed"), OPERATE_CANDIDATE_VOTES_FAIL,
+                             "write-candidate-votes-failed");
+        if (!cw.accountCache.SaveAccount(account))
+            return state.DoS(100, ERRORMSG("save account error"), UPDATE_ACCOUNT_FAIL, "bad-save-accountdb");
+
+        for (const auto &vote : candidateVotes) {
+            CAccount delegate;
+            if (!cw.accountCache.GetAccount(vote.GetCandidateUid(), delegate))
+                return state.DoS(100, ERRORMSG("read account error"), UPDATE_ACCOUNT_FAIL, "bad-read-accountdb");
+
+            uint64_t oldVotes = delegate.received_votes;
+            if (!delegate.StakeVoteBcoins(VoteType(vote.GetCandidateVoteType()), vote.GetVotedBcoins()))
+                return state.DoS(100, ERRORMSG("operate vote fund error"), UPDATE_ACCOUNT_FAIL, "operate-vote-error");
+
+            if (delegate.received_votes != oldVotes) {
+                if (!cw.delegateCache.SetDelegateVotes(delegate.regid, delegate.received_votes) ||
+                    !cw.delegateCache.EraseDelegateVotes(delegate.regid, oldVotes))
+                    return state.DoS(100, ERRORMSG("save vote info error"), UPDATE_ACCOUNT_FAIL, "bad-save-delegatedb");
+            }
+
+            if (!cw.accountCache.SaveAccount(delegate))
+                return state.DoS(100, ERRORMSG("save account error"), UPDATE_ACCOUNT_FAIL, "bad-save-accountdb");
+        }
+    }
+
+    if (!cw.delegateCache.SetLastVoteHeight(currHeight))
+        return state.DoS(100, ERRORMSG("save last vote height error"), UPDATE_ACCOUNT_FAIL, "bad-save-last-vote-height");
+
+    if (!receipts.empty() && !cw.txReceiptCache.SetBlockReceipts(blockHash, receipts))
+        return state.DoS(100, ERRORMSG("save block receipts error"), UPDATE_ACCOUNT_FAIL, "bad-save-block-receits");
+
+    return true;
+}
+
+struct CTestRand {
+    uint32_t seed;
+
+    explicit CTestRand(uint32_t seedIn) : seed(seedIn) {}
+
+    uint32_t operator()(uint32_t n) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 8) % n;
+    }
+};
+
+template <typename T>
+static string Serialize(const T &obj) {
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << obj;
+    return ss.str();
+}
+
+// The heights around the R2 fork and the subsidy jumps up to currHeight, where the interest changes formula
+static vector<int32_t> GetBoundaryHeights(int32_t currHeight) {
+    vector<int32_t> heights = {0, 1, currHeight - 1, currHeight, (int32_t)SysCfg().GetVer2ForkHeight() - 1,
+                               (int32_t)SysCfg().GetVer2ForkHeight()};
+    for (uint8_t subsidy = FIXED_SUBSIDY_RATE; subsidy <= INITIAL_SUBSIDY_RATE; subsidy++) {
+        int32_t jumpHeight = GetJumpHeightBySubsidy(subsidy);
+        heights.insert(heights.end(), {jumpHeight - 1, jumpHeight, jumpHeight + 1});
+    }
+
+    heights.erase(remove_if(heights.begin(), heights.end(), [&](int32_t h) { return h < 0 || h > currHeight; }),
+                  heights.end());
+    return heights;
+}
+
+/**
+ * A random vote history: delegates with a pubkey, voted for by regid or by pubkey, voters that vote for one
+ * or more of them, some of the voters being delegates too, with last vote heights and times on the
+ * boundaries of the interest formula. Returns the keyids of all the accounts.
+ */
+static set<CKeyID> SetupVotes(CCacheWrapper &cw, CTestRand &rnd, int32_t currHeight, uint32_t currBlockTime) {
+    vector<int32_t> heights = GetBoundaryHeights(currHeight);
+    vector<uint32_t> epochs = {0, currBlockTime - 1, currBlockTime, currBlockTime + 1,
+                               (uint32_t)FCOIN_VOTEMINE_EPOCH_FROM - 1, (uint32_t)FCOIN_VOTEMINE_EPOCH_FROM,
+                               (uint32_t)FCOIN_VOTEMINE_EPOCH_TO, (uint32_t)FCOIN_VOTEMINE_EPOCH_TO + 1};
+
+    map<CKeyID, CAccount> accounts;
+    vector<CKeyID> delegates;
+    set<CKeyID> voters;
+    uint32_t nDelegates = 2 + rnd(10);
+    for (uint32_t i = 0; i < nDelegates; i++) {
+        CKey key;
+        key.MakeNewKey();
+        CAccount delegate(key.GetPubKey().GetKeyId(), key.GetPubKey());
+        delegate.regid = CRegID(900000, i);
+        delegates.push_back(delegate.keyid);
+        accounts.emplace(delegate.keyid, delegate);
+    }
+
+    uint32_t nMaxVotes = min<uint32_t>(nDelegates, IniCfg().GetMaxVoteCandidateNum());
+    uint32_t nVoters   = 1 + rnd(60);
+    for (uint32_t i = 0; i < nVoters; i++) {
+        // a quarter of the voters are delegates too
+        CKeyID voterKeyId;
+        if (rnd(4) == 0) {
+            voterKeyId = delegates[rnd(nDelegates)];
+            if (voters.count(voterKeyId))
+                continue;  // already voting
+        } else {
+            uint160 hash;
+            hash.begin()[0] = 0x5a;
+            memcpy(hash.begin() + 1, &i, sizeof(i));
+            voterKeyId = CKeyID(hash);
+            accounts.emplace(voterKeyId, CAccount(voterKeyId));
+            accounts[voterKeyId].regid = CRegID(900001, i);
+        }
+        voters.insert(voterKeyId);
+        CAccount &voter = accounts[voterKeyId];
+
+        vector<uint32_t> candidates(nDelegates);
+        for (uint32_t j = 0; j < nDelegates; j++)
+            candidates[j] = j;
+        for (uint32_t j = nDelegates - 1; j > 0; j--)
+            swap(candidates[j], candidates[rnd(j + 1)]);
+
+        // biggest first, as ProcessCandidateVotes() sorts them, equal votes included
+        vector<CCandidateReceivedVote> candidateVotes;
+        uint64_t votes = (1 + rnd(100000)) * COIN, totalVotes = 0, maxVotes = votes;
+        for (uint32_t j = 0, nVotes = 1 + rnd(nMaxVotes); j < nVotes; j++) {
+            CAccount &delegate = accounts[delegates[candidates[j]]];
+            CUserID uid        = rnd(3) == 0 ? CUserID(delegate.owner_pubkey) : CUserID(delegate.regid);
+            candidateVotes.emplace_back(CCandidateVote(VoteType::ADD_BCOIN, uid, votes));
+            delegate.received_votes += votes;
+            totalVotes += votes;
+            if (rnd(4) != 0)
+                votes -= votes * rnd(100) / 100;
+        }
+
+        voter.last_vote_height = heights[rnd(heights.size())];
+        voter.last_vote_epoch  = epochs[rnd(epochs.size())];
+        // one bcoin eleven votes before the R2 fork, one bcoin one vote since
+        bool fR2 = GetFeatureForkVersion(voter.last_vote_height) >= MAJOR_VER_R2;
+        ReceiptList receipts;
+        BOOST_REQUIRE(voter.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, totalVotes * 2,
+                                           ReceiptType::TRANSFER_ACTUAL_COINS, receipts));
+        BOOST_REQUIRE(voter.OperateBalance(SYMB::WICC, BalanceOpType::VOTE, fR2 ? totalVotes : maxVotes,
+                                           ReceiptType::DELEGATE_ADD_VOTE, receipts));
+        BOOST_REQUIRE(cw.delegateCache.SetCandidateVotes(voter.regid, candidateVotes));
+    }
+
+    set<CKeyID> keyIds;
+    for (const auto &item : accounts) {
+        BOOST_REQUIRE(cw.accountCache.SaveAccount(item.second));
+        keyIds.insert(item.first);
+    }
+    for (const auto &keyId : delegates) {
+        const CAccount &delegate = accounts[keyId];
+        BOOST_REQUIRE(cw.delegateCache.SetDelegateVotes(delegate.regid, delegate.received_votes));
+    }
+
+    return keyIds;
+}
+
+static void CheckSameState(CCacheWrapper &cw1, CCacheWrapper &cw2, const set<CKeyID> &keyIds,
+                           const uint256 &blockHash, const string &msg) {
+    for (const auto &keyId : keyIds) {
+        CAccount account1, account2;
+        BOOST_REQUIRE(cw1.accountCache.GetAccount(keyId, account1) && cw2.accountCache.GetAccount(keyId, account2));
+        BOOST_CHECK_MESSAGE(Serialize(account1) == Serialize(account2), msg + " account " + account1.ToString());
+
+        vector<CCandidateReceivedVote> votes1, votes2;
+        cw1.delegateCache.GetCandidateVotes(account1.regid, votes1);
+        cw2.delegateCache.GetCandidateVotes(account2.regid, votes2);
+        BOOST_CHECK_MESSAGE(votes1 == votes2, msg + " candidate votes of " + account1.regid.ToString());
+    }
+
+    VoteDelegateVector delegates1, delegates2;
+    cw1.delegateCache.GetTopVoteDelegates(10000, 0, delegates1, false);
+    cw2.delegateCache.GetTopVoteDelegates(10000, 0, delegates2, false);
+    BOOST_CHECK_MESSAGE(delegates1 == delegates2, msg + " vote index");
+
+    vector<CReceipt> receipts1, receipts2;
+    cw1.txReceiptCache.GetBlockReceipts(blockHash, receipts1);
+    cw2.txReceiptCache.GetBlockReceipts(blockHash, receipts2);
+    BOOST_CHECK_MESSAGE(Serialize(receipts1) == Serialize(receipts2), msg + " receipts");
+
+    BOOST_CHECK_EQUAL(cw1.delegateCache.GetLastVoteHeight(), cw2.delegateCache.GetLastVoteHeight());
+}
+
+BOOST_AUTO_TEST_CASE(votestaking_equivalence_test)
+{
+    LOCK(cs_main);
+    int32_t forkHeight = SysCfg().GetVer2ForkHeight();
+    vector<int32_t> currHeights = {forkHeight - 1, forkHeight};  // the fork block runs it at forkHeight - 1
+    for (uint8_t subsidy = FIXED_SUBSIDY_RATE; subsidy < INITIAL_SUBSIDY_RATE; subsidy++)
+        currHeights.push_back(GetJumpHeightBySubsidy(subsidy));
+
+    for (int32_t currHeight : currHeights) {
+        for (uint32_t seed = 1; seed <= 8; seed++) {
+            string msg = strprintf("height=%d, seed=%u", currHeight, seed);
+            CTestRand rnd(seed * 7919 + currHeight);
+            uint32_t currBlockTime = seed % 2 ? FCOIN_VOTEMINE_EPOCH_FROM + 86400 * rnd(3000) : rnd(0x7fffffff);
+            uint256 blockHash      = ArithToUint256(arith_uint256(seed * 1000003 + currHeight));
+
+            CCacheWrapper cwBase(pCdMan);
+            set<CKeyID> keyIds = SetupVotes(cwBase, rnd, currHeight, currBlockTime);
+
+            CCacheWrapper cw1(&cwBase), cw2(&cwBase);
+            CValidationState state1, state2;
+            bool fRet1 = ComputeVoteStakingInterestAndRevokeVotesV1(blockHash, currHeight, currBlockTime, cw1, state1);
+            bool fRet2 = ComputeVoteStakingInterestAndRevokeVotes(blockHash, currHeight, currBlockTime, cw2, state2);
+            BOOST_CHECK_MESSAGE(fRet1 && fRet2, msg);
+            if (fRet1 && fRet2)
+                CheckSameState(cw1, cw2, keyIds, blockHash, msg);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(votestaking_revoke_failure_test)
+{
+    LOCK(cs_main);
+    int32_t currHeight = SysCfg().GetVer2ForkHeight() - 1;
+
+    // a delegate that received fewer votes than are revoked from it fails both the same way
+    for (uint32_t seed = 1; seed <= 8; seed++) {
+        CTestRand rnd(seed);
+        CCacheWrapper cwBase(pCdMan);
+        set<CKeyID> keyIds = SetupVotes(cwBase, rnd, currHeight, FCOIN_VOTEMINE_EPOCH_FROM);
+        for (const auto &keyId : keyIds) {
+            CAccount account;
+            BOOST_REQUIRE(cwBase.accountCache.GetAccount(keyId, account));
+            if (account.received_votes > 0 && rnd(2) == 0) {
+                account.received_votes = 0;
+                BOOST_REQUIRE(cwBase.accountCache.SaveAccount(account));
+            }
+        }
+
+        CCacheWrapper cw1(&cwBase), cw2(&cwBase);
+        CValidationState state1, state2;
+        bool fRet1 = ComputeVoteStakingInterestAndRevokeVotesV1(uint256(), currHeight, FCOIN_VOTEMINE_EPOCH_FROM, cw1, state1);
+        bool fRet2 = ComputeVoteStakingInterestAndRevokeVotes(uint256(), currHeight, FCOIN_VOTEMINE_EPOCH_FROM, cw2, state2);
+        BOOST_CHECK_EQUAL(fRet1, fRet2);
+        BOOST_CHECK_EQUAL(state1.GetRejectReason(), state2.GetRejectReason());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -17,23 +17,15 @@ static bool GetUtxoTxFromChain(CCacheWrapper &cw, TxID &txid, std::shared_ptr<CC
     CDiskTxPos txPos;
     if (cw.blockCache.ReadTxIndex(txid, txPos)) {
         LOCK(cs_main);
-        CAutoFile file(OpenBlockFile(txPos, true), SER_DISK, CLIENT_VERSION);
         CBlockHeader header;
-
-        try {
-            file >> header;
-            fseek(file, txPos.nTxOffset, SEEK_CUR);
-            file >> pBaseTx;
-
-            assert(pBaseTx);
-            pPrevUtxoTx = dynamic_pointer_cast<CCoinUtxoTransferTx>(pBaseTx);
-            if (!pPrevUtxoTx) {
-                return ERRORMSG("The expected tx(%s) type is CCoinUtxoTransferTx, but read tx type is %s",
-                                txid.ToString(), typeid(*pBaseTx).name());
-            }
-
-        } catch (std::exception &e) {
-            throw runtime_error(strprintf("%s : Deserialize or I/O error - %s", __func__, e.what()).c_str());
+        if (!ReadTxFromBlockFile(txPos, header, pBaseTx))
+            throw runtime_error(strprintf("%s : read tx(%s) from block file failed", __func__, txid.ToString()).c_str());
+
+        assert(pBaseTx);
+        pPrevUtxoTx = dynamic_pointer_cast<CCoinUtxoTransferTx>(pBaseTx);
+        if (!pPrevUtxoTx) {
+            return ERRORMSG("The expected tx(%s) type is CCoinUtxoTransferTx, but read tx type is %s",
+                            txid.ToString(), typeid(*pBaseTx).name());
         }
     } else {
         return ERRORMSG("utxo read preutxo tx index error");
@@ -91,18 +83,43 @@ bool VerifyMultiSig(CBaseTx &tx, CTxExecuteContext &context, const uint256 &utxo
     if (!ComputeRedeemScript(tx, context, p2maIn, redeemScript))
         return false;
 
+    // Each signature is checked against the uids in order until one matches. The checks are batched by uid:
+    // round j verifies uid j against the signatures not matched yet, which are the pairs checking them one
+    // by one would reach, and a uid without an owner pubkey fails the tx only if a signature gets that far.
+    vector<shared_ptr<CAccount>> accounts;
+    accounts.reserve(p2maIn.uids.size());
+    for (const auto &uid : p2maIn.uids)
+        accounts.push_back(tx.GetAccount(*context.pCw, uid));
+
+    vector<size_t> pending;
+    for (size_t i = 0; i < p2maIn.signatures.size(); i++)
+        pending.push_back(i);
+
     int verifyPassNum = 0;
-    for (const auto &signature : p2maIn.signatures) {
-        for (const auto uid : p2maIn.uids) {
-            auto spAccount = tx.GetAccount(context, uid, "uid");
-            if (!spAccount || !spAccount->HasOwnerPubKey())
-                return false;
+    vector<CSignatureCheck> checks;
+    vector<uint8_t> results;
+    for (size_t j = 0; j < p2maIn.uids.size() && !pending.empty(); j++) {
+        if (!accounts[j]) {
+            tx.GetAccount(context, p2maIn.uids[j], "uid");  // sets the state of the missing account
+            return false;
+        }
+
+        if (!accounts[j]->HasOwnerPubKey())
+            return false;
 
-            if (VerifySignature(utxoMultiSignHash, signature, spAccount->owner_pubkey)) {
+        checks.clear();
+        for (size_t i : pending)
+            checks.emplace_back(utxoMultiSignHash, p2maIn.signatures[i], accounts[j]->owner_pubkey);
+        VerifySignatures(checks, results);
+
+        size_t nPending = 0;
+        for (size_t k = 0; k < pending.size(); k++) {
+            if (results[k] != 0)
                 verifyPassNum++;
-                break;
-            }
+            else
+                pending[nPending++] = pending[k];
         }
+        pending.resize(nPending);
     }
     bool verified = (verifyPassNum >= p2maIn.m);
 
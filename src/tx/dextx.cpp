@@ -320,6 +320,16 @@ namespace dex {
         return true;
     }
 
+    void CDEXOrderBaseTx::GetSignatureChecks(CAccountDBCache &accountCache, vector<CSignatureCheck> &checks) const {
+        CBaseTx::GetSignatureChecks(accountCache, checks);
+
+        if (has_operator_config && operator_uid.is<CRegID>()) {
+            CAccount operatorAccount;
+            if (accountCache.GetAccount(operator_uid, operatorAccount) && operatorAccount.owner_pubkey.IsValid())
+                checks.emplace_back(GetHash(), operator_signature, operatorAccount.owner_pubkey);
+        }
+    }
+
     bool CDEXOrderBaseTx::CheckOrderOperatorParam(CTxExecuteContext &context,
                                                   DexOperatorDetail &operatorDetail,
                                                   CAccount &operatorAccount) const {
@@ -57,6 +57,7 @@ namespace dex {
 
         virtual string ToString(CAccountDBCache &accountCache); //logging usage
         virtual Object ToJson(CCacheWrapper &cw) const; //json-rpc usage
+        virtual void GetSignatureChecks(CAccountDBCache &accountCache, vector<CSignatureCheck> &checks) const;
     protected:
         virtual bool CheckMinFee(CTxExecuteContext &context, uint64_t minFee);
 
@@ -388,6 +388,29 @@ bool CBaseTx::CheckTxAvailableFromVer(CTxExecuteContext &context, FeatureForkVer
     return true;
 }
 
+void CBaseTx::GetSignatureChecks(CAccountDBCache &accountCache, vector<CSignatureCheck> &checks) const {
+    if(    nTxType == BLOCK_REWARD_TX
+        || nTxType == PRICE_MEDIAN_TX
+        || nTxType == UCOIN_MINT_TX
+        || nTxType == UCOIN_BLOCK_REWARD_TX
+        || nTxType == CDP_FORCE_SETTLE_INTEREST_TX )
+        return;
+
+    CPubKey pubKey;
+    if (txUid.is<CPubKey>()) {
+        pubKey = txUid.get<CPubKey>();
+    } else {
+        CAccount account;
+        if (!accountCache.GetAccount(txUid, account))
+            return;
+
+        pubKey = account.owner_pubkey;
+    }
+
+    if (pubKey.IsValid())
+        checks.emplace_back(GetHash(), signature, pubKey);
+}
+
 bool CBaseTx::VerifySignature(CTxExecuteContext &context, const CPubKey &pubkey) {
     uint256 sighash = GetHash();
     if (!::VerifySignature(sighash, signature, pubkey))
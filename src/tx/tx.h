@@ -41,6 +41,7 @@ static const unordered_map<TxExecuteContextType, string> kTxExecuteContextTypeNa
 
 class CCacheWrapper;
 class CValidationState;
+struct CSignatureCheck;
 
 static const std::unordered_map<TxType, AccountPermType> kTxTypePermMap = {
     { BCOIN_TRANSFER_TX,            AccountPermType::PERM_SEND_COIN  },
@@ -183,6 +184,8 @@ public:
     virtual Object ToJson(CCacheWrapper &cw) const;
 
     virtual bool GetInvolvedKeyIds(CCacheWrapper &cw, set<CKeyID> &keyIds);
+    /** The signatures CheckAndExecuteTx() is going to verify, as far as the accounts in accountCache tell, to verify them ahead in a batch. */
+    virtual void GetSignatureChecks(CAccountDBCache &accountCache, vector<CSignatureCheck> &checks) const;
 
     bool CheckBaseTx(CTxExecuteContext &context);
     virtual bool CheckTx(CTxExecuteContext &context) = 0;
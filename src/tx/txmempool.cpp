@@ -9,48 +9,94 @@
 #include "persistence/txdb.h"
 #include "tx/tx.h"
 #include "miner/miner.h"
+#include "persistence/blockundo.h"
+#include "init.h"
+#include "sigcheckqueue.h"
+#include "tx/txserializer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iterator>
+
+#include <boost/filesystem.hpp>
 
 using namespace std;
 
+// bytes of the map node of an entry and of its index entries, besides the tx and its cache overlay
+static const uint32_t ENTRY_OVERHEAD = sizeof(pair<const uint256, CTxMemPoolEntry>) + sizeof(TxPriority) +
+                                       sizeof(pair<CKeyID, uint256>) + sizeof(pair<int64_t, uint256>) + 4 * 32;
+
+bool TxPriority::operator<(const TxPriority &other) const {
+    // exact comparisons only, a tolerance would make the order of a set intransitive.
+    // The txes of the block producer, from TRANSACTION_PRIORITY_CEILING up, go before any fee-paying tx.
+    bool fProducerTx      = this->priority >= TRANSACTION_PRIORITY_CEILING;
+    bool fOtherProducerTx = other.priority >= TRANSACTION_PRIORITY_CEILING;
+    if (fProducerTx != fOtherProducerTx)
+        return fOtherProducerTx;
+
+    if (this->feePerKb != other.feePerKb)
+        return this->feePerKb < other.feePerKb;
+
+    if (this->priority != other.priority)
+        return this->priority < other.priority;
+
+    return this->baseTx->GetHash() < other.baseTx->GetHash();
+}
+
+// the fee per KB the block producer sorts the txes by
+static double GetFeePerKb(CCacheWrapper &cw, const CTxMemPoolEntry &entry, int32_t height, uint32_t fuelRate) {
+    uint64_t fee     = std::get<1>(entry.GetFees());
+    uint64_t fuelFee = entry.GetTransaction()->GetFuelFee(cw, height, fuelRate);
+    return fee > fuelFee ? double(fee - fuelFee) / entry.GetTxSize() * 1000.0 : 0.0;
+}
+
 CTxMemPoolEntry::CTxMemPoolEntry() {
     nTxSize   = 0;
     dPriority = 0.0;
 
     nTime   = 0;
     height = 0;
+    dFeePerKb = 0.0;
+    nUsage    = 0;
 }
 
-CTxMemPoolEntry::CTxMemPoolEntry(CBaseTx *pBaseTx, int64_t time, uint32_t height) : nTime(time), height(height) {
-    pTx       = pBaseTx->GetNewInstance();
+CTxMemPoolEntry::CTxMemPoolEntry(CBaseTx *pBaseTx, int64_t time, uint32_t height)
+    : CTxMemPoolEntry(pBaseTx->GetNewInstance(), time, height) {}
+
+CTxMemPoolEntry::CTxMemPoolEntry(std::shared_ptr<CBaseTx> spTx, int64_t time, uint32_t height)
+    : pTx(std::move(spTx)), nTime(time), height(height), dFeePerKb(0.0), nUsage(0) {
     nFees     = pTx->GetFees();
     nTxSize   = ::GetSerializeSize(*pTx, SER_NETWORK, PROTOCOL_VERSION);
     dPriority = pTx->GetPriority();
 }
 
-CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry &other) {
-    this->pTx       = other.pTx->GetNewInstance();
-    this->nFees     = other.nFees;
-    this->nTxSize   = other.nTxSize;
-    this->dPriority = other.dPriority;
-
-    this->nTime  = other.nTime;
-    this->height = other.height;
-}
-
 CTxMemPool::CTxMemPool() {
     // Sanity checks off by default for performance, because otherwise
     // accepting transactions becomes O(N^2) where N is the number
     // of transactions in the pool
     fSanityCheck         = false;
+    fFullRescan          = false;
+    nIncrementalRescans  = 0;
+    nIndexFuelRate       = 0;
+
+    nMaxBytes             = (uint64_t)DEFAULT_MAX_MEMPOOL_SIZE * 1024 * 1024;
+    nMaxSenderTxs         = DEFAULT_MAX_MEMPOOL_SENDER_TXS;
+    nTxBytes              = 0;
+    nUsageBytes           = 0;
+    dRollingMinFeePerKb   = 0.0;
+    nLastRollingFeeUpdate = 0;
+    nEvicted              = 0;
 }
 
 void CTxMemPool::Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive) {
     // Remove transaction from memory pool
     LOCK(cs);
     uint256 txid = pBaseTx->GetHash();
-    if (memPoolTxs.count(txid)) {
-        removed.push_front(std::shared_ptr<CBaseTx>(memPoolTxs[txid].GetTransaction()));
-        memPoolTxs.erase(txid);
+    auto it = memPoolTxs.find(txid);
+    if (it != memPoolTxs.end()) {
+        removed.push_front(it->second.GetTransaction());
+        RemoveEntry(it, true);
         EraseTransactionFromWallet(txid);
     }
 }
@@ -59,21 +105,65 @@ void CTxMemPool::Remove(const uint256 &txid) {
     LOCK(cs);
     auto it = memPoolTxs.find(txid);
     if (it != memPoolTxs.end()) {
-        memPoolTxs.erase(it);
+        RemoveEntry(it, true);
         EraseTransactionFromWallet(txid);
     }
 }
 
-bool CTxMemPool::AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state) {
+void CTxMemPool::RemoveConfirmed(const CBlock &block) {
+    LOCK(cs);
+    for (const auto &pTx : block.vptx) {
+        auto it = memPoolTxs.find(pTx->GetHash());
+        if (it != memPoolTxs.end())
+            RemoveEntry(it, true);
+    }
+}
+
+bool CTxMemPool::AddUnchecked(const uint256 &txid, CTxMemPoolEntry &&entry, CValidationState &state) {
     // Add to memory pool without checking anything.
     // Used by main.cpp AcceptToMemoryPool(), which DOES
     // all the appropriate checks.
     LOCK(cs);
     {
+        // While the pool is or was recently full, the tx must pay more than the evicted ones. The floor is a
+        // fee per KB net of fuel, which is only known once the tx is executed; the gross fee is an upper
+        // bound of it, so it already rules out the txes paying too little before they are executed.
+        double minFeePerKb = GetMinFeePerKb();
+        double feePerKb    = double(std::get<1>(entry.GetFees())) / entry.GetTxSize() * 1000.0;
+        if (minFeePerKb > 0 && feePerKb < minFeePerKb)
+            return state.DoS(0, ERRORMSG("AddUnchecked() : txid: %s fee per KB %.0f below the mempool min fee %.0f",
+                             txid.GetHex(), feePerKb, minFeePerKb), REJECT_INSUFFICIENTFEE, "mempool-min-fee-not-met");
+
+        CKeyID sender;
+        if (nMaxSenderTxs > 0 && cw->accountCache.GetKeyId(entry.GetTransaction()->txUid, sender) &&
+            mapTxsBySender.count(sender) >= nMaxSenderTxs)
+            return state.DoS(0, ERRORMSG("AddUnchecked() : txid: %s, sender %s has %u txes in the mempool already",
+                             txid.GetHex(), sender.ToAddress(), nMaxSenderTxs), REJECT_NONSTANDARD, "too-many-sender-txes");
+
         if (!CheckTxInMemPool(txid, entry, state, memPoolTxs.size()))
             return false;
 
-        memPoolTxs.insert(make_pair(txid, entry));
+        // move the entry in, copying it would clone the tx once more
+        auto ret = memPoolTxs.emplace(txid, std::move(entry));
+        if (ret.second) {
+            IndexEntry(txid, ret.first->second);
+
+            // the net fee per KB, the same quantity the floor is built from
+            if (minFeePerKb > 0 && ret.first->second.dFeePerKb < minFeePerKb) {
+                feePerKb = ret.first->second.dFeePerKb;
+                RemoveEntry(ret.first, true);
+                if (fFullRescan || !ReExecuteDirtyTxes())
+                    FullReScan();
+
+                return state.DoS(0, ERRORMSG("AddUnchecked() : txid: %s net fee per KB %.0f below the mempool min "
+                                 "fee %.0f", txid.GetHex(), feePerKb, minFeePerKb), REJECT_INSUFFICIENTFEE,
+                                 "mempool-min-fee-not-met");
+            }
+        }
+
+        if (nUsageBytes > nMaxBytes && !TrimToSize(txid))
+            return state.DoS(0, ERRORMSG("AddUnchecked() : txid: %s, mempool full", txid.GetHex()),
+                             REJECT_INSUFFICIENTFEE, "mempool-full");
     }
     return true;
 }
@@ -111,6 +201,9 @@ bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &me
     }
 
     auto spCW = std::make_shared<CCacheWrapper>(cw.get());
+    CDBOpLogMap dbOpLogMap;
+    dbOpLogMap.EnableReadLog();
+    spCW->SetDbOpLogMap(&dbOpLogMap);
 
     if (bRehearsalExecute) { //always true so far
         const auto &bpRegid = GetBlockBpRegid(*chainActive.TipBlock());
@@ -127,18 +220,127 @@ bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &me
         }
     }
 
+    spCW->SetDbOpLogMap(nullptr);
     spCW->Flush();
+    AddDeps(txid, dbOpLogMap);
 
     return true;
 }
 
 void CTxMemPool::SetMemPoolCache() {
     cw.reset(new CCacheWrapper(pCdMan));
+    ClearDeps();
+}
+
+void CTxMemPool::AddBlockWrites(const CBlockUndo &blockUndo) {
+    LOCK(cs);
+    if (fFullRescan)
+        return;
+
+    // nothing worth keeping in cw, a full rescan is cheaper than tracking the keys
+    if (memPoolTxs.empty()) {
+        SetFullRescan();
+        return;
+    }
+
+    for (const auto &txUndo : blockUndo.vtxundo)
+        txUndo.dbOpLogMap.GetWrittenKeys(setDirtyKeys);
+
+    if (setDirtyKeys.size() > MAX_MEMPOOL_DIRTY_KEYS)
+        SetFullRescan();
+}
+
+void CTxMemPool::SetFullRescan() {
+    LOCK(cs);
+    fFullRescan = true;
+    setDirtyKeys.clear();
 }
 
 void CTxMemPool::ReScanMemPoolTx() {
+    static uint32_t nFullRescanInterval = SysCfg().GetArg("-mempoolfullrescan", DEFAULT_MEMPOOL_FULL_RESCAN);
+
+    LOCK(cs);
+    if (fFullRescan || ++nIncrementalRescans >= nFullRescanInterval) {
+        FullReScan();
+        return;
+    }
+
+    auto bm = MAKE_BENCHMARK("rescan affected tx in mempool");
+    CBlockIndex *pTip = chainActive.Tip();
+    if (pTip == nullptr)
+        throw runtime_error("ReScanMemPoolTx:: ChainActive.Tip() is null");
+
+    UpdateFeeRates();
+
+    // the txes out of their valid height are dropped, the ones depending on what they wrote are executed again
+    static int validHeight = SysCfg().GetTxCacheHeight();
+    for (auto iterTx = memPoolTxs.begin(); iterTx != memPoolTxs.end();) {
+        if (!iterTx->second.GetTransaction()->IsValidHeight(pTip->height + 1, validHeight)) {
+            uint256 txid = iterTx->first;
+            iterTx       = RemoveEntry(iterTx, true);
+            EraseTransactionFromWallet(txid);
+            continue;
+        }
+        ++iterTx;
+    }
+
+    if (!ReExecuteDirtyTxes())
+        FullReScan();
+}
+
+bool CTxMemPool::ReExecuteDirtyTxes() {
+    // the txes touching a dirty key, the keys they wrote are dirty in turn
+    set<uint256> affectedTxids;
+    vector<CDbKey> pendingKeys(setDirtyKeys.begin(), setDirtyKeys.end());
+    while (!pendingKeys.empty()) {
+        auto keyIt = mapKeyTxs.find(pendingKeys.back());
+        pendingKeys.pop_back();
+        if (keyIt == mapKeyTxs.end())
+            continue;
+
+        for (const auto &txid : keyIt->second) {
+            if (!affectedTxids.insert(txid).second)
+                continue;
+
+            for (const auto &key : mapTxDeps[txid].writtenKeys) {
+                if (setDirtyKeys.insert(key).second)
+                    pendingKeys.push_back(key);
+            }
+        }
+    }
+
+    // the rest of the txes never saw the dropped keys, so their effects in cw still hold
+    if (!ForgetDirtyKeys())
+        return false;
+    setDirtyKeys.clear();
+
+    CValidationState state;
+    int32_t index = memPoolTxs.size() - affectedTxids.size();
+    for (const auto &txid : affectedTxids) {
+        auto iterTx = memPoolTxs.find(txid);
+        EraseDeps(txid, false);
+        if (iterTx == memPoolTxs.end())
+            continue;
+
+        UnindexEntry(txid, iterTx->second);
+        if (!CheckTxInMemPool(txid, iterTx->second, state, index++, true)) {
+            memPoolTxs.erase(iterTx);
+            EraseTransactionFromWallet(txid);
+            continue;
+        }
+        IndexEntry(txid, iterTx->second);
+    }
+
+    LogPrint(BCLog::DEBUG, "mempool rescan executed %u of %u txes again\n", affectedTxids.size(),
+             memPoolTxs.size());
+    return true;
+}
+
+void CTxMemPool::FullReScan() {
     auto bm = MAKE_BENCHMARK("rescan all tx in mempool");
     cw.reset(new CCacheWrapper(pCdMan));
+    ClearDeps();
+    ClearIndexes();
 
     LOCK(cs);
     CValidationState state;
@@ -150,6 +352,7 @@ void CTxMemPool::ReScanMemPoolTx() {
             EraseTransactionFromWallet(txid);
             continue;
         }
+        IndexEntry(iterTx->first, iterTx->second);
         ++iterTx;
     }
 }
@@ -159,6 +362,199 @@ void CTxMemPool::Clear() {
 
     memPoolTxs.clear();
     cw.reset(new CCacheWrapper(pCdMan));
+    ClearDeps();
+    ClearIndexes();
+}
+
+void CTxMemPool::IndexEntry(const uint256 &txid, CTxMemPoolEntry &entry) {
+    if (nIndexFuelRate == 0)
+        nIndexFuelRate = GetElementForBurn(chainActive.Tip());
+
+    entry.dFeePerKb = GetFeePerKb(*cw, entry, chainActive.Height() + 1, nIndexFuelRate);
+    if (!cw->accountCache.GetKeyId(entry.pTx->txUid, entry.sender))
+        entry.sender = CKeyID();
+
+    setTxPriorities.emplace(entry.dPriority, entry.dFeePerKb, entry.pTx);
+    mapTxsBySender.emplace(entry.sender, txid);
+    mapTxsByTime.emplace(entry.nTime, txid);
+
+    auto depsIt  = mapTxDeps.find(txid);
+    entry.nUsage = entry.nTxSize + ENTRY_OVERHEAD + (depsIt != mapTxDeps.end() ? depsIt->second.nOverlayBytes : 0);
+    nTxBytes    += entry.nTxSize;
+    nUsageBytes += entry.nUsage;
+}
+
+void CTxMemPool::UnindexEntry(const uint256 &txid, const CTxMemPoolEntry &entry) {
+    setTxPriorities.erase(TxPriority(entry.dPriority, entry.dFeePerKb, entry.pTx));
+    nTxBytes    -= entry.nTxSize;
+    nUsageBytes -= entry.nUsage;
+
+    auto senderRange = mapTxsBySender.equal_range(entry.sender);
+    for (auto it = senderRange.first; it != senderRange.second; ++it) {
+        if (it->second == txid) {
+            mapTxsBySender.erase(it);
+            break;
+        }
+    }
+
+    auto timeRange = mapTxsByTime.equal_range(entry.nTime);
+    for (auto it = timeRange.first; it != timeRange.second; ++it) {
+        if (it->second == txid) {
+            mapTxsByTime.erase(it);
+            break;
+        }
+    }
+}
+
+void CTxMemPool::UpdateFeeRates() {
+    uint32_t fuelRate = GetElementForBurn(chainActive.Tip());
+    if (fuelRate == nIndexFuelRate)
+        return;
+
+    // only the txes burning fuel move
+    nIndexFuelRate = fuelRate;
+    int32_t height = chainActive.Height() + 1;
+    for (auto &item : memPoolTxs) {
+        CTxMemPoolEntry &entry = item.second;
+        double feePerKb        = GetFeePerKb(*cw, entry, height, fuelRate);
+        if (feePerKb != entry.dFeePerKb) {
+            setTxPriorities.erase(TxPriority(entry.dPriority, entry.dFeePerKb, entry.pTx));
+            entry.dFeePerKb = feePerKb;
+            setTxPriorities.emplace(entry.dPriority, entry.dFeePerKb, entry.pTx);
+        }
+    }
+}
+
+void CTxMemPool::ClearIndexes() {
+    setTxPriorities.clear();
+    mapTxsBySender.clear();
+    mapTxsByTime.clear();
+    nIndexFuelRate = 0;
+    nTxBytes       = 0;
+    nUsageBytes    = 0;
+}
+
+void CTxMemPool::SetLimits(uint64_t nMaxBytesIn, uint32_t nMaxSenderTxsIn) {
+    LOCK(cs);
+    nMaxBytes     = nMaxBytesIn;
+    nMaxSenderTxs = nMaxSenderTxsIn;
+}
+
+double CTxMemPool::GetMinFeePerKb() {
+    LOCK(cs);
+    if (dRollingMinFeePerKb == 0)
+        return 0;
+
+    int64_t now = GetTime();
+    if (now > nLastRollingFeeUpdate + 10) {
+        // the emptier the pool, the faster the floor goes down
+        double halfLife = MEMPOOL_FEE_HALFLIFE;
+        if (nUsageBytes < nMaxBytes / 4)
+            halfLife /= 4;
+        else if (nUsageBytes < nMaxBytes / 2)
+            halfLife /= 2;
+
+        dRollingMinFeePerKb /= pow(2.0, (now - nLastRollingFeeUpdate) / halfLife);
+        nLastRollingFeeUpdate = now;
+        if (dRollingMinFeePerKb < MEMPOOL_FEE_INCREMENT / 2)
+            dRollingMinFeePerKb = 0;
+    }
+    return dRollingMinFeePerKb;
+}
+
+bool CTxMemPool::TrimToSize(const uint256 &txidNew) {
+    uint64_t nEvictedBefore = nEvicted;
+    while (nUsageBytes > nMaxBytes && !setTxPriorities.empty()) {
+        // the lowest priority goes first, the fee per KB sets the floor for the next txes
+        const TxPriority &lowest = *setTxPriorities.begin();
+        uint256 txid             = lowest.baseTx->GetHash();
+        double feePerKb          = lowest.feePerKb;
+        auto it                  = memPoolTxs.find(txid);
+        if (it == memPoolTxs.end())
+            break;
+
+        RemoveEntry(it, true);
+        if (txid != txidNew)
+            EraseTransactionFromWallet(txid);
+
+        dRollingMinFeePerKb   = std::max(dRollingMinFeePerKb, feePerKb + MEMPOOL_FEE_INCREMENT);
+        nLastRollingFeeUpdate = GetTime();
+        nEvicted++;
+        LogPrint(BCLog::DEBUG, "evicted txid %s from the full mempool, fee_per_kb=%.0f, usage=%llu\n",
+                 txid.GetHex(), feePerKb, nUsageBytes);
+    }
+
+    // the writes of the evicted txes are still in cw, drop them and execute the txes depending on them again
+    if (nEvicted != nEvictedBefore && (fFullRescan || !ReExecuteDirtyTxes()))
+        FullReScan();
+
+    return memPoolTxs.count(txidNew) > 0;
+}
+
+map<uint256, CTxMemPoolEntry>::iterator CTxMemPool::RemoveEntry(map<uint256, CTxMemPoolEntry>::iterator it, bool fDirty) {
+    UnindexEntry(it->first, it->second);
+    EraseDeps(it->first, fDirty);
+    return memPoolTxs.erase(it);
+}
+
+void CTxMemPool::AddDeps(const uint256 &txid, const CDBOpLogMap &dbOpLogMap) {
+    EraseDeps(txid, false);
+
+    set<CDbKey> writtenKeys;
+    dbOpLogMap.GetWrittenKeys(writtenKeys);
+    CTxDeps &deps = mapTxDeps[txid];
+    deps.writtenKeys.assign(writtenKeys.begin(), writtenKeys.end());
+    deps.nOverlayBytes = dbOpLogMap.GetDataSize();
+    std::set_union(dbOpLogMap.GetReadKeys().begin(), dbOpLogMap.GetReadKeys().end(), writtenKeys.begin(),
+                   writtenKeys.end(), std::back_inserter(deps.keys));
+
+    for (const auto &key : deps.keys)
+        mapKeyTxs[key].insert(txid);
+}
+
+void CTxMemPool::EraseDeps(const uint256 &txid, bool fDirty) {
+    auto it = mapTxDeps.find(txid);
+    if (it == mapTxDeps.end())
+        return;
+
+    for (const auto &key : it->second.keys) {
+        auto keyIt = mapKeyTxs.find(key);
+        if (keyIt != mapKeyTxs.end()) {
+            keyIt->second.erase(txid);
+            if (keyIt->second.empty())
+                mapKeyTxs.erase(keyIt);
+        }
+    }
+
+    // what the tx wrote stays in cw until the keys are dropped
+    if (fDirty && !fFullRescan)
+        setDirtyKeys.insert(it->second.writtenKeys.begin(), it->second.writtenKeys.end());
+
+    mapTxDeps.erase(it);
+}
+
+void CTxMemPool::ClearDeps() {
+    mapTxDeps.clear();
+    mapKeyTxs.clear();
+    setDirtyKeys.clear();
+    fFullRescan         = false;
+    nIncrementalRescans = 0;
+}
+
+bool CTxMemPool::ForgetDirtyKeys() {
+    map<dbk::PrefixType, vector<string>> keysByPrefix;
+    for (const auto &key : setDirtyKeys)
+        keysByPrefix[key.first].push_back(key.second);
+
+    ForgetDataFuncMap forgetDataFuncMap = cw->GetForgetDataFuncMap();
+    for (const auto &item : keysByPrefix) {
+        auto funcIt = forgetDataFuncMap.find(item.first);
+        if (funcIt == forgetDataFuncMap.end())
+            return false;
+
+        funcIt->second(item.second);
+    }
+    return true;
 }
 
 uint64_t CTxMemPool::Size() {
@@ -177,4 +573,171 @@ std::shared_ptr<CBaseTx> CTxMemPool::Lookup(const uint256 txid) const {
     if (i == memPoolTxs.end())
         return std::shared_ptr<CBaseTx>();
     return i->second.GetTransaction();
-}
\ No newline at end of file
+}
+////////////////////////////////////////////////////////////////////////////////
+// mempool.dat
+
+static std::atomic<bool> fMempoolLoaded(false);
+
+void DumpMempool() {
+    if (!fMempoolLoaded)
+        return;
+
+    int64_t nStart = GetTimeMillis();
+    vector<std::shared_ptr<CBaseTx>> txs;
+    {
+        LOCK(mempool.cs);
+        txs.reserve(mempool.GetTxsByTime().size());
+        for (const auto &item : mempool.GetTxsByTime()) {
+            auto it = mempool.memPoolTxs.find(item.second);
+            assert(it != mempool.memPoolTxs.end());
+            txs.push_back(it->second.GetTransaction());
+        }
+    }
+
+    if (!WriteMempool(GetDataDir() / "mempool.dat", txs))
+        return;
+
+    LogPrint(BCLog::INFO, "Dumped %u txes to mempool.dat (%dms)\n", txs.size(), GetTimeMillis() - nStart);
+}
+
+bool WriteMempool(const boost::filesystem::path &pathMempool, const vector<std::shared_ptr<CBaseTx>> &txs) {
+    // serialize txes, checksum data up to that point, then append csum
+    CDataStream ssMempool(SER_DISK, CLIENT_VERSION);
+    ssMempool << FLATDATA(SysCfg().MessageStart());
+    ssMempool << MEMPOOL_DUMP_VERSION;
+    uint32_t nCount = txs.size();
+    ssMempool << VARINT(nCount);
+    for (const auto &spTx : txs)
+        ssMempool << spTx;
+    uint256 hash = Hash(ssMempool.begin(), ssMempool.end());
+    ssMempool << hash;
+
+    boost::filesystem::path pathTmp = pathMempool.string() + ".new";
+    FILE *file                      = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout               = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!fileout)
+        return ERRORMSG("Failed to open file %s", pathTmp.string());
+
+    try {
+        fileout << ssMempool;
+    } catch (std::exception &e) {
+        return ERRORMSG("Serialize or I/O error - %s", e.what());
+    }
+    FileCommit(fileout);
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, pathMempool))
+        return ERRORMSG("Rename-into-path failed");
+
+    return true;
+}
+
+bool ReadMempool(const boost::filesystem::path &pathMempool, vector<std::shared_ptr<CBaseTx>> &txs) {
+    FILE *file       = fopen(pathMempool.string().c_str(), "rb");
+    CAutoFile filein = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("Failed to open file %s", pathMempool.string());
+
+    // use file size to size memory buffer
+    int64_t dataSize = boost::filesystem::file_size(pathMempool) - sizeof(uint256);
+    if (dataSize < 0)
+        dataSize = 0;
+    vector<uint8_t> vchData(dataSize);
+    uint256 hashIn;
+
+    try {
+        filein.read((char *)vchData.data(), dataSize);
+        filein >> hashIn;
+    } catch (std::exception &e) {
+        return ERRORMSG("Deserialize or I/O error - %s", e.what());
+    }
+    filein.fclose();
+
+    CDataStream ssMempool(vchData, SER_DISK, CLIENT_VERSION);
+    if (hashIn != Hash(ssMempool.begin(), ssMempool.end()))
+        return ERRORMSG("Checksum mismatch, data corrupted");
+
+    uint8_t pchMsgTmp[4];
+    try {
+        ssMempool >> FLATDATA(pchMsgTmp);
+        if (memcmp(pchMsgTmp, SysCfg().MessageStart(), sizeof(pchMsgTmp)))
+            return ERRORMSG("Invalid network magic number");
+
+        uint32_t nVersion;
+        ssMempool >> nVersion;
+        if (nVersion != MEMPOOL_DUMP_VERSION)
+            return ERRORMSG("Unknown mempool.dat version %u", nVersion);
+
+        // every tx takes a byte at least, a larger count is not to be believed
+        uint32_t nCount;
+        ssMempool >> VARINT(nCount);
+        if (nCount > ssMempool.size())
+            return ERRORMSG("Tx count %u exceeds the %u bytes left", nCount, ssMempool.size());
+
+        for (uint32_t i = 0; i < nCount; i++) {
+            std::shared_ptr<CBaseTx> spTx;
+            ssMempool >> spTx;
+            txs.push_back(spTx);
+        }
+    } catch (std::exception &e) {
+        return ERRORMSG("Deserialize or I/O error - %s", e.what());
+    }
+
+    return true;
+}
+
+bool LoadMempool() {
+    int64_t nStart = GetTimeMillis();
+    vector<std::shared_ptr<CBaseTx>> txs;
+    bool fRead = ReadMempool(GetDataDir() / "mempool.dat", txs);
+    if (!fRead)
+        txs.clear();
+
+    // the signatures of all the txes at once, the state of the pool does not matter for them
+    vector<CSignatureCheck> checks;
+    vector<size_t> checkTxIndexes;
+    {
+        LOCK2(cs_main, mempool.cs);
+        for (size_t i = 0; i < txs.size(); i++) {
+            if (txs[i] == nullptr)
+                continue;
+
+            txs[i]->GetSignatureChecks(mempool.cw->accountCache, checks);
+            checkTxIndexes.resize(checks.size(), i);
+        }
+    }
+    vector<uint8_t> results;
+    VerifySignatures(checks, results);
+
+    vector<bool> badSigs(txs.size(), false);
+    for (size_t i = 0; i < checks.size(); i++) {
+        if (!results[i])
+            badSigs[checkTxIndexes[i]] = true;
+    }
+
+    // the verified signatures are in the signature cache now, the txes are executed in their old order
+    uint32_t nAccepted = 0, nFailed = 0;
+    for (size_t i = 0; i < txs.size(); i++) {
+        if (ShutdownRequested())
+            break;
+
+        if (txs[i] == nullptr || badSigs[i]) {
+            nFailed++;
+            continue;
+        }
+
+        LOCK(cs_main);
+        CValidationState state;
+        if (AcceptToMemoryPool(mempool, state, txs[i], false))
+            nAccepted++;
+        else
+            nFailed++;
+    }
+
+    fMempoolLoaded = !ShutdownRequested();
+
+    LogPrint(BCLog::INFO, "Loaded %u txes from mempool.dat, %u failed, %u checked signatures (%dms)\n", nAccepted,
+             nFailed, checks.size(), GetTimeMillis() - nStart);
+    return fRead;
+}
@@ -14,13 +14,31 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <set>
+
+#include <boost/filesystem/path.hpp>
 
 using namespace std;
 
 class CValidationState;
 class CBaseTx;
+class CBlock;
+class CBlockUndo;
 class uint256;
 
+struct TxPriority {
+    double priority;
+    double feePerKb;
+    std::shared_ptr<CBaseTx> baseTx;
+
+    TxPriority(const double priorityIn, const double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn)
+        : priority(priorityIn), feePerKb(feePerKbIn), baseTx(baseTxIn) {}
+
+    // the block producer txes, priority from TRANSACTION_PRIORITY_CEILING up, come last (packed first), then
+    // ordered by fee per KB, then by priority, then by txid
+    bool operator<(const TxPriority &other) const;
+};
+
 /*
  * CTxMemPool stores these:
  */
@@ -34,10 +52,21 @@ private:
     int64_t nTime;     // Local time when entering the mempool
     uint32_t height;  // Chain height when entering the mempool
 
+    double dFeePerKb;  // fees less the fuel fee at the tip fuel rate, per KB, while in the indexes
+    CKeyID sender;     // key id of txUid, empty if it has no account yet
+    uint32_t nUsage;   // bytes accounted for the tx, its cache overlay and its index entries
+
+    friend class CTxMemPool;
+
 public:
     CTxMemPoolEntry(CBaseTx *ptx, int64_t time, uint32_t height);
+    // takes the tx over instead of cloning it, the caller must not change it afterwards
+    CTxMemPoolEntry(std::shared_ptr<CBaseTx> spTx, int64_t time, uint32_t height);
     CTxMemPoolEntry();
-    CTxMemPoolEntry(const CTxMemPoolEntry &other);
+    // moved into the pool only, a copy would either clone the tx or share it with the pooled entry
+    CTxMemPoolEntry(const CTxMemPoolEntry &other) = delete;
+    CTxMemPoolEntry(CTxMemPoolEntry &&other) = default;
+    CTxMemPoolEntry &operator=(const CTxMemPoolEntry &other) = delete;
 
     std::shared_ptr<CBaseTx> GetTransaction() const { return pTx; }
 
@@ -47,6 +76,8 @@ public:
 
     inline int64_t GetTime() const { return nTime; }
     inline uint32_t GetHeight() const { return height; }
+    inline double GetFeePerKb() const { return dFeePerKb; }
+    inline const CKeyID &GetSender() const { return sender; }
 };
 
 /*
@@ -70,13 +101,19 @@ public:
 
 public:
     void SetSanityCheck(bool fSanityCheckIn) { fSanityCheck = fSanityCheckIn; }
-    bool AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state);
+    bool AddUnchecked(const uint256 &txid, CTxMemPoolEntry &&entry, CValidationState &state);
     void Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive = false);
     void Remove(const uint256 &txid);
+    // remove the txes confirmed by the block connected on top of the tip
+    void RemoveConfirmed(const CBlock &block);
     void QueryHash(vector<uint256> &txids);
     bool CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state, int32_t index,
                           bool bRehearsalExecute = true);
     void SetMemPoolCache();
+    // record the keys written by a block connected on top of the tip, for the next ReScanMemPoolTx()
+    void AddBlockWrites(const CBlockUndo &blockUndo);
+    // have the next ReScanMemPoolTx() execute all the txes again, after blocks are disconnected
+    void SetFullRescan();
     void ReScanMemPoolTx();
     void Clear();
 
@@ -84,9 +121,84 @@ public:
     bool Exists(const uint256 txid);
     std::shared_ptr<CBaseTx> Lookup(const uint256 txid) const;
 
+    // the txes in packing order, the first to pack last, requires cs
+    const set<TxPriority> &GetTxPriorities() const { return setTxPriorities; }
+    // txids by sender and by entry time, requires cs
+    const multimap<CKeyID, uint256> &GetTxsBySender() const { return mapTxsBySender; }
+    const multimap<int64_t, uint256> &GetTxsByTime() const { return mapTxsByTime; }
+
+    // -maxmempool in bytes and -maxmempoolsender
+    void SetLimits(uint64_t nMaxBytesIn, uint32_t nMaxSenderTxsIn);
+    // fee per KB a tx must pay while the pool is or was recently full, decaying once it has room again
+    double GetMinFeePerKb();
+    uint64_t GetTxBytes() const { return nTxBytes; }
+    uint64_t GetUsageBytes() const { return nUsageBytes; }
+    uint64_t GetMaxBytes() const { return nMaxBytes; }
+    uint32_t GetMaxSenderTxs() const { return nMaxSenderTxs; }
+    uint64_t GetEvictedCount() const { return nEvicted; }
+
 private:
     bool fSanityCheck; // Normally false, true if -checkmempool or -regtest
+
+    // Indexes of memPoolTxs, kept up to date on every insertion and removal so the block producer takes
+    // the txes in order without sorting the pool. The fee per KB depends on the fuel rate of the tip,
+    // the txes burning fuel are keyed again when it changes.
+    set<TxPriority> setTxPriorities;
+    multimap<CKeyID, uint256> mapTxsBySender;
+    multimap<int64_t, uint256> mapTxsByTime;
+    uint32_t nIndexFuelRate;
+
+    uint64_t nMaxBytes;
+    uint32_t nMaxSenderTxs;
+    uint64_t nTxBytes;
+    uint64_t nUsageBytes;
+    double dRollingMinFeePerKb;
+    int64_t nLastRollingFeeUpdate;
+    uint64_t nEvicted;
+
+    void IndexEntry(const uint256 &txid, CTxMemPoolEntry &entry);
+    void UnindexEntry(const uint256 &txid, const CTxMemPoolEntry &entry);
+    void UpdateFeeRates();
+    void ClearIndexes();
+    bool TrimToSize(const uint256 &txidNew);
+    map<uint256, CTxMemPoolEntry>::iterator RemoveEntry(map<uint256, CTxMemPoolEntry>::iterator it, bool fDirty);
+
+    // Keys each tx read or wrote in cw when it was last executed. After blocks are connected, the keys they
+    // wrote are dropped from cw and the txes touching them are executed again, along with the txes touching
+    // the keys written by those, instead of executing the whole pool on a fresh cw.
+    struct CTxDeps {
+        vector<CDbKey> keys;         // read or written
+        vector<CDbKey> writtenKeys;
+        uint32_t nOverlayBytes = 0;  // written keys and values
+    };
+    map<uint256, CTxDeps> mapTxDeps;
+    map<CDbKey, set<uint256>> mapKeyTxs;
+    set<CDbKey> setDirtyKeys;        // written by the blocks or by the removed txes since the last rescan
+    bool fFullRescan;
+    uint32_t nIncrementalRescans;
+
+    void AddDeps(const uint256 &txid, const CDBOpLogMap &dbOpLogMap);
+    void EraseDeps(const uint256 &txid, bool fDirty);
+    void ClearDeps();
+    bool ForgetDirtyKeys();
+    // drop the dirty keys from cw and execute the txes touching them again, false if a full rescan is needed
+    bool ReExecuteDirtyTxes();
+    void FullReScan();
 };
 
+/** Write the mempool txes to mempool.dat in the data dir, in the order they entered the pool. */
+void DumpMempool();
+
+/** The mempool.dat file: network magic, version, the txes, then the hash of all of it. */
+bool WriteMempool(const boost::filesystem::path &pathMempool, const vector<std::shared_ptr<CBaseTx>> &txs);
+bool ReadMempool(const boost::filesystem::path &pathMempool, vector<std::shared_ptr<CBaseTx>> &txs);
+
+/**
+ * Accept the txes of mempool.dat again. The signatures of all of them are verified first in one batch
+ * on the sigcheck workers, the txes are then executed one by one in their original order. Dumps are
+ * skipped until this is done, so a shutdown during the load does not overwrite the file.
+ */
+bool LoadMempool();
+
 
 #endif /* COIN_TXMEMPOOL_H */
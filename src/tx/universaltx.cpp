@@ -97,6 +97,17 @@ void CUniversalTx::validate_authorization(const std::vector<uint64_t>& authoriza
 
 //bool CUniversalTx::validate_payer_signature(CTxExecuteContext &context)
 
+void CUniversalTx::GetSignatureChecks(CAccountDBCache &accountCache, vector<CSignatureCheck> &checks) const {
+    CBaseTx::GetSignatureChecks(accountCache, checks);
+
+    TxID signature_hash = GetHash();
+    for (const auto &s : signatures) {
+        CAccount account;
+        if (accountCache.GetAccount(CRegID(s.account), account) && account.owner_pubkey.IsValid())
+            checks.emplace_back(signature_hash, s.signature, account.owner_pubkey);
+    }
+}
+
 void
 CUniversalTx::get_accounts_from_signatures(CCacheWrapper& database, std::vector <uint64_t>& authorization_accounts) {
 
@@ -106,7 +117,23 @@ CUniversalTx::get_accounts_from_signatures(CCacheWrapper& database, std::vector
 
     auto spPayer = sp_tx_account;
 
-    for (auto s : signatures) {
+    // verify the signatures in one batch up front, up to the first one whose account can not verify it;
+    // the asserts below still fire in the order of the signatures
+    vector<shared_ptr<CAccount>> signer_accounts;
+    vector<CSignatureCheck> checks;
+    for (const auto &s : signatures) {
+        auto spAccount = GetAccount(database, CRegID(s.account));
+        if (!spAccount || !spAccount->owner_pubkey.IsValid())
+            break;
+
+        signer_accounts.push_back(spAccount);
+        checks.emplace_back(signature_hash, s.signature, spAccount->owner_pubkey);
+    }
+    vector<uint8_t> verify_results;
+    VerifySignatures(checks, verify_results);
+
+    for (size_t i = 0; i < signatures.size(); i++) {
+        const auto &s = signatures[i];
         CRegID regid(s.account);
         CHAIN_ASSERT( !regid.IsEmpty(),
                     wasm_chain::account_access_exception,
@@ -121,7 +148,7 @@ CUniversalTx::get_accounts_from_signatures(CCacheWrapper& database, std::vector
                       wasm_chain::tx_duplicate_sig,
                       "duplicate signatures from payer '%s'", spPayer->regid.ToString())
 
-        auto spAccount = GetAccount(database, CRegID(s.account));
+        auto spAccount = i < signer_accounts.size() ? signer_accounts[i] : GetAccount(database, CRegID(s.account));
         CHAIN_ASSERT( spAccount,
                       wasm_chain::account_access_exception, "%s",
                       "can not get account from regid '%s'", wasm::name(s.account).to_string() )
@@ -131,7 +158,7 @@ CUniversalTx::get_accounts_from_signatures(CCacheWrapper& database, std::vector
                       "pubkey of account=%s is invalid", wasm::name(s.account).to_string() )
 
 
-        CHAIN_ASSERT( ::VerifySignature(signature_hash, s.signature, spAccount->owner_pubkey),
+        CHAIN_ASSERT( i < verify_results.size() && verify_results[i] != 0,
                       wasm_chain::unsatisfied_authorization,
                       "can not verify signature '%s bye public key '%s' and hash '%s' ",
                       to_hex(s.signature), spAccount->owner_pubkey.ToString(), signature_hash.ToString() )
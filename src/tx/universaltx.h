@@ -71,6 +71,7 @@ public:
     virtual std::shared_ptr<CBaseTx>   GetNewInstance() const { return std::make_shared<CUniversalTx>(*this); }
     virtual map<TokenSymbol, uint64_t> GetValues()      const { return map<TokenSymbol, uint64_t>{{SYMB::WICC, 0}}; }
     virtual bool                       GetInvolvedKeyIds(CCacheWrapper &cw, set<CKeyID> &keyIds);
+    virtual void                       GetSignatureChecks(CAccountDBCache &accountCache, vector<CSignatureCheck> &checks) const;
     virtual string ToString(CAccountDBCache &accountCache);
     virtual Object ToJson(CCacheWrapper &cw) const;
 
@@ -0,0 +1,94 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txadmissionqueue.h"
+
+#include <boost/thread.hpp>
+
+#include "commons/util/util.h"
+
+CTxAdmissionQueue txAdmissionQueue;
+
+bool CTxAdmissionQueue::Push(Stage &&check, Stage &&accept) {
+    if (GetWorkerCount() == 0)
+        return false;
+
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (jobs.size() >= MAX_QUEUED_TXS)
+            return false;
+
+        jobs.push_back(CJob{nNextSeq++, std::move(check), std::move(accept)});
+    }
+    condWork.notify_one();
+    return true;
+}
+
+size_t CTxAdmissionQueue::Size() {
+    boost::unique_lock<boost::mutex> lock(cs);
+    return jobs.size();
+}
+
+// Hands the turn to the next job when the accept stage of the current one is over.
+class CTxAdmissionQueue::CTurnGuard {
+public:
+    CTurnGuard(CTxAdmissionQueue &queueIn, boost::unique_lock<boost::mutex> &lockIn) : queue(queueIn), lock(lockIn) {}
+
+    ~CTurnGuard() {
+        if (!lock.owns_lock())
+            lock.lock();
+
+        queue.nNextAccept++;
+        lock.unlock();
+        queue.condTurn.notify_all();
+    }
+
+private:
+    CTxAdmissionQueue &queue;
+    boost::unique_lock<boost::mutex> &lock;
+};
+
+void CTxAdmissionQueue::RunStage(const Stage &stage) {
+    try {
+        stage();
+    } catch (std::exception &e) {
+        PrintExceptionContinue(&e, "txadmit");
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "txadmit");
+    }
+}
+
+void CTxAdmissionQueue::ThreadAdmit() {
+    nWorkers++;
+
+    try {
+        while (true) {
+            CJob job;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                while (jobs.empty())
+                    condWork.wait(lock);
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            // the later jobs wait for the turn of this one, it must get there even on interruption
+            boost::this_thread::disable_interruption noInterruption;
+            RunStage(job.check);
+
+            boost::unique_lock<boost::mutex> lock(cs);
+            while (nNextAccept != job.nSeq)
+                condTurn.wait(lock);
+
+            // pass the turn on however the accept stage ends
+            CTurnGuard turnGuard(*this, lock);
+            lock.unlock();
+            RunStage(job.accept);
+        }
+    } catch (const boost::thread_interrupted &) {
+        nWorkers--;
+        throw;
+    }
+}
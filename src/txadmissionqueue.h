@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_TXADMISSIONQUEUE_H
+#define COIN_TXADMISSIONQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/**
+ * Two-stage admission of relayed txes into the mempool, run by the -txcheckthreads workers. The check
+ * stage holds no lock and runs on several workers at once. The accept stage takes cs_main and runs one
+ * tx at a time, in the order the txes were pushed, so a tx spending the output of the one before it is
+ * not turned away because it was checked faster.
+ */
+class CTxAdmissionQueue {
+public:
+    typedef std::function<void()> Stage;
+
+    static const size_t MAX_QUEUED_TXS = 10000;
+
+    CTxAdmissionQueue() : nWorkers(0) {}
+
+    /**
+     * Returns false if there is no worker or the queue is full. Without workers the caller can run both
+     * stages itself; with a full queue it must not, as that would put the tx ahead of the queued ones.
+     */
+    bool Push(Stage &&check, Stage &&accept);
+
+    /** Worker thread body. */
+    void ThreadAdmit();
+
+    int32_t GetWorkerCount() const { return nWorkers.load(std::memory_order_relaxed); }
+    size_t Size();
+
+private:
+    class CTurnGuard;
+
+    /** Run a stage of a job, any exception it throws is logged and dropped. */
+    static void RunStage(const Stage &stage);
+
+    struct CJob {
+        uint64_t nSeq;
+        Stage check;
+        Stage accept;
+    };
+
+    boost::mutex cs;  // guards the fields below
+    boost::condition_variable condWork;
+    boost::condition_variable condTurn;
+    std::deque<CJob> jobs;
+    uint64_t nNextSeq    = 0;  // sequence of the next pushed job
+    uint64_t nNextAccept = 0;  // sequence of the job whose accept stage runs next
+
+    std::atomic<int32_t> nWorkers;
+};
+
+extern CTxAdmissionQueue txAdmissionQueue;
+
+#endif  // COIN_TXADMISSIONQUEUE_H
@@ -218,6 +218,12 @@ void CWallet::ResendWalletTransactions() {
 
 //// Call after CreateTransaction unless you want to abort
 bool CWallet::CommitTx(CBaseTx *pTx, CValidationState &state) {
+    // the stateless checks first, so concurrent submissions do not verify signatures under cs_main
+    if (!PreCheckTxForMemPool(mempool, state, pTx)) {
+        LogPrint(BCLog::RPCCMD, "CommitTx() : invalid transaction %s\n", state.GetRejectReason());
+        return false;
+    }
+
     LOCK2(cs_main, cs_wallet);
     LogPrint(BCLog::RPCCMD, "CommitTx() : %s\n", pTx->ToString(*pCdMan->pAccountCache));
 